@@ -0,0 +1,106 @@
+/**
+ * @file bench_keydir.cpp
+ * @author Lucas
+ * @brief Benchmarks of the KeyDir insert and lookup paths
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "bench_util.hpp"
+#include "keydir.hpp"
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+
+std::vector<std::string> make_keys(std::size_t n, std::size_t key_size)
+{
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::uint64_t i = 0; i < n; i++)
+    {
+        keys.push_back(bench::make_key(i, key_size));
+    }
+    return keys;
+}
+
+// Args: number of keys, key size
+void BM_KeyDirInsert(benchmark::State &state)
+{
+    std::size_t n_keys = static_cast<std::size_t>(state.range(0));
+    std::vector<std::string> keys = make_keys(n_keys, static_cast<std::size_t>(state.range(1)));
+
+    keydir::Stats stats;
+    for (auto _ : state)
+    {
+        keydir::KeyDir kd;
+        for (std::uint64_t i = 0; i < n_keys; i++)
+        {
+            benchmark::DoNotOptimize(kd.set(keys[i], {.fileid = 1, .vsz = 16, .vpos = i}));
+        }
+
+        state.PauseTiming();
+        stats = kd.stats();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n_keys));
+    state.counters["bytes_per_key"] = stats.bytes_per_key();
+}
+
+/**
+ * @brief KeyDir of the lookup benchmarks, filled once per key count and
+ *        shared by the benchmark threads.
+ */
+const keydir::KeyDir &filled_keydir(std::size_t n_keys)
+{
+    static std::mutex mutex;
+    static std::map<std::size_t, std::unique_ptr<keydir::KeyDir>> keydirs;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<keydir::KeyDir> &kd = keydirs[n_keys];
+    if (kd == nullptr)
+    {
+        kd = std::make_unique<keydir::KeyDir>();
+        for (std::uint64_t i = 0; i < n_keys; i++)
+        {
+            absl::Status status = kd->set(bench::make_key(i), {.fileid = 1, .vsz = 16, .vpos = i});
+        }
+    }
+    return *kd;
+}
+
+// Args: number of keys, hit (1) or miss (0)
+void BM_KeyDirLookup(benchmark::State &state)
+{
+    std::size_t n_keys = static_cast<std::size_t>(state.range(0));
+    bool hit = state.range(1) != 0;
+    const keydir::KeyDir &kd = filled_keydir(n_keys);
+
+    // misses look up keys past the filled range
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(n_keys, 1 << 16, 7 + state.thread_index());
+    std::vector<std::string> keys;
+    keys.reserve(indexes.size());
+    for (std::uint64_t index : indexes)
+    {
+        keys.push_back(bench::make_key(hit ? index : index + n_keys));
+    }
+
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(kd.get(keys[i++ & (keys.size() - 1)]));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(hit ? "hit" : "miss");
+}
+
+} // namespace
+
+BENCHMARK(BM_KeyDirInsert)->ArgsProduct({{1 << 14, 1 << 17, 1 << 20}, {16, 64}})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_KeyDirLookup)->ArgsProduct({{1 << 14, 1 << 20}, {1, 0}});
+BENCHMARK(BM_KeyDirLookup)->Args({1 << 20, 1})->Threads(2)->Threads(4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,439 @@
+/**
+ * @file bench_store.cpp
+ * @author Lucas
+ * @brief Benchmarks of the Store read, write and startup paths
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "bench_util.hpp"
+#include "store.hpp"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+
+namespace
+{
+
+const std::uint64_t N_KEYS = 100000;
+
+/**
+ * @struct Dataset
+ * @brief Store pre-loaded with N_KEYS keys, shared by the read benchmarks.
+ */
+struct Dataset
+{
+    bench::TempDir dir;
+    std::unique_ptr<store::Store> store;
+
+    explicit Dataset(int sizes) : dir(std::string("dataset_") + bench::value_sizes_name(sizes))
+    {
+        store = std::make_unique<store::Store>(dir.path());
+        absl::Status status = store->load_keydir();
+        std::vector<std::size_t> value_sizes = bench::make_value_sizes(sizes, N_KEYS);
+        for (std::uint64_t i = 0; i < N_KEYS && status.ok(); i++)
+        {
+            status = store->set(bench::make_key(i), std::string(value_sizes[i], 'v'));
+        }
+        if (!status.ok())
+        {
+            throw std::runtime_error(std::string(status.message()));
+        }
+    }
+};
+
+Dataset &dataset(int sizes)
+{
+    static std::mutex mutex;
+    static std::map<int, std::unique_ptr<Dataset>> datasets;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Dataset> &dataset = datasets[sizes];
+    if (dataset == nullptr)
+    {
+        dataset = std::make_unique<Dataset>(sizes);
+    }
+    return *dataset;
+}
+
+void set_labels(benchmark::State &state, bool random, int sizes)
+{
+    state.SetLabel(std::string(random ? "random" : "sequential") + "/" + bench::value_sizes_name(sizes));
+}
+
+// Args: random order, value sizes
+void BM_Set(benchmark::State &state)
+{
+    bool random = state.range(0) != 0;
+    int sizes = static_cast<int>(state.range(1));
+    bench::TempDir dir("set");
+    store::Store store(dir.path());
+    if (!store.load_keydir().ok())
+    {
+        state.SkipWithError("load_keydir failed");
+        return;
+    }
+
+    std::vector<std::size_t> value_sizes = bench::make_value_sizes(sizes, N_KEYS);
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS, N_KEYS);
+    std::string value;
+    value.reserve(*std::max_element(value_sizes.begin(), value_sizes.end()));
+    std::uint64_t i = 0;
+    std::int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::uint64_t index = random ? indexes[i % N_KEYS] : i;
+        std::size_t vsz = value_sizes[i % N_KEYS];
+        value.assign(vsz, 'v'); // reuses the reserved buffer
+        if (!store.set(bench::make_key(index), value).ok())
+        {
+            state.SkipWithError("set failed");
+            break;
+        }
+        bytes += static_cast<std::int64_t>(vsz);
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    set_labels(state, random, sizes);
+}
+
+// Args: random order, value sizes
+void BM_Get(benchmark::State &state)
+{
+    bool random = state.range(0) != 0;
+    int sizes = static_cast<int>(state.range(1));
+    store::Store &store = *dataset(sizes).store;
+
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS, N_KEYS, 7 + state.thread_index());
+    std::uint64_t i = 0;
+    std::int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        std::uint64_t index = random ? indexes[i % N_KEYS] : i % N_KEYS;
+        absl::StatusOr<std::string> value = store.get(bench::make_key(index));
+        if (!value.ok())
+        {
+            state.SkipWithError("get failed");
+            break;
+        }
+        bytes += static_cast<std::int64_t>(value->size());
+        benchmark::DoNotOptimize(value);
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    set_labels(state, random, sizes);
+}
+
+// Args: value cache size in MiB. Zipfian reads of medium values.
+void BM_GetZipf(benchmark::State &state)
+{
+    std::size_t cache_mib = static_cast<std::size_t>(state.range(0));
+    store::Options options;
+    options.value_cache_bytes = cache_mib * 1024 * 1024;
+    store::Store store(dataset(bench::kMedium).dir.path(), options);
+    if (!store.load_keydir().ok())
+    {
+        state.SkipWithError("load_keydir failed");
+        return;
+    }
+
+    std::vector<std::uint64_t> indexes = bench::make_zipf_indexes(N_KEYS, N_KEYS);
+    std::uint64_t i = 0;
+    for (auto _ : state)
+    {
+        absl::StatusOr<std::string> value = store.get(bench::make_key(indexes[i++ % N_KEYS]));
+        if (!value.ok())
+        {
+            state.SkipWithError("get failed");
+            break;
+        }
+        benchmark::DoNotOptimize(value);
+    }
+    store::ValueCache::Stats stats = store.value_cache_stats();
+    state.counters["hit_ratio"] = stats.hit_ratio();
+    state.counters["cache_bytes"] = static_cast<double>(stats.bytes);
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel("zipf/medium");
+}
+
+// Args: scan with a cursor, or get every key in random order. An iteration
+// exports the whole dataset.
+void BM_Export(benchmark::State &state)
+{
+    bool cursor = state.range(0) != 0;
+    store::Store &store = *dataset(bench::kMedium).store;
+
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS, N_KEYS, 7);
+    std::int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        if (cursor)
+        {
+            store::Cursor scan = store.scan();
+            for (; scan.valid(); scan.next())
+            {
+                bytes += static_cast<std::int64_t>(scan.value().size());
+            }
+            if (!scan.status().ok())
+            {
+                state.SkipWithError("scan failed");
+                break;
+            }
+            continue;
+        }
+        for (std::uint64_t index : indexes)
+        {
+            absl::StatusOr<std::string> value = store.get(bench::make_key(index));
+            if (!value.ok())
+            {
+                state.SkipWithError("get failed");
+                break;
+            }
+            bytes += static_cast<std::int64_t>(value->size());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(N_KEYS));
+    state.SetBytesProcessed(bytes);
+    state.SetLabel(cursor ? "cursor" : "get");
+}
+
+// Args: keys per call, random order. Items are keys, comparable to BM_Get.
+void BM_MultiGet(benchmark::State &state)
+{
+    std::size_t batch = static_cast<std::size_t>(state.range(0));
+    bool random = state.range(1) != 0;
+    store::Store &store = *dataset(bench::kSmall).store;
+
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS, N_KEYS, 7);
+    std::vector<std::string> owned(batch);
+    std::vector<std::string_view> keys(batch);
+    std::uint64_t i = 0;
+    std::int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (std::size_t k = 0; k < batch; k++, i++)
+        {
+            owned[k] = bench::make_key(random ? indexes[i % N_KEYS] : i % N_KEYS);
+            keys[k] = owned[k];
+        }
+        state.ResumeTiming();
+        std::vector<absl::StatusOr<std::string>> values = store.multi_get(keys);
+        for (const absl::StatusOr<std::string> &value : values)
+        {
+            bytes += value.ok() ? static_cast<std::int64_t>(value->size()) : 0;
+        }
+        benchmark::DoNotOptimize(values);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(batch));
+    state.SetBytesProcessed(bytes);
+    set_labels(state, random, bench::kSmall);
+}
+
+// Args: reads in flight. Items are keys, comparable to BM_Get.
+void BM_AsyncGet(benchmark::State &state)
+{
+    std::size_t depth = static_cast<std::size_t>(state.range(0));
+    store::Store &store = *dataset(bench::kSmall).store;
+
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS, N_KEYS, 7);
+    std::vector<std::future<absl::StatusOr<std::string>>> values(depth);
+    std::uint64_t i = 0;
+    for (auto _ : state)
+    {
+        for (std::size_t k = 0; k < depth; k++, i++)
+        {
+            values[k] = store.async_get(bench::make_key(indexes[i % N_KEYS]));
+        }
+        for (std::future<absl::StatusOr<std::string>> &value : values)
+        {
+            if (!value.get().ok())
+            {
+                state.SkipWithError("async_get failed");
+                break;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(depth));
+    set_labels(state, true, bench::kSmall);
+}
+
+// Args: percentage of reads
+void BM_Mixed(benchmark::State &state)
+{
+    std::uint64_t read_percent = static_cast<std::uint64_t>(state.range(0));
+    bench::TempDir dir("mixed");
+    store::Store store(dir.path());
+    absl::Status status = store.load_keydir();
+    for (std::uint64_t i = 0; i < N_KEYS / 10 && status.ok(); i++)
+    {
+        status = store.set(bench::make_key(i), std::string(256, 'v'));
+    }
+    if (!status.ok())
+    {
+        state.SkipWithError("setup failed");
+        return;
+    }
+
+    std::vector<std::uint64_t> indexes = bench::make_random_indexes(N_KEYS / 10, N_KEYS);
+    std::vector<std::uint64_t> dice = bench::make_random_indexes(100, N_KEYS, 11);
+    std::string value(256, 'w');
+    std::uint64_t i = 0;
+    for (auto _ : state)
+    {
+        std::string key = bench::make_key(indexes[i % N_KEYS]);
+        if (dice[i % N_KEYS] < read_percent)
+        {
+            benchmark::DoNotOptimize(store.get(key));
+        }
+        else if (!store.set(key, value).ok())
+        {
+            state.SkipWithError("set failed");
+            break;
+        }
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::to_string(read_percent) + "% reads");
+}
+
+void BM_Del(benchmark::State &state)
+{
+    const std::uint64_t n_keys = N_KEYS / 10;
+    bench::TempDir dir("del");
+    store::Store store(dir.path());
+    absl::Status status = store.load_keydir();
+    auto fill = [&]() {
+        for (std::uint64_t i = 0; i < n_keys && status.ok(); i++)
+        {
+            status = store.set(bench::make_key(i), "v");
+        }
+    };
+    fill();
+
+    std::uint64_t i = 0;
+    for (auto _ : state)
+    {
+        if (i == n_keys)
+        {
+            state.PauseTiming();
+            fill();
+            i = 0;
+            state.ResumeTiming();
+        }
+        if (!status.ok() || !store.del(bench::make_key(i)).ok())
+        {
+            state.SkipWithError("del failed");
+            break;
+        }
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * @brief Drop the pages of the files of a directory from the page cache.
+ *        The files must be clean, see ::sync().
+ */
+void drop_page_cache(const std::string &path)
+{
+    for (const auto &file : bench::fs::directory_iterator(path))
+    {
+        int fd = ::open(file.path().c_str(), O_RDONLY);
+        if (fd >= 0)
+        {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+}
+
+// Args: cold page cache, hint files, load threads (0 for one per hardware thread)
+void BM_LoadKeydir(benchmark::State &state)
+{
+    bool cold = state.range(0) != 0;
+    bool hints = state.range(1) != 0;
+    std::size_t threads = static_cast<std::size_t>(state.range(2));
+
+    // a dataset spread over many datafiles, with overwrites and deletes
+    static bench::TempDir dir("startup");
+    static std::once_flag generated;
+    std::call_once(generated, [&]() {
+        store::Options options;
+        options.max_file_size = 1024 * 1024;
+        store::Store store(dir.path(), options);
+        absl::Status status = store.load_keydir();
+        std::vector<std::size_t> value_sizes = bench::make_value_sizes(bench::kMixed, N_KEYS);
+        for (std::uint64_t i = 0; i < 2 * N_KEYS && status.ok(); i++)
+        {
+            status = store.set(bench::make_key(i % N_KEYS), std::string(value_sizes[i % N_KEYS], 'v'));
+            if (status.ok() && i % 10 == 0)
+            {
+                status = store.del(bench::make_key(i % N_KEYS));
+            }
+        }
+        ::sync();
+    });
+
+    store::Options options;
+    options.max_file_size = 1024 * 1024;
+    options.load_threads = threads;
+    std::size_t keys = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        if (!hints)
+        {
+            for (const auto &file : bench::fs::directory_iterator(dir.path()))
+            {
+                if (file.path().extension() == ".hint")
+                {
+                    bench::fs::remove(file.path());
+                }
+            }
+        }
+        if (cold)
+        {
+            ::sync();
+            drop_page_cache(dir.path());
+        }
+        auto store = std::make_unique<store::Store>(dir.path(), options);
+        state.ResumeTiming();
+
+        if (!store->load_keydir().ok())
+        {
+            state.SkipWithError("load_keydir failed");
+            break;
+        }
+
+        state.PauseTiming();
+        keys = store->kd_size();
+        store.reset();
+        state.ResumeTiming();
+    }
+    state.counters["keys"] = static_cast<double>(keys);
+    state.SetLabel(std::string(cold ? "cold" : "warm") + (hints ? "/hints" : "/datafiles") + "/" +
+                   (threads == 0 ? std::string("all") : std::to_string(threads)) + " threads");
+}
+
+} // namespace
+
+BENCHMARK(BM_Set)->ArgsProduct({{0, 1}, {bench::kSmall, bench::kMedium, bench::kLarge, bench::kMixed}});
+BENCHMARK(BM_Get)->ArgsProduct({{0, 1}, {bench::kSmall, bench::kMedium, bench::kLarge, bench::kMixed}});
+BENCHMARK(BM_Get)->Args({1, bench::kSmall})->Threads(2)->Threads(4)->UseRealTime();
+BENCHMARK(BM_GetZipf)->Arg(0)->Arg(1)->Arg(4);
+BENCHMARK(BM_MultiGet)->ArgsProduct({{16, 128}, {0, 1}});
+BENCHMARK(BM_Export)->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_AsyncGet)->Arg(1)->Arg(32)->Arg(256)->UseRealTime();
+BENCHMARK(BM_Mixed)->Arg(50)->Arg(90)->Arg(99);
+BENCHMARK(BM_Del);
+BENCHMARK(BM_LoadKeydir)->ArgsProduct({{0, 1}, {0, 1}, {1, 0}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,164 @@
+/**
+ * @file bench_util.hpp
+ * @author Lucas
+ * @brief Datasets shared by the benchmarks
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_BENCH_UTIL_HPP_
+#define BITCASK_BENCH_UTIL_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * @enum ValueSizes
+ * @brief Distribution of the value sizes of a dataset.
+ */
+enum ValueSizes
+{
+    kSmall = 0,  /**< 16 bytes */
+    kMedium = 1, /**< 256 bytes */
+    kLarge = 2,  /**< 4 KiB */
+    kMixed = 3   /**< Mostly small with a long tail: 90% 16-128 bytes, 10% up to 16 KiB */
+};
+
+inline const char *value_sizes_name(int sizes)
+{
+    static const char *names[] = {"small", "medium", "large", "mixed"};
+    return names[sizes];
+}
+
+/**
+ * @class TempDir
+ * @brief Database directory removed when the object goes out of scope.
+ */
+class TempDir
+{
+  private:
+    fs::path path_;
+
+  public:
+    explicit TempDir(const std::string &name)
+        : path_(fs::temp_directory_path() / ("bitcask_bench_" + name + "_" + std::to_string(std::random_device{}())))
+    {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+    TempDir(const TempDir &) = delete;
+    TempDir &operator=(const TempDir &) = delete;
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+
+    inline std::string path() const
+    {
+        return path_.string();
+    }
+};
+
+/**
+ * @brief Fixed width key of index i, so that sequential indexes are sorted.
+ */
+inline std::string make_key(std::uint64_t i, std::size_t key_size = 16)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "key%013llu", static_cast<unsigned long long>(i));
+    std::string key(buf);
+    key.resize(key_size, '_');
+    return key;
+}
+
+/**
+ * @brief n value sizes drawn from a distribution, with a fixed seed so that
+ *        every run writes the same dataset.
+ */
+inline std::vector<std::size_t> make_value_sizes(int sizes, std::size_t n)
+{
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::size_t> small(16, 128);
+    std::uniform_int_distribution<std::size_t> tail(129, 16 * 1024);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    std::vector<std::size_t> result(n);
+    for (std::size_t &size : result)
+    {
+        switch (sizes)
+        {
+        case kSmall:
+            size = 16;
+            break;
+        case kMedium:
+            size = 256;
+            break;
+        case kLarge:
+            size = 4096;
+            break;
+        default:
+            size = percent(rng) < 90 ? small(rng) : tail(rng);
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Random key indexes in [0, n_keys), with a fixed seed.
+ */
+inline std::vector<std::uint64_t> make_random_indexes(std::uint64_t n_keys, std::size_t n, std::uint64_t seed = 7)
+{
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<std::uint64_t> dist(0, n_keys - 1);
+    std::vector<std::uint64_t> result(n);
+    for (std::uint64_t &index : result)
+    {
+        index = dist(rng);
+    }
+    return result;
+}
+
+/**
+ * @brief Key indexes in [0, n_keys) following a Zipfian distribution of
+ *        exponent theta, with a fixed seed. The popular keys are scattered
+ *        over the key space rather than being the first ones.
+ */
+inline std::vector<std::uint64_t> make_zipf_indexes(std::uint64_t n_keys, std::size_t n, double theta = 0.99,
+                                                    std::uint64_t seed = 7)
+{
+    std::vector<double> cdf(n_keys);
+    double sum = 0;
+    for (std::uint64_t rank = 0; rank < n_keys; rank++)
+    {
+        sum += 1.0 / std::pow(static_cast<double>(rank + 1), theta);
+        cdf[rank] = sum;
+    }
+
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<std::uint64_t> result(n);
+    for (std::uint64_t &index : result)
+    {
+        std::uint64_t rank = static_cast<std::uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin());
+        index = (std::min(rank, n_keys - 1) * 0x9E3779B97F4A7C15ULL) % n_keys;
+    }
+    return result;
+}
+
+} // namespace bench
+
+#endif // BITCASK_BENCH_UTIL_HPP_
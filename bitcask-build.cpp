@@ -0,0 +1,109 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "absl/strings/numbers.h"
+#include "include/store_builder.hpp"
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program
+              << " <path_to_dir> [--input <file|->] [--format commands|tsv|binary] [--max-file-size <bytes>]"
+                 " [--threads <n>] [--memory-limit <bytes>]"
+              << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+    // Handle command line arguments
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string db_path = argv[1];
+    std::string source = "-";
+    store::BulkFormat format = store::BulkFormat::kTsv;
+    store::Options options;
+    std::size_t threads = 0;
+    std::uint64_t memory_limit = store::StoreBuilder::DEFAULT_MEMORY_LIMIT;
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        bool valid = i + 1 < argc;
+        if (valid && flag == "--input")
+        {
+            source = argv[i + 1];
+        }
+        else if (valid && flag == "--format")
+        {
+            absl::StatusOr<store::BulkFormat> parsed = store::parse_bulk_format(argv[i + 1]);
+            valid = parsed.ok();
+            format = parsed.value_or(format);
+        }
+        else if (valid && flag == "--max-file-size")
+        {
+            valid = absl::SimpleAtoi(argv[i + 1], &options.max_file_size) && options.max_file_size > 0;
+        }
+        else if (valid && flag == "--threads")
+        {
+            valid = absl::SimpleAtoi(argv[i + 1], &threads);
+        }
+        else if (valid && flag == "--memory-limit")
+        {
+            valid = absl::SimpleAtoi(argv[i + 1], &memory_limit);
+        }
+        else
+        {
+            valid = false;
+        }
+        if (!valid)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::ifstream file;
+    if (source != "-")
+    {
+        file.open(source, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Error: cannot open " << source << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        // stdin is read in large chunks by the reader
+        std::ios::sync_with_stdio(false);
+    }
+
+    // the records are gathered in memory up to the limit, then spilled to
+    // sorted runs in the directory which are merged once all are read
+    store::StoreBuilder builder(db_path, options, threads, memory_limit);
+    store::BulkReader reader(source == "-" ? std::cin : file, format);
+    absl::Status status = builder.add(reader);
+    if (!status.ok())
+    {
+        std::cerr << "Error: " << status.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+    absl::StatusOr<store::BuildStats> stats = builder.finish();
+    if (!stats.ok())
+    {
+        std::cerr << "Error: " << stats.status().message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double mb = static_cast<double>(stats->bytes) / (1024 * 1024);
+    std::cout << std::fixed << std::setprecision(2) << "Built " << stats->keys << " keys from " << stats->records
+              << " records in " << stats->datafiles << " datafiles (" << mb << " MB) from " << stats->runs
+              << " runs with " << stats->threads << " threads in " << stats->seconds
+              << " s: " << static_cast<std::uint64_t>(stats->records_per_second())
+              << " records/s" << '\n';
+
+    return EXIT_SUCCESS;
+}
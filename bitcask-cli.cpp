@@ -1,16 +1,94 @@
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <unistd.h>
 
+#include "absl/strings/numbers.h"
 #include "include/bitcask_handle.hpp"
 
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program
+              << " <path_to_dir> [--load <file|->] [--format commands|tsv|binary] [--batch-bytes <n>]" << std::endl;
+}
+
+/**
+ * @brief Load a file (or stdin for "-") with batched appends and report the
+ *        throughput.
+ */
+static int load(bitcask::BitcaskHandle &handle, const std::string &source, store::BulkFormat format,
+                std::size_t batch_bytes)
+{
+    std::ifstream file;
+    if (source != "-")
+    {
+        file.open(source, std::ios::binary);
+        if (!file)
+        {
+            std::cerr << "Error: cannot open " << source << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        // stdin is read in large chunks by the reader
+        std::ios::sync_with_stdio(false);
+    }
+
+    absl::StatusOr<store::BulkStats> stats = handle.load(source == "-" ? std::cin : file, format, batch_bytes);
+    if (!stats.ok())
+    {
+        std::cerr << "Error: " << stats.status().message() << '\n';
+        return EXIT_FAILURE;
+    }
+    double mb = static_cast<double>(stats->bytes) / (1024 * 1024);
+    std::cout << std::fixed << std::setprecision(2) << "Loaded " << stats->records << " records (" << mb << " MB) in " << stats->seconds << " s: "
+              << static_cast<std::uint64_t>(stats->records_per_second()) << " records/s, "
+              << (stats->seconds > 0 ? mb / stats->seconds : 0.0) << " MB/s" << '\n';
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, const char *argv[])
 {
     // Handle command line arguments
     if (argc < 2)
     {
-        std::cerr << "Usage: " << argv[0] << " <path_to_dir> [args]" << std::endl;
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
+    std::string db_path = argv[1];
+    std::string source;
+    store::BulkFormat format = store::BulkFormat::kCommands;
+    std::size_t batch_bytes = 4 * 1024 * 1024;
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        bool valid = i + 1 < argc;
+        if (valid && flag == "--load")
+        {
+            source = argv[i + 1];
+        }
+        else if (valid && flag == "--format")
+        {
+            absl::StatusOr<store::BulkFormat> parsed = store::parse_bulk_format(argv[i + 1]);
+            valid = parsed.ok();
+            format = parsed.value_or(format);
+        }
+        else if (valid && flag == "--batch-bytes")
+        {
+            valid = absl::SimpleAtoi(argv[i + 1], &batch_bytes) && batch_bytes > 0;
+        }
+        else
+        {
+            valid = false;
+        }
+        if (!valid)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
 
     // Print welcome message
     // std::cout << "Welcome to \033[31;1mBitcask CLI\033[0m!" << '\n';
@@ -18,15 +96,27 @@ int main(int argc, const char *argv[])
     // std::cout << "Type 'quit' to exit." << '\n';
 
     // Create a BitcaskHandle object
-    std::string db_path = argv[1];
     bitcask::BitcaskHandle handle = bitcask::BitcaskHandle(db_path);
+    if (!source.empty())
+    {
+        return load(handle, source, format, batch_bytes);
+    }
+
+    // the prompt is only shown to a terminal, piped commands are read silently
+    bool interactive = ::isatty(STDIN_FILENO);
 
     // Main loop
     while (true)
     {
         std::string input;
-        std::cout << db_path << "\033[1m> \033[0m"; // Prompt
-        std::getline(std::cin, input);
+        if (interactive)
+        {
+            std::cout << db_path << "\033[1m> \033[0m" << std::flush; // Prompt
+        }
+        if (!std::getline(std::cin, input))
+        {
+            break;
+        }
 
         std::istringstream iss(input);
 
@@ -59,19 +149,20 @@ int main(int argc, const char *argv[])
                 }
                 else
                 {
-                    std::cerr << "Error: " << result.status().message() << std::endl;
+                    std::cerr << "Error: " << result.status().message() << '\n';
                 }
             }
             else if (command == "set" || command == "s")
             {
+                // the value is the rest of the line, spaces included
                 iss >> key;
-                iss >> value;
+                std::getline(iss >> std::ws, value);
                 // std::cout << "key=" << key;
                 // std::cout << ", value=" << value << '\n';
                 absl::Status status = handle.set(key, value);
                 if (!status.ok())
                 {
-                    std::cerr << "Error: " << status.message() << std::endl;
+                    std::cerr << "Error: " << status.message() << '\n';
                 }
                 else
                 {
@@ -85,7 +176,7 @@ int main(int argc, const char *argv[])
                 absl::Status status = handle.del(key);
                 if (!status.ok())
                 {
-                    std::cerr << "Error: " << status.message() << std::endl;
+                    std::cerr << "Error: " << status.message() << '\n';
                 }
             }
             else if (command == "list" || command == "l" || command == "keys" || command == "k")
@@ -93,12 +184,20 @@ int main(int argc, const char *argv[])
                 absl::Status status = handle.list();
                 if (!status.ok())
                 {
-                    std::cerr << "Error: " << status.message() << std::endl;
+                    std::cerr << "Error: " << status.message() << '\n';
+                }
+            }
+            else if (command == "merge" || command == "m")
+            {
+                absl::Status status = handle.merge();
+                if (!status.ok())
+                {
+                    std::cerr << "Error: " << status.message() << '\n';
                 }
             }
             else
             {
-                std::cerr << "Unrecognized command: " << input << std::endl;
+                std::cerr << "Unrecognized command: " << input << '\n';
             }
         }
     }
@@ -0,0 +1,100 @@
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "absl/strings/numbers.h"
+#include "include/server.hpp"
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program
+              << " <path_to_dir> [--bind <address>] [--port <port>] [--threads <n>] [--on-corruption fail|truncate]"
+              << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+    // Handle command line arguments
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string db_path = argv[1];
+    store::ServerOptions server_options;
+    // SCAN lists the keys with the ordered index
+    store::Options options;
+    options.ordered_index = true;
+    for (int i = 2; i < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        bool valid = i + 1 < argc;
+        if (valid && flag == "--bind")
+        {
+            server_options.bind_address = argv[i + 1];
+        }
+        else if (valid && flag == "--port")
+        {
+            std::uint32_t port = 0;
+            valid = absl::SimpleAtoi(argv[i + 1], &port) && port <= 65535;
+            server_options.port = static_cast<std::uint16_t>(port);
+        }
+        else if (valid && flag == "--threads")
+        {
+            valid = absl::SimpleAtoi(argv[i + 1], &server_options.threads);
+        }
+        else if (valid && flag == "--on-corruption")
+        {
+            // truncating drops a torn write left at the end of the active
+            // datafile by a crash, and whatever follows a corrupted record
+            std::string policy = argv[i + 1];
+            valid = policy == "fail" || policy == "truncate";
+            options.corruption_policy =
+                policy == "truncate" ? store::CorruptionPolicy::kTruncate : store::CorruptionPolicy::kFail;
+        }
+        else
+        {
+            valid = false;
+        }
+        if (!valid)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::filesystem::create_directories(db_path);
+    store::Store store(db_path, options);
+    absl::Status status = store.load_keydir();
+    if (!status.ok())
+    {
+        std::cerr << "Error loading keydir: " << status.message() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // the workers inherit the signal mask: the signals are only received by
+    // the sigwait below
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    absl::StatusOr<std::unique_ptr<store::Server>> server = store::Server::start(store, server_options);
+    if (!server.ok())
+    {
+        std::cerr << "Error: " << server.status().message() << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Serving " << store.kd_size() << " keys of " << db_path << " on " << server_options.bind_address
+              << ":" << (*server)->port() << std::endl;
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+    std::cout << "Received " << strsignal(signal) << ", stopping" << std::endl;
+    (*server)->stop();
+
+    return EXIT_SUCCESS;
+}
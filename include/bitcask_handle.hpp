@@ -10,6 +10,7 @@
 #define BITCASK_BITCASK_HANDLE_HPP_
 
 #include "absl/status/status.h"
+#include "bulk_reader.hpp"
 #include "store.hpp"
 #include <filesystem>
 #include <iostream>
@@ -28,7 +29,7 @@ class BitcaskHandle
     std::string db_path_; /** Path to the database directory */
     store::Store store_;  /** Store object to interact with the database */
   public:
-    explicit BitcaskHandle(const std::string &db_path);
+    explicit BitcaskHandle(const std::string &db_path, const store::Options &options = store::Options());
 
     /**
      * @brief Set a key-value pair in the database.
@@ -46,6 +47,31 @@ class BitcaskHandle
      */
     absl::StatusOr<std::string> get(const std::string &key);
 
+    /**
+     * @brief Get the value of a key without copying it out of the datafile
+     *        mapping when the store reads with store::ReadMode::kMmap.
+     *
+     * @param key
+     */
+    absl::StatusOr<store::ValueView> get_view(const std::string &key);
+
+    /**
+     * @brief Get the values of several keys with as few reads as possible.
+     *
+     * @param keys
+     */
+    std::vector<absl::StatusOr<std::string>> multi_get(std::span<const std::string_view> keys);
+
+    /**
+     * @brief Set a key to the next size bytes of a stream, and write the
+     *        value of a key to a stream, without holding the whole value in
+     *        memory.
+     *
+     * @param key
+     */
+    absl::Status put_stream(const std::string &key, std::istream &input, std::uint64_t size);
+    absl::Status get_stream(const std::string &key, std::ostream &output);
+
     /**
      * @brief Delete a key from the database.
      *
@@ -54,12 +80,54 @@ class BitcaskHandle
 
     absl::Status del(const std::string &key);
 
+    /**
+     * @brief Apply the sets and deletes of a batch atomically.
+     *
+     * @param batch
+     * @return absl::Status
+     */
+    absl::Status write(const store::WriteBatch &batch);
+
+    /**
+     * @brief Apply the sets and deletes of a stream with batched appends, see
+     *        store::bulk_load().
+     *
+     */
+    absl::StatusOr<store::BulkStats> load(std::istream &input, store::BulkFormat format,
+                                          std::size_t batch_bytes = 4 * 1024 * 1024);
+
+    /**
+     * @brief Awaitable get, set and delete. The coroutine suspends on the
+     *        I/O instead of blocking and is resumed on the executor.
+     *
+     * @param executor The executor driving the awaiting coroutine.
+     */
+    store::Task<absl::StatusOr<std::string>> co_get(store::Executor &executor, std::string key);
+    store::Task<absl::Status> co_set(store::Executor &executor, std::string key, std::string value);
+    store::Task<absl::Status> co_del(store::Executor &executor, std::string key);
+
     /**
      * @brief List all the keys in the database.
      *
      */
     absl::Status list() const;
 
+    /**
+     * @brief List the keys in [begin, end) or starting with a prefix, in
+     *        order. Needs store::Options::ordered_index.
+     *
+     */
+    absl::StatusOr<std::vector<std::string>> range(std::string_view begin, std::string_view end,
+                                                   std::size_t limit = 0) const;
+    absl::StatusOr<std::vector<std::string>> scan_prefix(std::string_view prefix, std::size_t limit = 0) const;
+
+    /**
+     * @brief Merge the datafiles to reclaim the space of overwritten and
+     *        deleted keys.
+     *
+     */
+    absl::Status merge();
+
     /**
      * @brief Display help message.
      *
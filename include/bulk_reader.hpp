@@ -0,0 +1,162 @@
+/**
+ * @file bulk_reader.hpp
+ * @author Lucas
+ * @brief BulkReader class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_BULK_READER_HPP_
+#define BITCASK_BULK_READER_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+
+namespace store
+{
+
+class Store;
+
+/**
+ * @enum BulkFormat
+ * @brief Layout of the records read by a BulkReader.
+ */
+enum class BulkFormat
+{
+    kCommands, /**< One command per line, "set <key> <value>" (the value is the
+                    rest of the line) or "del <key>", as typed in bitcask-cli */
+    kTsv,      /**< One "<key>\t<value>" per line, with \t, \n, \r and \\
+                    escaped in the keys and the values */
+    kBinary    /**< Key size and value size (4 bytes each, little-endian),
+                    then the key and the value, back to back. Sets only */
+};
+
+/**
+ * @brief Format named "commands", "tsv" or "binary".
+ */
+absl::StatusOr<BulkFormat> parse_bulk_format(std::string_view name);
+
+/**
+ * @struct BulkRecord
+ * @brief Set or delete read by a BulkReader. The key and the value point into
+ *        the reader until its next call.
+ */
+struct BulkRecord
+{
+    std::string_view key;
+    std::string_view value;
+    bool tombstone; /**< Deletes the key, value is empty */
+};
+
+/**
+ * @class BulkReader
+ * @brief Reads the records of a stream in large chunks and parses them in
+ *        place, so that loading costs neither a read nor an allocation per
+ *        record.
+ */
+class BulkReader
+{
+  private:
+    std::istream &input_;
+    BulkFormat format_;
+
+    // the buffer holds the unparsed bytes between begin_ and end_
+    std::string buffer_;
+    std::size_t begin_;
+    std::size_t end_;
+    bool eof_;
+    std::uint64_t offset_; /** Offset in the stream of begin_ */
+    std::uint64_t line_;   /** Number of the last line read, for the text formats */
+
+    std::string key_;   /** Unescaped key of a TSV record */
+    std::string value_; /** Unescaped value of a TSV record */
+
+    /**
+     * @brief Read until at least n bytes are buffered or the stream ends.
+     *
+     * @return bool Whether n bytes are buffered.
+     */
+    bool fill(std::size_t n);
+
+    /**
+     * @brief Read the next line, without its line break.
+     *
+     * @return bool false at the end of the stream.
+     */
+    bool next_line(std::string_view &line);
+
+    absl::Status parse_command(std::string_view line, BulkRecord &record);
+    absl::Status parse_tsv(std::string_view line, BulkRecord &record);
+    absl::Status next_binary(BulkRecord &record);
+
+    absl::Status error(std::string_view message) const;
+
+  public:
+    static const std::size_t DEFAULT_BUFFER_SIZE;
+
+    /**
+     * @param input Stream of records, read until its end.
+     * @param format Layout of the records.
+     * @param buffer_size Bytes read at once, grown for larger records.
+     */
+    BulkReader(std::istream &input, BulkFormat format, std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * @brief Parse the next record. Blank lines and lines starting with '#'
+     *        are skipped in the text formats.
+     *
+     * @param record Set to the record.
+     * @return absl::Status Status::OK, absl::OutOfRangeError at the end of
+     *         the stream or absl::InvalidArgumentError if the record is
+     *         malformed or truncated, with its line or offset.
+     */
+    absl::Status next(BulkRecord &record);
+
+    /**
+     * @brief Bytes of the stream parsed so far.
+     */
+    inline std::uint64_t offset() const
+    {
+        return offset_;
+    }
+};
+
+/**
+ * @struct BulkStats
+ * @brief Outcome of bulk_load().
+ */
+struct BulkStats
+{
+    std::uint64_t records = 0; /**< Sets and deletes applied */
+    std::uint64_t bytes = 0;   /**< Bytes of input read */
+    std::uint64_t batches = 0; /**< Store::write calls */
+    double seconds = 0;
+
+    inline double records_per_second() const
+    {
+        return seconds > 0 ? static_cast<double>(records) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Apply the records of a reader to a store with batched appends: the
+ *        records are gathered in a WriteBatch committed once it holds
+ *        batch_bytes of keys and values.
+ *
+ * @param store
+ * @param reader
+ * @param batch_bytes Bytes of keys and values per Store::write.
+ * @return absl::StatusOr<BulkStats> The statistics of the load, or the error
+ *         of the reader or of the store that stopped it. The batches written
+ *         before the error are kept.
+ */
+absl::StatusOr<BulkStats> bulk_load(Store &store, BulkReader &reader, std::size_t batch_bytes = 4 * 1024 * 1024);
+
+} // namespace store
+
+#endif // BITCASK_BULK_READER_HPP_
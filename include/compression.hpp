@@ -0,0 +1,119 @@
+/**
+ * @file compression.hpp
+ * @author Lucas
+ * @brief Compression enum and Compressor class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_COMPRESSION_HPP_
+#define BITCASK_COMPRESSION_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @enum Compression
+ * @brief Codec of the values written by the store. Every record is flagged
+ *        with its own codec, so datafiles mixing codecs stay readable.
+ */
+enum class Compression
+{
+    kNone, /**< Values are written as they are */
+    kLz4,  /**< LZ4 block format, fast with a modest ratio */
+    kZstd  /**< Zstandard, optionally with a trained dictionary */
+};
+
+/**
+ * @class Compressor
+ * @brief Compresses values with the codec of the store and decompresses
+ *        values of any codec. LZ4 and Zstd are optional dependencies: a codec
+ *        the library was built without is reported by is_available(), and
+ *        its records can't be read. Thread safe.
+ */
+class Compressor
+{
+  private:
+    struct ZstdDicts;
+
+    Compression codec_;
+    int level_;
+    std::unique_ptr<ZstdDicts> dicts_; /** Digested dictionary, if any */
+
+    Compressor(Compression codec, int level);
+
+  public:
+    /**
+     * @brief Create a compressor.
+     *
+     * @param codec Codec of the values compressed by compress().
+     * @param level Codec-specific level, 0 for the default of the codec.
+     *        Ignored by LZ4.
+     * @param dictionary Zstd dictionary (see train_dictionary()) used for
+     *        compressing with Compression::kZstd, and for decompressing the
+     *        values compressed with it. Empty for none.
+     * @return absl::StatusOr<std::unique_ptr<Compressor>> The compressor or
+     *         absl::FailedPreconditionError if a codec is not available.
+     */
+    static absl::StatusOr<std::unique_ptr<Compressor>> create(Compression codec, int level = 0,
+                                                              std::string_view dictionary = {});
+
+    ~Compressor();
+    Compressor(const Compressor &) = delete;
+    Compressor &operator=(const Compressor &) = delete;
+
+    /**
+     * @brief Whether the library was built with a codec.
+     */
+    static bool is_available(Compression codec);
+
+    /**
+     * @brief Train a Zstd dictionary on sample values, for compressing small
+     *        values that share a structure (e.g. JSON documents).
+     *
+     * @param samples Representative values, a few hundred at least.
+     * @param capacity Largest size of the dictionary, 16 to 112 KiB is usual.
+     * @return absl::StatusOr<std::string> The dictionary,
+     *         absl::FailedPreconditionError if Zstd is not available or
+     *         absl::InvalidArgumentError if the samples are not enough.
+     */
+    static absl::StatusOr<std::string> train_dictionary(const std::vector<std::string> &samples,
+                                                        std::size_t capacity);
+
+    /**
+     * @brief Compress a value, in place of out.
+     *
+     * @return Compression The codec of out, or Compression::kNone if the
+     *         value does not get smaller and must be stored as it is (out is
+     *         then left unspecified).
+     */
+    Compression compress(std::string_view value, std::string &out) const;
+
+    /**
+     * @brief Decompress a value, in place of out.
+     *
+     * @param codec The codec the value was compressed with.
+     * @return absl::Status Status::OK, absl::DataLossError if the value is
+     *         malformed or absl::FailedPreconditionError if the codec is not
+     *         available or the value needs a dictionary the compressor does
+     *         not have.
+     */
+    absl::Status decompress(Compression codec, std::string_view compressed, std::string &out) const;
+
+    inline Compression codec() const
+    {
+        return codec_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_COMPRESSION_HPP_
@@ -0,0 +1,54 @@
+/**
+ * @file crc32c.hpp
+ * @author Lucas
+ * @brief CRC32C (Castagnoli) checksum of the datafile records
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_CRC32C_HPP_
+#define BITCASK_CRC32C_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace crc32c
+{
+
+/**
+ * @brief Extend the CRC32C of some data with n more bytes. Uses the SSE4.2
+ *        crc32 instruction when the CPU has it, a table driven implementation
+ *        otherwise.
+ *
+ * @param crc CRC32C of the data so far, 0 for no data.
+ * @param data Bytes to append.
+ * @param n Number of bytes to append.
+ * @return std::uint32_t CRC32C of the data followed by the n bytes.
+ */
+std::uint32_t extend(std::uint32_t crc, const char *data, std::size_t n);
+
+/**
+ * @brief Table driven implementation of extend(), used when the CPU has no
+ *        crc32 instruction.
+ */
+std::uint32_t extend_portable(std::uint32_t crc, const char *data, std::size_t n);
+
+/**
+ * @brief Whether extend() uses the crc32 instruction.
+ */
+bool is_accelerated();
+
+inline std::uint32_t extend(std::uint32_t crc, std::string_view data)
+{
+    return extend(crc, data.data(), data.size());
+}
+
+inline std::uint32_t value(std::string_view data)
+{
+    return extend(0, data.data(), data.size());
+}
+
+} // namespace crc32c
+
+#endif // BITCASK_CRC32C_HPP_
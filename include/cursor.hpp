@@ -0,0 +1,123 @@
+/**
+ * @file cursor.hpp
+ * @author Lucas
+ * @brief Cursor class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_CURSOR_HPP_
+#define BITCASK_CURSOR_HPP_
+
+#include "absl/status/status.h"
+#include "keydir.hpp"
+#include "record.hpp"
+#include "record_reader.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace store
+{
+
+class Store;
+
+/**
+ * @class Cursor
+ * @brief Visits the live keys of a store and their values in datafile order,
+ *        reading the datafiles sequentially instead of once per key. A record
+ *        is visited if the keydir still points to it, so the overwritten
+ *        records, the tombstones and the records of unfinished batches are
+ *        skipped, as well as the expired keys.
+ *
+ *        Created by Store::scan(), which lists the datafiles: a key written
+ *        during the scan may be visited with its old value, its new one or
+ *        not at all, the other keys are visited exactly once. Merges wait for
+ *        the cursors to be destroyed. Not thread safe.
+ */
+class Cursor
+{
+  private:
+    const Store *store_;
+    std::vector<fileid_t> fileids_; /** Datafiles to read, in order */
+    std::size_t next_file_;         /** Index in fileids_ of the next datafile to open */
+    std::size_t buffer_size_;
+    std::unique_ptr<RecordReader> reader_; /** Reader of the current datafile */
+    fileid_t fileid_;
+    bool active_; /** The current datafile was active when opened, its last record may be in flight */
+
+    bool valid_;
+    record::View view_;
+    keydir::Entry entry_;
+    std::string value_; /** Decompressed value of the current record */
+    bool decoded_;      /** Whether the current value is value_ or the one of view_ */
+    absl::Status status_;
+
+    Cursor(const Store *store, std::vector<fileid_t> fileids, std::size_t buffer_size);
+
+    friend class Store;
+
+  public:
+    static const std::size_t DEFAULT_BUFFER_SIZE;
+
+    Cursor(Cursor &&other) noexcept;
+    Cursor(const Cursor &) = delete;
+    Cursor &operator=(const Cursor &) = delete;
+    Cursor &operator=(Cursor &&) = delete;
+    ~Cursor();
+
+    /**
+     * @brief Whether the cursor is on a key. False once every datafile was
+     *        read or an error stopped the scan, see status().
+     */
+    inline bool valid() const
+    {
+        return valid_;
+    }
+
+    /**
+     * @brief Move to the next live key.
+     */
+    void next();
+
+    /**
+     * @brief The current key, valid until next() is called.
+     */
+    inline std::string_view key() const
+    {
+        return view_.key;
+    }
+
+    /**
+     * @brief The current value, decompressed, valid until next() is called.
+     */
+    inline std::string_view value() const
+    {
+        return decoded_ ? std::string_view(value_) : view_.value;
+    }
+
+    /**
+     * @brief Keydir entry of the current key.
+     */
+    inline const keydir::Entry &entry() const
+    {
+        return entry_;
+    }
+
+    /**
+     * @brief Why the scan stopped early: absl::DataLossError if a record is
+     *        corrupted and Options::corruption_policy is kFail,
+     *        absl::InternalError if a datafile could not be read. Status::OK
+     *        otherwise.
+     */
+    inline const absl::Status &status() const
+    {
+        return status_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_CURSOR_HPP_
@@ -0,0 +1,201 @@
+/**
+ * @file datafile_writer.hpp
+ * @author Lucas
+ * @brief DatafileWriter class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_DATAFILE_WRITER_HPP_
+#define BITCASK_DATAFILE_WRITER_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace store
+{
+
+using fileid_t = uint32_t;
+namespace fs = std::filesystem;
+
+/**
+ * @enum SyncPolicy
+ * @brief When appended records are flushed to the device with fdatasync.
+ */
+enum class SyncPolicy
+{
+    kNone,     /**< Never, the OS decides when to write back the page cache */
+    kPerBatch, /**< Once per group commit batch, before the writers return */
+    kInterval  /**< Periodically from a background thread */
+};
+
+/**
+ * @class DatafileWriter
+ * @brief Long-lived append handle on a datafile. Concurrent calls to append()
+ *        are queued and the first writer in the queue (the leader) writes the
+ *        whole queue with a single pwritev, followed by at most one fdatasync
+ *        (group commit).
+ */
+class DatafileWriter
+{
+  public:
+    /** Called with the offset of the record once it has been written. Callbacks
+     *  run in the order of the records in the datafile. */
+    using Callback = std::function<void(std::uint64_t offset)>;
+
+    /** Produces the next piece of a streamed record, an empty piece once the
+     *  record is complete. */
+    using PieceSource = std::function<absl::StatusOr<std::string_view>()>;
+
+    /** Returns the bytes to write over the start of a streamed record once
+     *  all its pieces are written. */
+    using HeadCallback = std::function<std::string_view()>;
+
+  private:
+    struct Stream
+    {
+        const PieceSource *next;
+        const HeadCallback *head;
+    };
+
+    struct Request
+    {
+        std::string_view record;
+        std::uint64_t size = 0;         /** Size of the record, streamed or not */
+        const Stream *stream = nullptr; /** Set for a streamed record */
+        const Callback *on_written;
+        absl::Status status;
+        std::uint64_t offset = 0;
+        bool done = false;
+        std::condition_variable cv;
+    };
+
+    static const std::size_t MAX_BATCH_RECORDS;
+    static const std::size_t MAX_BATCH_BYTES;
+
+    int fd_;
+    fileid_t fileid_;
+    SyncPolicy sync_policy_;
+    std::chrono::milliseconds sync_interval_;
+
+    mutable std::mutex mutex_;
+    std::deque<Request *> queue_;
+    std::uint64_t size_;
+    bool dirty_;
+    bool closed_;
+    bool stop_flusher_;
+    absl::Status error_; /** Sticky error: the file tail is unknown after a failed write */
+
+    std::condition_variable flusher_cv_;
+    std::thread flusher_;
+
+    DatafileWriter(int fd, fileid_t fileid, std::uint64_t size, SyncPolicy sync_policy,
+                   std::chrono::milliseconds sync_interval);
+
+    /**
+     * @brief Write the records of a batch at the given offset.
+     */
+    absl::Status write_batch(const std::vector<Request *> &batch, std::uint64_t offset);
+
+    /**
+     * @brief Write a streamed record at the given offset. On error, the file
+     *        is truncated back to the offset.
+     */
+    absl::Status write_stream(const Request &req, std::uint64_t offset);
+
+    /**
+     * @brief Queue a request and wait until it is written.
+     */
+    absl::StatusOr<std::uint64_t> submit(Request &req);
+
+    void flusher_loop();
+
+  public:
+    /**
+     * @brief Open (or create) a datafile for appending.
+     *
+     * @param path Path of the datafile.
+     * @param fileid Id of the datafile.
+     * @param sync_policy When to fdatasync the appended records.
+     * @param sync_interval Period of the background sync for
+     *        SyncPolicy::kInterval.
+     * @return absl::StatusOr<std::unique_ptr<DatafileWriter>> The writer or
+     *         absl::InternalError if the file could not be opened.
+     */
+    static absl::StatusOr<std::unique_ptr<DatafileWriter>> open(
+        const fs::path &path, fileid_t fileid, SyncPolicy sync_policy = SyncPolicy::kNone,
+        std::chrono::milliseconds sync_interval = std::chrono::milliseconds(1000));
+
+    DatafileWriter(const DatafileWriter &) = delete;
+    DatafileWriter &operator=(const DatafileWriter &) = delete;
+    ~DatafileWriter();
+
+    /**
+     * @brief Append a record at the end of the datafile. Blocks until the
+     *        batch holding the record is written (and synced if the policy is
+     *        SyncPolicy::kPerBatch).
+     *
+     * @param record The encoded record.
+     * @param on_written Optional callback, see Callback.
+     * @return absl::StatusOr<std::uint64_t> The offset of the record or
+     *         absl::InternalError if the write failed.
+     */
+    absl::StatusOr<std::uint64_t> append(std::string_view record, const Callback &on_written = nullptr);
+
+    /**
+     * @brief Append a record too large to be held in memory, piece by piece.
+     *        The record is written alone rather than in a batch, and the
+     *        other appends wait until it is done, so next should not block
+     *        for long. Once the pieces are written, head() is written over the
+     *        start of the record, so that a header checksumming the whole
+     *        record can be filled in last.
+     *
+     * @param size Size of the record, the pieces must add up to it.
+     * @param next Produces the pieces, see PieceSource.
+     * @param head Produces the final start of the record, see HeadCallback.
+     * @param on_written Optional callback, see Callback.
+     * @return absl::StatusOr<std::uint64_t> The offset of the record, the
+     *         error of next, absl::InvalidArgumentError if the pieces do not
+     *         add up to size or absl::InternalError if the write failed.
+     *         Nothing is appended on error.
+     */
+    absl::StatusOr<std::uint64_t> append_stream(std::uint64_t size, const PieceSource &next, const HeadCallback &head,
+                                                const Callback &on_written = nullptr);
+
+    /**
+     * @brief Flush the appended records to the device.
+     */
+    absl::Status sync();
+
+    /**
+     * @brief Stop the background sync, sync the file unless the policy is
+     *        SyncPolicy::kNone and close it. Further appends fail.
+     */
+    absl::Status close();
+
+    inline fileid_t fileid() const
+    {
+        return fileid_;
+    }
+
+    inline std::uint64_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_DATAFILE_WRITER_HPP_
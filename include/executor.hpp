@@ -0,0 +1,230 @@
+/**
+ * @file executor.hpp
+ * @author Lucas
+ * @brief Executor and CallbackAwaiter classes declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_EXECUTOR_HPP_
+#define BITCASK_EXECUTOR_HPP_
+
+#include "task.hpp"
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+
+namespace store
+{
+
+/**
+ * @class Executor
+ * @brief Single-threaded run queue of coroutines. Coroutines suspended on
+ *        I/O are posted back to the executor by the thread completing the
+ *        I/O and resumed by the thread driving the executor, so the
+ *        coroutines of an executor never run concurrently. The executor is
+ *        driven either by run(), or by an event loop calling poll() whenever
+ *        the wakeup callback fires.
+ */
+class Executor
+{
+  private:
+    /**
+     * @struct Detached
+     * @brief Coroutine type of spawn(), destroyed when it finishes.
+     */
+    struct Detached
+    {
+        struct promise_type
+        {
+            Detached get_return_object() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() noexcept
+            {
+            }
+
+            void unhandled_exception() noexcept
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_; /** Coroutines to resume, in posting order */
+    std::function<void()> wakeup_;
+    std::size_t spawned_; /** Spawned tasks not finished yet, only used by the driving thread */
+
+    static Detached drive(Executor &executor, Task<void> task);
+
+    template <typename T> static Task<void> store_result(Task<T> task, std::optional<T> &result)
+    {
+        result.emplace(co_await task);
+    }
+
+    static Task<void> store_done(Task<void> task, bool &done)
+    {
+        co_await task;
+        done = true;
+    }
+
+  public:
+    /**
+     * @brief Awaitable moving the awaiting coroutine to the executor.
+     */
+    struct ScheduleAwaiter
+    {
+        Executor &executor;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            executor.post(handle);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    /**
+     * @param wakeup Optional, called (from any thread) when a coroutine
+     *        becomes ready while the queue was empty, so that an event loop
+     *        can schedule a call to poll(). It runs under the executor lock
+     *        and must not call into the executor.
+     */
+    explicit Executor(std::function<void()> wakeup = nullptr);
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    /**
+     * @brief Queue a coroutine to be resumed by the driving thread. Thread
+     *        safe.
+     */
+    void post(std::coroutine_handle<> handle);
+
+    inline ScheduleAwaiter schedule()
+    {
+        return ScheduleAwaiter{*this};
+    }
+
+    /**
+     * @brief Start a task on the executor without waiting for it. The task
+     *        must be finished before the executor is destroyed, see
+     *        spawned().
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * @brief Resume the coroutines that are ready, without blocking.
+     *
+     * @return std::size_t Number of coroutines resumed.
+     */
+    std::size_t poll();
+
+    /**
+     * @brief Block until a coroutine is ready and resume it.
+     */
+    void run_one();
+
+    /**
+     * @brief Run a task to completion, driving the executor from the calling
+     *        thread in the meantime.
+     *
+     * @return T The result of the task.
+     */
+    template <typename T> T run(Task<T> task)
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            bool done = false;
+            spawn(store_done(std::move(task), done));
+            while (!done)
+            {
+                run_one();
+            }
+        }
+        else
+        {
+            std::optional<T> result;
+            spawn(store_result(std::move(task), result));
+            while (!result.has_value())
+            {
+                run_one();
+            }
+            return std::move(*result);
+        }
+    }
+
+    inline std::size_t spawned() const
+    {
+        return spawned_;
+    }
+};
+
+/**
+ * @class CallbackAwaiter
+ * @brief Awaitable over a callback-based asynchronous operation: the
+ *        operation is started when the coroutine suspends and the coroutine
+ *        is resumed on the executor with the value passed to the callback.
+ */
+template <typename T> class CallbackAwaiter
+{
+  public:
+    using Start = std::function<void(std::function<void(T)> done)>;
+
+  private:
+    Executor &executor_;
+    Start start_;
+    std::optional<T> result_;
+
+  public:
+    CallbackAwaiter(Executor &executor, Start start) : executor_(executor), start_(std::move(start))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        start_([this, handle](T result) {
+            result_.emplace(std::move(result));
+            executor_.post(handle);
+        });
+    }
+
+    T await_resume()
+    {
+        return std::move(*result_);
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_EXECUTOR_HPP_
@@ -0,0 +1,143 @@
+/**
+ * @file fd_cache.hpp
+ * @author Lucas
+ * @brief ReadableFile and FdCache classes declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_FD_CACHE_HPP_
+#define BITCASK_FD_CACHE_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sys/uio.h>
+#include <unordered_map>
+
+namespace store
+{
+
+using fileid_t = uint32_t;
+namespace fs = std::filesystem;
+
+/**
+ * @class ReadableFile
+ * @brief Read-only descriptor on a datafile. Reads are positional so a single
+ *        descriptor can be shared by concurrent readers.
+ */
+class ReadableFile
+{
+  private:
+    int fd_;
+    fileid_t fileid_;
+
+  public:
+    ReadableFile(int fd, fileid_t fileid);
+    ReadableFile(const ReadableFile &) = delete;
+    ReadableFile &operator=(const ReadableFile &) = delete;
+    ~ReadableFile();
+
+    /**
+     * @brief Open a datafile for reading.
+     *
+     * @param path Path of the datafile.
+     * @param fileid Id of the datafile.
+     * @return absl::StatusOr<std::shared_ptr<ReadableFile>> The file,
+     *         absl::NotFoundError if it does not exist or absl::InternalError
+     *         if it could not be opened.
+     */
+    static absl::StatusOr<std::shared_ptr<ReadableFile>> open(const fs::path &path, fileid_t fileid);
+
+    /**
+     * @brief Read exactly n bytes at the given offset.
+     *
+     * @param buf Destination buffer, at least n bytes long.
+     * @param n Number of bytes to read.
+     * @param offset Position of the first byte in the file.
+     * @return absl::Status Status::OK, absl::OutOfRangeError if the file is
+     *         shorter than offset + n or absl::InternalError if the read
+     *         failed.
+     */
+    absl::Status pread(char *buf, std::size_t n, std::uint64_t offset) const;
+
+    /**
+     * @brief Fill the buffers of iov, in order, with the bytes starting at
+     *        the given offset. A single preadv call is issued per IOV_MAX
+     *        buffers, short reads are resumed.
+     *
+     * @param iov Destination buffers. The entries are advanced past the bytes
+     *        read, so their content is unspecified on return.
+     * @param offset Position of the first byte in the file.
+     * @return absl::Status Status::OK, absl::OutOfRangeError if the file ends
+     *         before the buffers are filled or absl::InternalError if the
+     *         read failed.
+     */
+    absl::Status preadv(std::span<iovec> iov, std::uint64_t offset) const;
+
+    inline int fd() const
+    {
+        return fd_;
+    }
+
+    inline fileid_t fileid() const
+    {
+        return fileid_;
+    }
+};
+
+/**
+ * @class FdCache
+ * @brief Bounded cache of read-only datafile descriptors, evicting the least
+ *        recently used one when full. Evicted descriptors stay open until the
+ *        last reader holding them is done.
+ */
+class FdCache
+{
+  private:
+    using LruList = std::list<fileid_t>;
+
+    struct Slot
+    {
+        std::shared_ptr<const ReadableFile> file;
+        LruList::iterator lru_pos;
+    };
+
+    std::size_t capacity_;
+    std::mutex mutex_;
+    LruList lru_; /** Most recently used first */
+    std::unordered_map<fileid_t, Slot> files_;
+
+  public:
+    explicit FdCache(std::size_t capacity);
+
+    /**
+     * @brief Get the descriptor of a datafile, opening it on a cache miss.
+     *
+     * @param fileid Id of the datafile.
+     * @param path Path of the datafile, used on a cache miss.
+     * @return absl::StatusOr<std::shared_ptr<const ReadableFile>> The file or
+     *         the error of ReadableFile::open.
+     */
+    absl::StatusOr<std::shared_ptr<const ReadableFile>> get(fileid_t fileid, const fs::path &path);
+
+    /**
+     * @brief Drop the descriptor of a datafile from the cache, if present.
+     */
+    void evict(fileid_t fileid);
+
+    inline std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_.size();
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_FD_CACHE_HPP_
@@ -0,0 +1,83 @@
+/**
+ * @file file_util.hpp
+ * @author Lucas
+ * @brief Helpers shared by the code writing files of the database directory
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_FILE_UTIL_HPP_
+#define BITCASK_FILE_UTIL_HPP_
+
+#include "absl/status/status.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace store
+{
+
+namespace fs = std::filesystem;
+
+// Datafiles and hint files start with a file header: a magic number telling
+// them apart (4 bytes), then the version of their format (4 bytes,
+// little-endian). Files of another format are rejected, not read as corrupted.
+inline constexpr std::size_t FILE_HEADER_SIZE = 8;
+inline constexpr std::uint32_t FORMAT_VERSION = 1;
+inline constexpr std::string_view DATAFILE_MAGIC = "BCDF";
+inline constexpr std::string_view HINTFILE_MAGIC = "BCHF";
+
+/**
+ * @brief Append the file header of the current format to a buffer.
+ *
+ * @param magic DATAFILE_MAGIC or HINTFILE_MAGIC.
+ */
+void append_file_header(std::string &buffer, std::string_view magic);
+
+/**
+ * @brief Check the file header at the start of a file.
+ *
+ * @param bytes The first bytes of the file, FILE_HEADER_SIZE or less if the
+ *        file is shorter.
+ * @param magic The magic number of the kind of file expected.
+ * @param name Name of the file, for the errors.
+ * @return absl::Status Status::OK, absl::DataLossError if the header is cut
+ *         short or absl::FailedPreconditionError if the file is not of this
+ *         kind or of another version of the format, e.g. written before the
+ *         files had a header.
+ */
+absl::Status check_file_header(std::string_view bytes, std::string_view magic, const std::string &name);
+
+/**
+ * @brief Write a file and make it durable: the content is written to a
+ *        temporary file, synced and renamed over the destination, then the
+ *        directory is synced. Readers see either the old or the new content.
+ *
+ * @param path Destination of the file.
+ * @param content Content of the file.
+ * @return absl::Status Status::OK or absl::InternalError if a step failed.
+ */
+absl::Status write_file_durably(const fs::path &path, std::string_view content);
+
+/**
+ * @brief Sync a directory, making the files created, renamed or removed in
+ *        it durable.
+ *
+ * @return absl::Status Status::OK or absl::InternalError if the directory
+ *         could not be opened or synced.
+ */
+absl::Status sync_directory(const fs::path &path);
+
+/**
+ * @brief Remove the write permissions of a file.
+ *
+ * @return absl::Status Status::OK or absl::InternalError if the permissions
+ *         could not be changed.
+ */
+absl::Status seal_file(const fs::path &path);
+
+} // namespace store
+
+#endif // BITCASK_FILE_UTIL_HPP_
@@ -0,0 +1,71 @@
+/**
+ * @file hintfile.hpp
+ * @author Lucas
+ * @brief Hint files: the keydir entries of a sealed datafile, without values
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_HINTFILE_HPP_
+#define BITCASK_HINTFILE_HPP_
+
+#include "absl/status/status.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace hintfile
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * @struct Entry
+ * @brief Represents an entry of a hint file: the key and position of a record
+ * of the datafile, whether the record is a tombstone and when it expires. The
+ * file id is the one of the datafile the hint file belongs to.
+ */
+struct Entry
+{
+    std::string key;
+    std::uint32_t vsz;
+    std::uint64_t vpos;
+    bool tombstone;
+    std::uint8_t flags = 0;   /** keydir::Entry::flags of the record */
+    std::uint32_t expiry = 0; /** keydir::Entry::expiry of the record */
+
+    bool operator==(const Entry &other) const
+    {
+        return key == other.key && vsz == other.vsz && vpos == other.vpos && tombstone == other.tombstone &&
+               flags == other.flags && expiry == other.expiry;
+    }
+};
+
+/**
+ * @brief Write a hint file, atomically replacing any previous one.
+ *
+ * @param path Path of the hint file.
+ * @param entries Entries in the order of the records in the datafile.
+ * @return absl::Status Status::OK or absl::InternalError if the file could
+ *         not be written.
+ */
+absl::Status write(const fs::path &path, const std::vector<Entry> &entries);
+
+/**
+ * @brief Read the entries of a hint file in order.
+ *
+ * @param path Path of the hint file.
+ * @param callback Called for each entry, a non-OK status stops the read.
+ * @return absl::Status Status::OK, the status returned by the callback,
+ *         absl::NotFoundError if the file does not exist,
+ *         absl::DataLossError if it is malformed or an entry fails its
+ *         checksum, or absl::FailedPreconditionError if it is of another
+ *         format. The entries before the error were passed to the callback.
+ */
+absl::Status read(const fs::path &path, const std::function<absl::Status(const Entry &)> &callback);
+
+} // namespace hintfile
+
+#endif // BITCASK_HINTFILE_HPP_
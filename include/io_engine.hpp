@@ -0,0 +1,145 @@
+/**
+ * @file io_engine.hpp
+ * @author Lucas
+ * @brief IoEngine class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_IO_ENGINE_HPP_
+#define BITCASK_IO_ENGINE_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "fd_cache.hpp"
+#include "thread_pool.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sys/uio.h>
+#include <thread>
+
+namespace store
+{
+
+/**
+ * @enum IoBackend
+ * @brief How the asynchronous reads of the store are performed.
+ */
+enum class IoBackend
+{
+    kAuto,      /**< io_uring when the kernel allows it, the thread pool otherwise */
+    kIoUring,   /**< io_uring only, the engine cannot be created without it */
+    kThreadPool /**< Blocking preads on a pool of threads */
+};
+
+class IoUring;
+
+/**
+ * @class IoEngine
+ * @brief Runs the asynchronous operations of a store. Reads are submitted to
+ *        an io_uring instance and completed by a single reaper thread, which
+ *        keeps up to queue_depth reads in flight; further reads wait in a
+ *        backlog. Without io_uring the reads are blocking preads on the
+ *        thread pool, which also runs the tasks passed to run().
+ */
+class IoEngine
+{
+  public:
+    /** Called once a read completed, from the reaper thread or a pool
+     *  thread. Callbacks should not block as they delay the other
+     *  completions. */
+    using Callback = std::function<void(absl::Status status)>;
+
+  private:
+    struct ReadOp
+    {
+        std::shared_ptr<const ReadableFile> file; /** Keeps the descriptor open until the read completes */
+        iovec iov;                                /** Bytes left to read */
+        std::uint64_t offset;
+        Callback done;
+    };
+
+    std::unique_ptr<IoUring> ring_; /** nullptr for IoBackend::kThreadPool */
+    unsigned queue_depth_;
+    ThreadPool pool_;
+
+    std::mutex mutex_; /** Guards the submission queue and the fields below */
+    unsigned in_flight_;
+    std::deque<ReadOp *> backlog_; /** Reads waiting for a free slot in the ring */
+    bool stopping_;
+    std::condition_variable reaper_cv_; /** Wakes the reaper up while no read is in flight */
+    std::thread reaper_;
+
+    /**
+     * @brief Queue a read in the ring. mutex_ must be held.
+     */
+    absl::Status submit(ReadOp *op);
+
+    /**
+     * @brief Release the slot of a read and call its callback.
+     */
+    void finish(ReadOp *op, absl::Status status);
+
+    void reaper_loop();
+
+  public:
+    IoEngine(std::unique_ptr<IoUring> ring, unsigned queue_depth, std::size_t n_threads);
+    IoEngine(const IoEngine &) = delete;
+    IoEngine &operator=(const IoEngine &) = delete;
+
+    /**
+     * @brief Wait for the reads in flight and the queued tasks, then stop
+     *        the threads.
+     */
+    ~IoEngine();
+
+    /**
+     * @brief Create an engine.
+     *
+     * @param backend Requested backend.
+     * @param queue_depth Reads kept in flight by the io_uring backend.
+     * @param n_threads Threads of the pool, 0 for one per hardware thread.
+     * @return absl::StatusOr<std::unique_ptr<IoEngine>> The engine or
+     *         absl::UnavailableError if IoBackend::kIoUring was requested
+     *         and io_uring cannot be used.
+     */
+    static absl::StatusOr<std::unique_ptr<IoEngine>> create(IoBackend backend, unsigned queue_depth,
+                                                            std::size_t n_threads);
+
+    /**
+     * @brief Read exactly n bytes at the given offset of a file.
+     *
+     * @param file The file, kept open until the read completes.
+     * @param buf Destination buffer, at least n bytes long, valid until the
+     *        callback runs.
+     * @param n Number of bytes to read.
+     * @param offset Position of the first byte in the file.
+     * @param done Called with Status::OK, absl::OutOfRangeError if the file
+     *        is shorter than offset + n or absl::InternalError if the read
+     *        failed.
+     */
+    void read(std::shared_ptr<const ReadableFile> file, char *buf, std::size_t n, std::uint64_t offset,
+              Callback done);
+
+    /**
+     * @brief Run a blocking task on the thread pool.
+     */
+    void run(std::function<void()> task);
+
+    /**
+     * @brief The backend in use, IoBackend::kIoUring or
+     *        IoBackend::kThreadPool.
+     */
+    inline IoBackend backend() const
+    {
+        return ring_ != nullptr ? IoBackend::kIoUring : IoBackend::kThreadPool;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_IO_ENGINE_HPP_
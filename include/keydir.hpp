@@ -9,11 +9,17 @@
 #ifndef BITCASK_KEYDIR_HPP_
 #define BITCASK_KEYDIR_HPP_
 
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
 using fileid_t = uint32_t; // -> TODO: bad practice ? fileid_t is also defined
                            // in store.hpp. I don't know how to use the one
@@ -25,57 +31,256 @@ namespace keydir
 
 /**
  * @struct Entry
- * @brief Represents entry in the keydir. Contains file id, value size, and
- * value position. Also provides an equality operator to compare two entries.
+ * @brief Represents entry in the keydir. Contains file id, value size (as
+ * stored, i.e. compressed), position of the record in the datafile and the
+ * flags of the record needed to decode its value and its expiry time. Also
+ * provides an equality operator to compare two entries.
  */
 struct Entry
 {
     fileid_t fileid;
-    std::uint16_t vsz;
-    std::uint16_t vpos;
+    std::uint32_t vsz;
+    std::uint64_t vpos;
+    std::uint8_t flags = 0;   /** Store::FLAG_* bits describing the value */
+    std::uint32_t expiry = 0; /** Seconds since the epoch at which the key expires, 0 for never */
 
     bool operator==(const Entry &other) const
     {
-        return fileid == other.fileid && vsz == other.vsz && vpos == other.vpos;
+        return fileid == other.fileid && vsz == other.vsz && vpos == other.vpos && flags == other.flags &&
+               expiry == other.expiry;
+    }
+
+    inline bool expired(std::uint32_t now) const
+    {
+        return expiry != 0 && expiry <= now;
     }
 };
 
 /**
- * @class KeyDir
- * @brief Represents the keydir. Contains an unordered map of key (std::string)
- * to entries (store::keydir::Entry) and provides methods to set, get, and
- * delete pairs of key and entry. Also provides methods to get the size of the
- * keydir and to iterate over the keydir.
+ * @class KeyArena
+ * @brief Append-only storage for the keys of a keydir shard. Keys are packed
+ *        back to back in blocks, so a key costs its bytes and nothing more,
+ *        and the views handed out stay valid until the arena is destroyed.
+ *        Blocks grow with the arena up to BLOCK_SIZE, so that the many
+ *        shards of a small keydir stay small.
  */
-class KeyDir
+class KeyArena
 {
   private:
-    std::unordered_map<std::string, Entry> keydir_; // UnorderedMap[key: string] -> KeyDirEntry
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::size_t block_size_;      /** Size of the last block */
+    std::size_t block_used_;      /** Bytes used in the last block */
+    std::size_t allocated_bytes_; /** Bytes of all the blocks */
 
   public:
-    KeyDir();
+    static const std::size_t MIN_BLOCK_SIZE;
+    static const std::size_t BLOCK_SIZE;
+
+    KeyArena();
 
-    absl::Status set(const std::string &key, const Entry &entry);
-    absl::StatusOr<Entry> get(const std::string &key) const;
-    absl::Status del(const std::string &key);
+    /**
+     * @brief Copy a key into the arena.
+     */
+    std::string_view add(std::string_view key);
 
-    inline std::size_t size() const
+    inline std::size_t allocated_bytes() const
     {
-        return keydir_.size();
+        return allocated_bytes_;
     }
+};
+
+/**
+ * @struct Stats
+ * @brief Memory used by a keydir.
+ */
+struct Stats
+{
+    std::size_t keys = 0;
+    std::size_t table_bytes = 0; /**< Slots and control bytes of the hash tables */
+    std::size_t arena_bytes = 0; /**< Blocks of the key arenas */
+    std::size_t dead_bytes = 0;  /**< Arena bytes of deleted keys, reclaimed by compaction */
 
-    inline auto begin() const
+    inline double bytes_per_key() const
     {
-        return keydir_.begin();
+        return keys > 0 ? static_cast<double>(table_bytes + arena_bytes) / static_cast<double>(keys) : 0.0;
     }
+};
 
-    inline auto end() const
+/**
+ * @class KeyDir
+ * @brief Represents the keydir. Maps keys to entries (store::keydir::Entry)
+ * and provides methods to set, get, and delete pairs of key and entry. Also
+ * provides methods to get the size and the memory usage of the keydir. The
+ * keys are hashed into shards, each with its own reader-writer lock, so that
+ * readers and writers of different keys rarely contend. Each shard is a flat
+ * open-addressing table (absl::flat_hash_map, probing groups of slots with
+ * SIMD) of key views into a KeyArena, so that a key costs no allocation of
+ * its own. Lookups take a std::string_view and never build a std::string.
+ *
+ * Optionally, the keys are also kept in sorted order in a B-tree, so that the
+ * keys of a range are listed in O(log n + k) instead of walking the shards.
+ */
+class KeyDir
+{
+  private:
+    /**
+     * @struct Shard
+     * @brief Part of the keydir, on its own cache line to avoid false sharing
+     *        between the locks.
+     */
+    struct alignas(64) Shard
     {
-        return keydir_.end();
+        mutable std::shared_mutex mutex;
+        absl::flat_hash_map<std::string_view, Entry> entries; // FlatHashMap[key: arena view] -> KeyDirEntry
+        std::unique_ptr<KeyArena> arena = std::make_unique<KeyArena>();
+        std::size_t dead_bytes = 0; /** Arena bytes of the deleted keys */
+        std::size_t live_bytes = 0; /** Arena bytes of the keys in entries */
+
+        /**
+         * @brief Set the entry of a key. The mutex must be held exclusively.
+         */
+        void put(std::string_view key, const Entry &entry);
+
+        /**
+         * @brief Delete the entry of a key. The mutex must be held
+         *        exclusively.
+         *
+         * @return bool false if the key does not exist.
+         */
+        bool erase(std::string_view key);
+
+        /**
+         * @brief Copy the live keys to a new arena once the deleted keys use
+         *        more of it than the live ones. The mutex must be held
+         *        exclusively.
+         */
+        void maybe_compact();
+    };
+
+    /**
+     * @struct OrderedIndex
+     * @brief Sorted copy of the keys, with their expiry to skip the expired
+     *        ones. Updated while the shard of the key is locked, so that it
+     *        matches the shards once the writes return.
+     */
+    struct OrderedIndex
+    {
+        mutable std::shared_mutex mutex;
+        absl::btree_map<std::string, std::uint32_t, std::less<>> keys; // BTreeMap[key] -> Entry::expiry
+
+        void put(std::string_view key, std::uint32_t expiry);
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t shard_mask_;
+    std::unique_ptr<OrderedIndex> index_; /** nullptr unless the keydir is ordered */
+
+    std::size_t shard_index(std::string_view key) const;
+
+    inline Shard &shard(std::string_view key) const
+    {
+        return shards_[shard_index(key)];
     }
-    inline auto find(const std::string &key) const
+
+  public:
+    /**
+     * @struct Update
+     * @brief Set or delete of a key, see apply().
+     */
+    struct Update
+    {
+        std::string_view key;
+        Entry entry;
+        bool remove; /**< Delete the key, entry is unused */
+    };
+
+    static const std::size_t DEFAULT_SHARDS;
+
+    /**
+     * @param n_shards Number of shards, rounded up to a power of two.
+     * @param ordered Keep the keys sorted for range(), which costs a second
+     *        copy of every key and a B-tree update per write.
+     */
+    explicit KeyDir(std::size_t n_shards = DEFAULT_SHARDS, bool ordered = false);
+
+    absl::Status set(std::string_view key, const Entry &entry);
+    absl::StatusOr<Entry> get(std::string_view key) const;
+    absl::Status del(std::string_view key);
+
+    /**
+     * @brief Replace the entry of a key only if it is still the expected one
+     *        (compare-and-swap), e.g. when a merge moves a record that may
+     *        have been overwritten or deleted in the meantime.
+     *
+     * @return bool true if the entry was replaced.
+     */
+    bool replace_if(std::string_view key, const Entry &expected, const Entry &replacement);
+
+    /**
+     * @brief Delete a key only if its entry is still the expected one, see
+     *        replace_if().
+     *
+     * @return bool true if the key was deleted.
+     */
+    bool erase_if(std::string_view key, const Entry &expected);
+
+    /**
+     * @brief Delete the keys expired at a given time (see Entry::expiry),
+     *        one shard after the other.
+     *
+     * @param now Seconds since the epoch.
+     * @return std::size_t Number of keys deleted.
+     */
+    std::size_t erase_expired(std::uint32_t now);
+
+    bool contains(std::string_view key) const;
+
+    /**
+     * @brief Apply several updates at once: the shards of all the keys are
+     *        locked together, so readers see either none or all of the
+     *        updates. Later updates of a key override earlier ones.
+     */
+    void apply(const std::vector<Update> &updates);
+
+    /**
+     * @brief Snapshot of the keys of the keydir. The shards are visited one
+     *        after the other, so concurrent writes may or may not be seen.
+     */
+    std::vector<std::string> keys() const;
+
+    /**
+     * @brief Keys in [begin, end), in lexicographic order. Needs an ordered
+     *        keydir.
+     *
+     * @param begin First key, inclusive.
+     * @param end Last key, exclusive, empty for no bound.
+     * @param limit Maximum number of keys, 0 for no limit.
+     * @param now Seconds since the epoch, the keys expired at this time are
+     *        skipped.
+     * @return absl::StatusOr<std::vector<std::string>> The keys or
+     *         absl::FailedPreconditionError if the keydir is not ordered.
+     */
+    absl::StatusOr<std::vector<std::string>> range(std::string_view begin, std::string_view end, std::size_t limit,
+                                                   std::uint32_t now) const;
+
+    inline bool ordered() const
+    {
+        return index_ != nullptr;
+    }
+
+    /**
+     * @brief Number of keys, summed over the shards.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Memory used by the tables and the arenas of the shards.
+     */
+    Stats stats() const;
+
+    inline std::size_t shard_count() const
     {
-        return keydir_.find(key);
+        return shard_mask_ + 1;
     }
 };
 
@@ -0,0 +1,174 @@
+/**
+ * @file mapped_file.hpp
+ * @author Lucas
+ * @brief MappedFile, ValueView and MmapCache classes declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_MAPPED_FILE_HPP_
+#define BITCASK_MAPPED_FILE_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace store
+{
+
+using fileid_t = uint32_t;
+namespace fs = std::filesystem;
+
+/**
+ * @enum MadvisePolicy
+ * @brief Access pattern advertised to the kernel for a mapped datafile.
+ */
+enum class MadvisePolicy
+{
+    kNormal,    /**< MADV_NORMAL: default readahead */
+    kRandom,    /**< MADV_RANDOM: no readahead, suits point lookups */
+    kSequential /**< MADV_SEQUENTIAL: aggressive readahead, suits scans */
+};
+
+/**
+ * @class MappedFile
+ * @brief Read-only memory mapping of a whole (sealed) datafile. The mapping
+ *        lives as long as the object, so holders of a shared_ptr pin it.
+ */
+class MappedFile
+{
+  private:
+    const char *data_;
+    std::size_t size_;
+    fileid_t fileid_;
+
+  public:
+    MappedFile(const char *data, std::size_t size, fileid_t fileid);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    /**
+     * @brief Map a datafile in memory.
+     *
+     * @param path Path of the datafile.
+     * @param fileid Id of the datafile.
+     * @param policy Access pattern passed to madvise.
+     * @return absl::StatusOr<std::shared_ptr<MappedFile>> The mapping,
+     *         absl::NotFoundError if the file does not exist or
+     *         absl::InternalError if it could not be mapped.
+     */
+    static absl::StatusOr<std::shared_ptr<MappedFile>> open(const fs::path &path, fileid_t fileid,
+                                                            MadvisePolicy policy);
+
+    /**
+     * @brief View n bytes of the mapping starting at offset.
+     *
+     * @return absl::StatusOr<std::string_view> The bytes or
+     *         absl::OutOfRangeError if they are not all in the file.
+     */
+    absl::StatusOr<std::string_view> view(std::uint64_t offset, std::size_t n) const;
+
+    inline std::size_t size() const
+    {
+        return size_;
+    }
+
+    inline fileid_t fileid() const
+    {
+        return fileid_;
+    }
+};
+
+/**
+ * @class ValueView
+ * @brief Non-owning view on a value, valid as long as the ValueView lives.
+ *        The bytes either point into a pinned MappedFile or, for values that
+ *        are not served from a mapping, into a string owned by the view.
+ */
+class ValueView
+{
+  private:
+    std::shared_ptr<const MappedFile> pin_;
+    std::string_view mapped_;
+    std::string owned_;
+
+  public:
+    ValueView(std::shared_ptr<const MappedFile> pin, std::string_view bytes) : pin_(std::move(pin)), mapped_(bytes)
+    {
+    }
+
+    explicit ValueView(std::string owned) : owned_(std::move(owned))
+    {
+    }
+
+    inline std::string_view view() const
+    {
+        return pin_ != nullptr ? mapped_ : std::string_view(owned_);
+    }
+
+    inline operator std::string_view() const
+    {
+        return view();
+    }
+
+    inline const char *data() const
+    {
+        return view().data();
+    }
+
+    inline std::size_t size() const
+    {
+        return view().size();
+    }
+
+    /**
+     * @brief Whether the bytes are served from a memory mapping (zero copy).
+     */
+    inline bool is_mapped() const
+    {
+        return pin_ != nullptr;
+    }
+};
+
+/**
+ * @class MmapCache
+ * @brief Mappings of the sealed datafiles, created on first access. Mappings
+ *        only cost address space, so they are kept until evicted.
+ */
+class MmapCache
+{
+  private:
+    MadvisePolicy policy_;
+    std::mutex mutex_;
+    std::unordered_map<fileid_t, std::shared_ptr<const MappedFile>> files_;
+
+  public:
+    explicit MmapCache(MadvisePolicy policy);
+
+    /**
+     * @brief Get the mapping of a datafile, mapping it on a cache miss.
+     *
+     * @param fileid Id of the datafile.
+     * @param path Path of the datafile, used on a cache miss.
+     * @return absl::StatusOr<std::shared_ptr<const MappedFile>> The mapping
+     *         or the error of MappedFile::open.
+     */
+    absl::StatusOr<std::shared_ptr<const MappedFile>> get(fileid_t fileid, const fs::path &path);
+
+    /**
+     * @brief Drop the mapping of a datafile, if present. Pinned views stay
+     *        valid.
+     */
+    void evict(fileid_t fileid);
+};
+
+} // namespace store
+
+#endif // BITCASK_MAPPED_FILE_HPP_
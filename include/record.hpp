@@ -0,0 +1,141 @@
+/**
+ * @file record.hpp
+ * @author Lucas
+ * @brief On-disk layout of the datafile records
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_RECORD_HPP_
+#define BITCASK_RECORD_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace record
+{
+
+// Layout of a record, all integers little-endian: CRC32C of the rest of the
+// record (4 bytes), timestamp (4 bytes), ksz (2 bytes), vsz (4 bytes), flags
+// (1 byte), key (ksz bytes), value (vsz bytes)
+inline constexpr std::size_t CRC_SIZE = 4;
+inline constexpr std::size_t TIMESTAMP_SIZE = 4;
+inline constexpr std::size_t KSZ_SIZE = 2;
+inline constexpr std::size_t VSZ_SIZE = 4;
+inline constexpr std::size_t FLAGS_SIZE = 1;
+inline constexpr std::size_t HEADER_SIZE = CRC_SIZE + TIMESTAMP_SIZE + KSZ_SIZE + VSZ_SIZE + FLAGS_SIZE;
+
+/**
+ * @struct Header
+ * @brief Fixed-size part of a record.
+ */
+struct Header
+{
+    std::uint32_t crc;       /**< CRC32C of the rest of the header, the key and the value */
+    std::uint32_t timestamp; /**< Seconds since the epoch: expiry time of the records flagged
+                                  Store::FLAG_EXPIRING, write time of the others */
+    std::uint16_t ksz;       /**< key size */
+    std::uint32_t vsz;       /**< value size */
+    std::uint8_t flags;      /**< Store::FLAG_* bits */
+};
+
+/**
+ * @struct View
+ * @brief Record parsed in place: the key and the value point into the parsed
+ *        bytes.
+ */
+struct View
+{
+    Header header;
+    std::string_view key;
+    std::string_view value;
+
+    inline std::size_t size() const
+    {
+        return HEADER_SIZE + key.size() + value.size();
+    }
+};
+
+/**
+ * @brief Outcome of parse().
+ */
+enum class ParseResult
+{
+    kOk,        /**< A whole record was parsed */
+    kTruncated, /**< The bytes end before the record does */
+    kCorrupted  /**< The checksum of the record does not match */
+};
+
+inline void store_le16(char *out, std::uint16_t value)
+{
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+}
+
+inline void store_le32(char *out, std::uint32_t value)
+{
+    store_le16(out, static_cast<std::uint16_t>(value));
+    store_le16(out + 2, static_cast<std::uint16_t>(value >> 16));
+}
+
+inline void store_le64(char *out, std::uint64_t value)
+{
+    store_le32(out, static_cast<std::uint32_t>(value));
+    store_le32(out + 4, static_cast<std::uint32_t>(value >> 32));
+}
+
+inline std::uint16_t load_le16(const char *in)
+{
+    return static_cast<std::uint16_t>(static_cast<unsigned char>(in[0]) |
+                                      static_cast<unsigned char>(in[1]) << 8);
+}
+
+inline std::uint32_t load_le32(const char *in)
+{
+    return load_le16(in) | static_cast<std::uint32_t>(load_le16(in + 2)) << 16;
+}
+
+inline std::uint64_t load_le64(const char *in)
+{
+    return load_le32(in) | static_cast<std::uint64_t>(load_le32(in + 4)) << 32;
+}
+
+inline std::uint64_t encoded_size(std::uint64_t key_size, std::uint64_t value_size)
+{
+    return HEADER_SIZE + key_size + value_size;
+}
+
+/**
+ * @brief Serialize a header into HEADER_SIZE bytes.
+ */
+void encode_header(const Header &header, char *out);
+
+/**
+ * @brief Deserialize a header from HEADER_SIZE bytes.
+ */
+Header decode_header(const char *in);
+
+/**
+ * @brief Serialize a record at the end of a buffer, in place: the buffer only
+ *        allocates when its capacity is exceeded, so a buffer that is cleared
+ *        and reused does not allocate once it has grown. The sizes must fit in
+ *        the header fields.
+ */
+void append(std::string &buffer, std::string_view key, std::string_view value, std::uint8_t flags = 0,
+            std::uint32_t timestamp = 0);
+
+/**
+ * @brief Parse the record at the start of some bytes without copying it.
+ *
+ * @param bytes Bytes starting with a record, possibly followed by others.
+ * @param view Set to the record on kOk, and its header is set on kCorrupted
+ *        and on kTruncated if the whole header is there.
+ * @return ParseResult Whether a valid record was parsed.
+ */
+ParseResult parse(std::string_view bytes, View &view);
+
+} // namespace record
+
+#endif // BITCASK_RECORD_HPP_
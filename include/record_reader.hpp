@@ -0,0 +1,96 @@
+/**
+ * @file record_reader.hpp
+ * @author Lucas
+ * @brief RecordReader class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_RECORD_READER_HPP_
+#define BITCASK_RECORD_READER_HPP_
+
+#include "absl/status/status.h"
+#include "fd_cache.hpp"
+#include "record.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace store
+{
+
+/**
+ * @class RecordReader
+ * @brief Reads the records of a datafile in order. The file is read in large
+ *        sequential chunks and the records are parsed in place, so reading a
+ *        datafile costs one read per chunk rather than one per record.
+ */
+class RecordReader
+{
+  private:
+    std::shared_ptr<const ReadableFile> file_;
+    std::uint64_t file_size_;
+    std::size_t buffer_size_;
+
+    // the buffer holds the bytes of the file from buffer_offset_ on, the
+    // next record starts at pos_
+    std::string buffer_;
+    std::uint64_t buffer_offset_ = 0;
+    std::size_t buffered_ = 0;
+    std::size_t pos_ = 0;
+    bool header_checked_ = false; /** The file header was read and checked */
+    bool torn_ = false;           /** next() failed on bytes cut off by the end of the file */
+
+    /**
+     * @brief Read and check the file header, see check_file_header().
+     */
+    absl::Status read_header();
+
+  public:
+    /**
+     * @brief Construct a new RecordReader object. The kernel is told the file
+     *        is read sequentially so that it reads ahead.
+     *
+     * @param file The datafile.
+     * @param file_size Bytes of the datafile to read.
+     * @param buffer_size Bytes read at once, grown for larger records.
+     */
+    RecordReader(std::shared_ptr<const ReadableFile> file, std::uint64_t file_size, std::size_t buffer_size);
+
+    /**
+     * @brief Parse the next record.
+     *
+     * @param view Set to the record, which points into the buffer of the
+     *        reader until the next call.
+     * @return absl::Status Status::OK, absl::OutOfRangeError at the end of
+     *         the file, absl::DataLossError if the record (or the file
+     *         header, before the first one) is truncated or corrupted,
+     *         absl::FailedPreconditionError if the file is of another format
+     *         or absl::InternalError if a read failed. An empty file has no
+     *         records.
+     */
+    absl::Status next(record::View &view);
+
+    /**
+     * @brief Offset of the record following the last one parsed, i.e. the
+     *        size of the valid part of the file once next() failed.
+     */
+    inline std::uint64_t offset() const
+    {
+        return buffer_offset_ + pos_;
+    }
+
+    /**
+     * @brief Whether next() failed because the file ends within the file
+     *        header or the last record, e.g. while it is being appended,
+     *        rather than on a checksum mismatch.
+     */
+    inline bool torn() const
+    {
+        return torn_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_RECORD_READER_HPP_
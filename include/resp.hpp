@@ -0,0 +1,79 @@
+/**
+ * @file resp.hpp
+ * @author Lucas
+ * @brief Subset of the Redis serialization protocol (RESP2)
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_RESP_HPP_
+#define BITCASK_RESP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace resp
+{
+
+// Commands are arrays of bulk strings: *<n>\r\n then $<len>\r\n<bytes>\r\n
+// for each argument. Lines of space separated words (inline commands, as
+// typed in telnet) are accepted as well.
+inline constexpr std::size_t MAX_ARGS = 1024 * 1024;
+inline constexpr std::size_t MAX_BULK_SIZE = 512 * 1024 * 1024;
+inline constexpr std::size_t MAX_INLINE_SIZE = 64 * 1024;
+
+/**
+ * @brief Outcome of parse().
+ */
+enum class ParseResult
+{
+    kOk,         /**< A whole command was parsed */
+    kIncomplete, /**< The bytes end before the command does */
+    kError       /**< The bytes are not a valid command */
+};
+
+/**
+ * @brief Parse the command at the start of some bytes without copying it.
+ *
+ * @param bytes Bytes starting with a command, possibly followed by others
+ *        (pipelining).
+ * @param args Set to the arguments on kOk, the command name first. They
+ *        point into the bytes.
+ * @param consumed Set to the size of the command on kOk.
+ * @param error Set to the reason on kError.
+ * @return ParseResult Whether a command was parsed. An empty inline command
+ *         is parsed with no arguments.
+ */
+ParseResult parse(std::string_view bytes, std::vector<std::string_view> &args, std::size_t &consumed,
+                  std::string &error);
+
+/**
+ * @brief Append a simple string reply, e.g. +OK.
+ */
+void append_simple(std::string &out, std::string_view value);
+
+/**
+ * @brief Append an error reply, e.g. -ERR unknown command.
+ */
+void append_error(std::string &out, std::string_view message);
+
+void append_integer(std::string &out, std::int64_t value);
+
+void append_bulk(std::string &out, std::string_view value);
+
+/**
+ * @brief Append the null bulk string, the reply for a missing key.
+ */
+void append_null(std::string &out);
+
+/**
+ * @brief Append the header of an array of n replies, to be followed by them.
+ */
+void append_array(std::string &out, std::size_t n);
+
+} // namespace resp
+
+#endif // BITCASK_RESP_HPP_
@@ -0,0 +1,206 @@
+/**
+ * @file server.hpp
+ * @author Lucas
+ * @brief Session and Server class declarations
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_SERVER_HPP_
+#define BITCASK_SERVER_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "store.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @struct ServerOptions
+ * @brief Tunables of a server.
+ */
+struct ServerOptions
+{
+    /** Address to listen on. */
+    std::string bind_address = "127.0.0.1";
+
+    /** TCP port to listen on, 0 for any free port (see Server::port()). */
+    std::uint16_t port = 6379;
+
+    /** Threads serving the connections, each with its own epoll instance,
+     *  0 for one per hardware thread. */
+    std::size_t threads = 0;
+
+    /** Bytes of replies a connection may have pending before its requests
+     *  are no longer read, until the client reads the replies. */
+    std::size_t max_pending_output = 16 * 1024 * 1024;
+};
+
+/**
+ * @struct ServerStats
+ * @brief Counters of a server, reported by INFO.
+ */
+struct ServerStats
+{
+    std::atomic<std::uint64_t> connections{0};       /**< Open connections */
+    std::atomic<std::uint64_t> total_connections{0}; /**< Connections accepted */
+    std::atomic<std::uint64_t> commands{0};          /**< Commands processed */
+};
+
+/**
+ * @class Session
+ * @brief Protocol state of one client connection, independent of the socket:
+ *        bytes received are fed to it and it produces the bytes of the
+ *        replies. Serves GET, SET [EX|PX], DEL, MGET, SCAN [MATCH] [COUNT],
+ *        INFO, PING, ECHO, QUIT and enough of COMMAND and CONFIG for the
+ *        Redis tools to connect.
+ *
+ *        Pipelined commands are processed together: consecutive plain SETs
+ *        are committed with a single Store::write and the replies of all the
+ *        commands are appended to one output buffer, sent with one write.
+ */
+class Session
+{
+  private:
+    Store &store_;
+    ServerStats *stats_;
+
+    std::string input_;
+    std::size_t input_pos_; /** Start of the first unprocessed command in input_ */
+    std::string output_;
+    bool closing_;
+
+    WriteBatch batch_; /** Pipelined SETs not committed yet */
+
+    // SCAN cursors handed out, each to the key following the page it ends
+    std::map<std::uint64_t, std::string> cursors_;
+    std::uint64_t next_cursor_;
+
+    /**
+     * @brief Commit the pending SETs and reply to each of them.
+     */
+    void flush_batch();
+
+    void execute(const std::vector<std::string_view> &args);
+    void set(const std::vector<std::string_view> &args);
+    void scan(const std::vector<std::string_view> &args);
+    void info();
+
+  public:
+    static const std::size_t MAX_CURSORS;  /** Cursors kept per session, the oldest are dropped */
+    static const std::size_t MAX_SCAN_COUNT;
+
+    explicit Session(Store &store, ServerStats *stats = nullptr);
+
+    /**
+     * @brief Receive bytes from the client and process the commands they
+     *        complete. The replies are appended to output().
+     */
+    void feed(std::string_view bytes);
+
+    /**
+     * @brief Replies not sent yet.
+     */
+    inline const std::string &output() const
+    {
+        return output_;
+    }
+
+    /**
+     * @brief Drop the first n bytes of output(), once sent.
+     */
+    void consume_output(std::size_t n);
+
+    /**
+     * @brief Whether the connection should be closed once output() is sent,
+     *        after QUIT or a protocol error.
+     */
+    inline bool closing() const
+    {
+        return closing_;
+    }
+};
+
+/**
+ * @brief Whether a key matches a glob-style pattern of SCAN MATCH: '*' for
+ *        any bytes, '?' for any byte, '\' to escape the next byte.
+ */
+bool glob_match(std::string_view pattern, std::string_view key);
+
+/**
+ * @class Server
+ * @brief TCP server speaking RESP (see resp.hpp) in front of a store. Each
+ *        worker thread waits on its own epoll instance for the listening
+ *        socket, registered exclusively so that a connection wakes a single
+ *        worker, and for the connections it accepted, which it serves until
+ *        they close. The store is shared by the workers.
+ */
+class Server
+{
+  private:
+    struct Connection;
+
+    Store &store_;
+    ServerOptions options_;
+    ServerStats stats_;
+    int listen_fd_;
+    int stop_fd_; /** eventfd waking the workers up to stop */
+    std::uint16_t port_;
+    std::vector<std::thread> workers_;
+
+    Server(Store &store, const ServerOptions &options);
+
+    absl::Status listen();
+    void worker_loop();
+
+  public:
+    /**
+     * @brief Listen and start the workers.
+     *
+     * @return absl::StatusOr<std::unique_ptr<Server>> The running server or
+     *         absl::InternalError if the address could not be listened on.
+     */
+    static absl::StatusOr<std::unique_ptr<Server>> start(Store &store, const ServerOptions &options);
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief Stop, see stop().
+     */
+    ~Server();
+
+    /**
+     * @brief Close the listening socket and the connections and join the
+     *        workers. The replies not sent yet are dropped.
+     */
+    void stop();
+
+    /**
+     * @brief Port listened on, the one picked by the kernel if
+     *        ServerOptions::port is 0.
+     */
+    inline std::uint16_t port() const
+    {
+        return port_;
+    }
+
+    inline const ServerStats &stats() const
+    {
+        return stats_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_SERVER_HPP_
@@ -14,12 +14,37 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "compression.hpp"
+#include "cursor.hpp"
+#include "datafile_writer.hpp"
+#include "executor.hpp"
+#include "fd_cache.hpp"
+#include "hintfile.hpp"
+#include "io_engine.hpp"
 #include "keydir.hpp"
+#include "mapped_file.hpp"
+#include "record.hpp"
+#include "thread_pool.hpp"
+#include "value_cache.hpp"
+#include "write_batch.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace store
@@ -29,71 +54,807 @@ using fileid_t = uint32_t;
 namespace fs = std::filesystem;
 
 /**
- * @struct DatafileEntry
- * @brief Represents an entry in a datafile.
+ * @enum ReadMode
+ * @brief How values of sealed datafiles are read.
  */
-struct DatafileEntry
+enum class ReadMode
 {
-    char CRC[4];                   /**< Cyclical Redundancy Check */
-    std::uint16_t ksz;             /**< key size */
-    std::uint16_t vsz;             /**< value size */
-    std::unique_ptr<char[]> key;   /**< key */
-    std::unique_ptr<char[]> value; /**< value */
+    kPread, /**< One positional read per value through the descriptor cache */
+    kMmap   /**< Straight out of a memory mapping of the datafile */
+};
 
-    DatafileEntry()
-    {
-        key = nullptr;
-        value = nullptr;
-    }
-    DatafileEntry(const uint16_t ksz, const uint16_t vsz) : ksz(ksz), vsz(vsz)
-    {
-        key = std::make_unique<char[]>(ksz);
-        value = std::make_unique<char[]>(vsz);
-    }
-    ~DatafileEntry() = default;
+/**
+ * @enum CorruptionPolicy
+ * @brief What load_keydir and merge do with a record failing its checksum,
+ *        or cut short by the end of the datafile.
+ */
+enum class CorruptionPolicy
+{
+    kFail,    /**< Fail with absl::DataLossError */
+    kTruncate /**< Drop the record and the rest of its datafile, as after a
+                   torn write. The active datafile is truncated before the
+                   record so that appends resume on a valid tail */
+};
 
-    void set_ksz(const uint16_t ksz)
-    {
-        this->ksz = ksz;
-        this->key = std::make_unique<char[]>(ksz);
-    }
-    void set_vsz(const uint16_t vsz)
+/**
+ * @struct Options
+ * @brief Tunables of a store.
+ */
+struct Options
+{
+    /** Size threshold (in bytes) after which the active datafile is sealed and
+     *  a new one is started. A single record larger than the threshold still
+     *  gets a datafile of its own. */
+    std::uint64_t max_file_size = 256 * 1024 * 1024;
+
+    /** When the records appended to the active datafile are synced to the
+     *  device. */
+    SyncPolicy sync_policy = SyncPolicy::kNone;
+
+    /** Period of the background sync when sync_policy is
+     *  SyncPolicy::kInterval. */
+    std::chrono::milliseconds sync_interval = std::chrono::milliseconds(1000);
+
+    /** Number of read-only datafile descriptors kept open for get(). */
+    std::size_t max_open_files = 64;
+
+    /** How values of sealed datafiles are read. The active datafile is
+     *  always read with pread. */
+    ReadMode read_mode = ReadMode::kPread;
+
+    /** Access pattern advertised for the mappings of ReadMode::kMmap. */
+    MadvisePolicy madvise_policy = MadvisePolicy::kRandom;
+
+    /** Threads reading the datafiles in load_keydir, 0 for one per hardware
+     *  thread. */
+    std::size_t load_threads = 0;
+
+    /** Verify the checksum of the record of every value read by get(). The
+     *  checksums are always verified by load_keydir and merge. */
+    bool verify_checksums = false;
+
+    /** What to do with corrupted records found by load_keydir and merge.
+     *  Failing is the default so that nothing is dropped silently, set
+     *  CorruptionPolicy::kTruncate to recover from a torn write after a
+     *  crash. */
+    CorruptionPolicy corruption_policy = CorruptionPolicy::kFail;
+
+    /** Memory budget (in bytes) of the cache of the values read from the
+     *  datafiles, 0 to disable it. Values served from a memory mapping are
+     *  not cached. */
+    std::size_t value_cache_bytes = 0;
+
+    /** Codec of the values written by set() and write(). Values that don't
+     *  get smaller, tombstones and put_stream() values are stored as they
+     *  are. Records of any codec are read whatever the setting. */
+    Compression compression = Compression::kNone;
+
+    /** Level of the codec, 0 for its default. */
+    int compression_level = 0;
+
+    /** Zstd dictionary (see Compressor::train_dictionary()) for
+     *  Compression::kZstd, which pays off on small values sharing a
+     *  structure. The records written with it can only be read with it. */
+    std::string compression_dictionary;
+
+    /** Period of the background sweep deleting the expired keys (see
+     *  set_with_ttl()) from the keydir, 0 to disable it. Expired keys are
+     *  never returned either way, the sweep only frees their memory. */
+    std::chrono::milliseconds expiry_sweep_interval = std::chrono::milliseconds(0);
+
+    /** Keep the keys sorted in memory, alongside the keydir, for range() and
+     *  scan_prefix(). Costs a second copy of every key. */
+    bool ordered_index = false;
+
+    /** How async_get() reads the values. */
+    IoBackend io_backend = IoBackend::kAuto;
+
+    /** Reads kept in flight by the io_uring backend. */
+    unsigned io_queue_depth = 256;
+
+    /** Threads running async_set() and, without io_uring, the reads of
+     *  async_get(). 0 for one per hardware thread. */
+    std::size_t io_threads = 0;
+};
+
+/**
+ * @struct LoadStats
+ * @brief Timings of the last load_keydir.
+ */
+struct LoadStats
+{
+    struct File
     {
-        this->vsz = vsz;
-        this->value = std::make_unique<char[]>(vsz);
-    }
+        fileid_t fileid;
+        bool from_hint;                     /**< Read from the hint file rather than the datafile */
+        std::size_t records;                /**< Records (or hint entries) read */
+        std::uint64_t bytes;                /**< Size of the datafile */
+        std::uint64_t discarded_bytes;      /**< Bytes dropped after a corrupted record */
+        std::chrono::microseconds duration; /**< Time spent reading the file, on its worker thread */
+    };
+
+    std::vector<File> files;                /**< In the order they were applied to the keydir */
+    std::chrono::microseconds duration{0};  /**< Wall-clock time of load_keydir */
+    std::size_t threads = 0;                /**< Threads that read the files */
 };
 
 /**
  * @class Store
  * @brief Represents the store. The store manages the keydir and the datafiles.
  *        It provides methods to set, get, and delete key-value pairs, as well
- *        as to list all key-value pairs.
+ *        as to list all key-value pairs. Once load_keydir returned, the store
+ *        may be shared by concurrent readers and writers.
  */
 class Store
 {
   private:
+    /**
+     * @brief Called for each record of a datafile scan with the key, the
+     *        value, the keydir entry the record would have and the header of
+     *        the record. The key and the value point into the scan buffer and
+     *        are only valid during the call. A non-OK status stops the scan.
+     *        The records of a WriteBatch are only passed once the whole batch
+     *        was read.
+     */
+    using ScanCallback = std::function<absl::Status(std::string_view key, std::string_view value,
+                                                    const keydir::Entry &entry, const record::Header &header)>;
+
+    /**
+     * @struct MergeManifest
+     * @brief Datafiles written (outputs) and replaced (inputs) by a merge.
+     *        Once the inputs are removed, only the highest file id they used
+     *        is kept so that it is not reused.
+     */
+    struct MergeManifest
+    {
+        std::vector<fileid_t> outputs;
+        std::vector<fileid_t> inputs;
+        fileid_t last_fileid = 0; /** Highest file id of the merge once its inputs are removed, 0 before */
+
+        /**
+         * @brief Highest file id listed by the manifest, 0 if none.
+         */
+        fileid_t max_fileid() const;
+    };
+
+    /**
+     * @struct PartialKeyDir
+     * @brief Entries of a single datafile, read by a load_keydir worker.
+     */
+    struct PartialKeyDir
+    {
+        struct Latest
+        {
+            keydir::Entry entry;
+            bool tombstone;
+        };
+
+        std::unordered_map<std::string, Latest> latest; /** Latest record of each key of the datafile */
+        std::vector<hintfile::Entry> hints;             /** Entries of the datafile, when it was scanned */
+        std::uint64_t file_size = 0;       /** Size of the valid records of the datafile */
+        std::uint64_t discarded_bytes = 0; /** Bytes after the first corrupted record */
+        std::size_t records = 0;
+        bool from_hint = false;
+        std::chrono::microseconds duration{0};
+    };
+
+    /**
+     * @struct PendingRead
+     * @brief Value to read for multi_get(): the index of its key in the
+     *        request and its keydir entry.
+     */
+    struct PendingRead
+    {
+        std::size_t index;
+        keydir::Entry entry;
+    };
+
     std::string db_path_;
-    fileid_t active_fileid_;
-    uint16_t active_file_offset_;
+    Options options_;
+    std::atomic<fileid_t> active_fileid_;
+    std::atomic<std::uint64_t> active_file_offset_; /** Bytes of the active datafile, including in-flight appends */
+    fileid_t next_fileid_;                   /** Next unused file id, guarded by write_mutex_ */
+    std::unique_ptr<DatafileWriter> writer_; /** Append handle on the active datafile, opened on first write */
+    std::shared_mutex write_mutex_;          /** Held shared by the appends, exclusively by the datafile rotations */
+    std::vector<hintfile::Entry> active_hints_; /** Hint entries of the active datafile, written out when it is sealed */
     keydir::KeyDir keydir_;
-    static const std::uint64_t TOMBSTONE;
-    static const int TOMBSTONE_SIZE;
+    mutable FdCache fd_cache_;     /** Read-only descriptors of the datafiles */
+    std::unique_ptr<ValueCache> value_cache_; /** nullptr unless Options::value_cache_bytes is set */
+    std::unique_ptr<Compressor> compressor_;
+    absl::Status compression_status_; /** Why Options::compression can't be used, compressing writes fail with it */
+    mutable MmapCache mmap_cache_; /** Mappings of the sealed datafiles (ReadMode::kMmap) */
+
+    std::mutex merge_mutex_;       /** Held for the whole duration of a merge */
+    std::mutex merge_state_mutex_; /** Guards the background merge state below */
+    std::thread merge_thread_;
+    bool merge_running_;
+    absl::Status merge_status_;
+
+    std::thread sweep_thread_;       /** Runs the expiry sweeps, see Options::expiry_sweep_interval */
+    std::mutex sweep_mutex_;         /** Guards sweep_stop_ */
+    std::condition_variable sweep_cv_;
+    bool sweep_stop_;
+
+    mutable std::mutex scan_mutex_;             /** Guards the cursor and merge counts below */
+    mutable std::condition_variable scan_cv_;   /** Signaled when the last cursor or the merge ends */
+    mutable int open_cursors_;                  /** Cursors created by scan() not destroyed yet */
+    bool merging_;                              /** A merge is moving records */
+
+    friend class Cursor;
+
+    LoadStats load_stats_;
+
+    mutable std::once_flag io_engine_once_;
+    mutable std::unique_ptr<IoEngine> io_engine_; /** Created by the first asynchronous operation */
+    mutable absl::Status io_engine_status_;       /** Why io_engine_ could not be created */
+
     static const int CRC_SIZE;
-    static const int KSZ_SIZE;
-    static const int VSZ_SIZE;
+    static const int HEADER_SIZE;
+    static const std::uint8_t FLAG_BATCH;     /** The record belongs to a WriteBatch */
+    static const std::uint8_t FLAG_BATCH_END; /** The record is the last one of its WriteBatch */
+    static const std::uint8_t FLAG_LZ4;       /** The value is compressed with LZ4 */
+    static const std::uint8_t FLAG_ZSTD;      /** The value is compressed with Zstd */
+    static const std::uint8_t VALUE_FLAGS;    /** Flags kept in the keydir to decode the value */
+    static const std::uint8_t FLAG_TOMBSTONE; /** The record deletes its key, its value is empty */
+    static const std::uint8_t FLAG_EXPIRING;  /** The record expires at its timestamp */
+    static const std::string DATAFILE_PREFIX;
+    static const std::string HINT_SUFFIX;
+    static const std::string MERGE_SUFFIX;
+    static const std::string MERGE_MANIFEST;
+    static const int MAX_READ_ATTEMPTS;
+    static const std::uint64_t MULTI_GET_MAX_GAP; /** Largest gap between two ranges read by a single preadv */
+    static const std::size_t SCAN_BUFFER_SIZE;    /** Bytes read at once by a datafile scan */
+    static const std::size_t STREAM_CHUNK_SIZE;   /** Bytes read at once by get_stream() and put_stream() */
+
+    /**
+     * @brief Append a record to the active datafile, rotating it first if the
+     *        record would exceed Options::max_file_size, and update the keydir
+     *        once the record is written. Concurrent appends hold write_mutex_
+     *        shared so that the datafile writer batches them together.
+     *
+     * @param key
+     * @param value
+     * @param type 0 for a value, FLAG_TOMBSTONE or FLAG_EXPIRING.
+     * @param expiry Expiry time of a FLAG_EXPIRING record.
+     * @return absl::Status Status::OK, absl::InvalidArgumentError if the key
+     *         or the value is too large or absl::InternalError if the write
+     *         failed.
+     */
+    absl::Status append_record(const std::string &key, const std::string &value, std::uint8_t type,
+                               std::uint32_t expiry = 0);
+
+    /**
+     * @brief Current time in seconds since the epoch, as written in the
+     *        records.
+     */
+    static std::uint32_t now();
+
+    /**
+     * @brief Look a key up in the keydir, skipping it if it expired.
+     *
+     * @return absl::StatusOr<keydir::Entry> The entry or absl::NotFoundError
+     *         if the key does not exist or expired.
+     */
+    absl::StatusOr<keydir::Entry> lookup(std::string_view key) const;
+
+    /**
+     * @brief Body of sweep_thread_: purge_expired() every
+     *        Options::expiry_sweep_interval until the store is destroyed.
+     */
+    void run_sweeps();
+
+    /**
+     * @brief Compress a value to be written with Options::compression.
+     *
+     * @param value The value.
+     * @param buffer Holds the compressed value, if any.
+     * @param flags Set to the FLAG_* of the codec, 0 for none.
+     * @return std::string_view The bytes to store: the value itself or the
+     *         compressed value in buffer.
+     */
+    std::string_view encode_value(std::string_view value, std::string &buffer, std::uint8_t &flags) const;
+
+    /**
+     * @brief Decompress the stored bytes of a value if its entry says so.
+     */
+    absl::StatusOr<std::string> decode_value(std::string bytes, const keydir::Entry &entry) const;
+
+    /**
+     * @brief Reserve room for size bytes in the active datafile, rotating it
+     *        or opening its append handle as needed. On success, lock holds
+     *        write_mutex_ shared until the bytes are appended.
+     *
+     * @return absl::Status Status::OK or the error of the rotation.
+     */
+    absl::Status begin_append(std::shared_lock<std::shared_mutex> &lock, std::uint64_t size);
+
+    /**
+     * @brief Give back the room reserved by begin_append() for an append that
+     *        failed: once the appends in flight are done, the offset of the
+     *        active datafile is set back to the size of the datafile. Releases
+     *        lock.
+     */
+    void abort_append(std::shared_lock<std::shared_mutex> &lock);
+
+    /**
+     * @brief Reserve room for a record in the active datafile. write_mutex_
+     *        must be held shared.
+     *
+     * @return bool false if the append handle is not open or if the record
+     *         would exceed Options::max_file_size.
+     */
+    bool reserve_append(std::uint64_t record_size);
+
+    /**
+     * @brief Rotate the active datafile if a record does not fit in it and
+     *        open the append handle. write_mutex_ must be held exclusively.
+     */
+    absl::Status prepare_append(std::uint64_t record_size);
+
+    /**
+     * @brief Check the checksum of a serialized record and that it holds the
+     *        given key.
+     *
+     * @return absl::Status Status::OK or absl::DataLossError.
+     */
+    static absl::Status verify_record(std::string_view record, std::string_view key);
+
+    /**
+     * @brief Seal the active datafile (make it read-only), write its hint file
+     *        and make the next file id the active one.
+     *
+     * @return absl::Status Status::OK or absl::InternalError if the datafile
+     *         permissions could not be changed.
+     */
+    absl::Status rotate();
+
+    /**
+     * @brief Hand out a file id that was never used in the database.
+     *        write_mutex_ must be held exclusively.
+     */
+    inline fileid_t allocate_fileid()
+    {
+        return next_fileid_++;
+    }
+
+    /**
+     * @brief Open the append handle on the active datafile if it is not open
+     *        yet.
+     *
+     * @return absl::Status Status::OK or absl::InternalError if the datafile
+     *         could not be opened.
+     */
+    absl::Status open_writer();
+
+    /**
+     * @brief Whether the value of an entry is served from a memory mapping.
+     */
+    inline bool is_mapped(const keydir::Entry &entry) const
+    {
+        return options_.read_mode == ReadMode::kMmap && entry.fileid != active_fileid_;
+    }
+
+    /**
+     * @brief View the value of a keydir entry in the mapping of its (sealed)
+     *        datafile.
+     *
+     * @param entry The keydir entry of the record.
+     * @param key The key of the record.
+     * @return absl::StatusOr<ValueView> A view pinning the mapping, an error
+     *         if the datafile could not be mapped or absl::DataLossError if
+     *         Options::verify_checksums is set and the record is corrupted.
+     */
+    absl::StatusOr<ValueView> map_value(const keydir::Entry &entry, std::string_view key) const;
+
+    /**
+     * @brief Position and size of the bytes to read for the value of a keydir
+     *        entry: the value itself or, with Options::verify_checksums, the
+     *        whole record.
+     */
+    std::pair<std::uint64_t, std::size_t> value_range(const keydir::Entry &entry, std::size_t key_size) const;
+
+    /**
+     * @brief Turn the bytes read at value_range() into the value, checking
+     *        the record with Options::verify_checksums and decompressing the
+     *        value.
+     *
+     * @return absl::StatusOr<std::string> The value or absl::DataLossError if
+     *         the record is corrupted.
+     */
+    absl::StatusOr<std::string> finish_value(std::string bytes, const keydir::Entry &entry,
+                                             std::string_view key) const;
+
+    /**
+     * @brief read_value() served from the value cache when possible.
+     */
+    absl::StatusOr<std::string> read_cached_value(const keydir::Entry &entry, const std::string &key) const;
+
+    /**
+     * @brief Drop the cached value of a key about to be overwritten or
+     *        deleted. Cached values are keyed by record so they never go
+     *        stale, this only frees the memory early.
+     */
+    void forget_value(std::string_view key) const;
+
+    /**
+     * @brief The engine of the asynchronous operations, created on first use.
+     *
+     * @return absl::StatusOr<IoEngine *> The engine or the error of
+     *         IoEngine::create.
+     */
+    absl::StatusOr<IoEngine *> io_engine() const;
+
+    /**
+     * @brief Read the values of a batch of keys stored in the same datafile.
+     *        Reads close to each other are coalesced into a single preadv,
+     *        the bytes between their ranges being read into a scratch buffer.
+     *
+     * @param fileid Id of the datafile.
+     * @param reads The values to read, sorted by offset.
+     * @param keys The keys of the multi_get() request.
+     * @param values The values of the request, set for every read.
+     */
+    void read_values(fileid_t fileid, std::span<const PendingRead> reads, std::span<const std::string_view> keys,
+                     std::vector<absl::StatusOr<std::string>> &values) const;
+
+    /**
+     * @brief Read the records of a datafile in order.
+     *
+     * @param fileid The id of the datafile to read.
+     * @param callback Called for each record.
+     * @param file_size Set to the size of the datafile.
+     * @return absl::Status Status::OK, the status returned by the callback,
+     *         absl::InternalError if the datafile could not be opened or
+     *         absl::DataLossError if a record fails its checksum or a record
+     *         or a batch is cut short by the end of the file.
+     */
+    absl::Status scan_datafile(fileid_t fileid, const ScanCallback &callback, std::uint64_t &file_size) const;
+
+    /**
+     * @brief Read the partial keydir of a datafile, from its hint file when
+     *        present. Writes the missing hint file of a sealed datafile.
+     *
+     * @param fileid The id of the datafile to read.
+     * @param sealed Whether the datafile is sealed.
+     * @return absl::StatusOr<PartialKeyDir> The entries of the datafile or
+     *         absl::InternalError if the datafile could not be read.
+     */
+    absl::StatusOr<PartialKeyDir> read_partial_keydir(fileid_t fileid, bool sealed) const;
+
+    /**
+     * @brief Read all the entries of a datafile into a partial keydir.
+     *
+     * @param fileid The id of the datafile to read.
+     * @param partial Filled with the entries and the size of the datafile.
+     * @return absl::Status Status::OK or absl::InternalError if the datafile
+     *         could not be read.
+     */
+    absl::Status load_datafile(fileid_t fileid, PartialKeyDir &partial) const;
+
+    /**
+     * @brief Read the entries of the hint file of a datafile into a partial
+     *        keydir.
+     *
+     * @param fileid The id of the datafile.
+     * @param partial Filled with the entries of the hint file.
+     * @return absl::Status Status::OK or the error of hintfile::read.
+     */
+    absl::Status load_hintfile(fileid_t fileid, PartialKeyDir &partial) const;
+
+    inline fs::path hint_path(fileid_t fileid) const
+    {
+        return hint_path(db_path_, fileid);
+    }
+
+    inline fs::path merge_manifest_path() const
+    {
+        return fs::path(db_path_) / fs::path(MERGE_MANIFEST);
+    }
+
+    inline fs::path merge_output_path(fileid_t fileid) const
+    {
+        return fs::path(datafile_path(fileid).string() + MERGE_SUFFIX);
+    }
+
+    absl::StatusOr<MergeManifest> read_merge_manifest() const;
+
+    /**
+     * @brief Durably replace the merge manifest. This is the commit point of
+     *        a merge: once written, an interrupted merge is finished when the
+     *        store is loaded again.
+     */
+    absl::Status write_merge_manifest(const MergeManifest &manifest) const;
+
+    /**
+     * @brief Give the outputs of a committed merge their datafile name and
+     *        seal them, then sync the directory so that the renames outlive a
+     *        crash. Outputs that were already installed are skipped.
+     */
+    absl::Status install_merge_outputs(const std::vector<fileid_t> &outputs) const;
+
+    /**
+     * @brief Remove the datafiles replaced by a committed merge, if they still
+     *        exist, and drop their cached descriptors and mappings.
+     */
+    absl::Status remove_merge_inputs(const std::vector<fileid_t> &inputs) const;
+
+    /**
+     * @brief Remove the inputs of a committed merge, then durably drop them
+     *        from its manifest so that they are not removed again on load,
+     *        where a new datafile could have taken their place.
+     */
+    absl::Status finish_merge(const MergeManifest &manifest) const;
+
+    /**
+     * @brief The body of merge(), run once no cursor is open.
+     */
+    absl::Status merge_datafiles();
+
+    /**
+     * @brief Called by a cursor created by scan() when it is destroyed.
+     */
+    void end_scan() const;
+
+    /**
+     * @brief Finish a merge interrupted after its commit and remove the
+     *        outputs of a merge interrupted before it.
+     *
+     * @return absl::StatusOr<MergeManifest> The manifest of the last merge,
+     *         empty if there was none, or an error if the recovery failed.
+     */
+    absl::StatusOr<MergeManifest> recover_merge() const;
 
   public:
-    Store(const std::string &db_path);
+    Store(const std::string &db_path, const Options &options = Options());
+    Store(const Store &) = delete;
+    Store &operator=(const Store &) = delete;
+    ~Store();
 
     absl::Status set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Set a key that expires after some time: get() no longer finds
+     *        it, load_keydir and merge drop it and the background sweeps
+     *        delete it from the keydir, without writing a tombstone.
+     *
+     * @param key
+     * @param value
+     * @param ttl Time to live, the key expires at once if not positive.
+     * @return absl::Status See set().
+     */
+    absl::Status set_with_ttl(const std::string &key, const std::string &value, std::chrono::seconds ttl);
+
+    /**
+     * @brief Delete the expired keys from the keydir. Run periodically with
+     *        Options::expiry_sweep_interval.
+     *
+     * @return std::size_t Number of keys deleted.
+     */
+    std::size_t purge_expired();
+
     absl::StatusOr<std::string> get(const std::string &key) const;
+
+    /**
+     * @brief Get the value of a key without copying it when it is served
+     *        from a memory mapping (ReadMode::kMmap and sealed datafile).
+     *        Other values are read into a string owned by the view.
+     *
+     * @param key
+     * @return absl::StatusOr<ValueView> The value, or absl::NotFoundError if
+     *         the key does not exist.
+     */
+    absl::StatusOr<ValueView> get_view(const std::string &key) const;
+
+    /**
+     * @brief Get the values of several keys at once. The keys are all looked
+     *        up in the keydir first, then the values are read datafile by
+     *        datafile in offset order, with values close to each other read
+     *        by a single vectored read. Values served from a memory mapping
+     *        are not read at all.
+     *
+     * @param keys
+     * @return std::vector<absl::StatusOr<std::string>> The value of each key,
+     *         in the order of the keys, or the error get() would return for
+     *         it.
+     */
+    std::vector<absl::StatusOr<std::string>> multi_get(std::span<const std::string_view> keys) const;
+
+    /** Produces the next chunk of the value of put_stream(), an empty chunk
+     *  once the value is complete. */
+    using ChunkSource = std::function<absl::StatusOr<std::string_view>()>;
+
+    /** Receives the chunks of the value of get_stream(), a non-OK status
+     *  stops the read. */
+    using ChunkSink = std::function<absl::Status(std::string_view chunk)>;
+
+    /**
+     * @brief Set a key to a value produced chunk by chunk, without holding
+     *        the whole value in memory. The chunks are written to the
+     *        datafile as they come and the other writers wait until the
+     *        record is complete. Streamed values are stored uncompressed,
+     *        whatever Options::compression.
+     *
+     * @param key
+     * @param size Size of the value, the chunks must add up to it.
+     * @param source Produces the chunks, see ChunkSource.
+     * @return absl::Status Status::OK, the error of source,
+     *         absl::InvalidArgumentError if the key or the value is too large
+     *         or the chunks do not add up to size, or absl::InternalError if
+     *         the write failed. The key is left unchanged on error.
+     */
+    absl::Status put_stream(const std::string &key, std::uint64_t size, const ChunkSource &source);
+    absl::Status put_stream(const std::string &key, std::istream &input, std::uint64_t size);
+
+    /**
+     * @brief Read the value of a key chunk by chunk, without holding the
+     *        whole value in memory. With Options::verify_checksums, the
+     *        checksum can only be checked once the whole value was read: a
+     *        sink given a corrupted value gets all of it before
+     *        absl::DataLossError is returned.
+     *
+     * @param key
+     * @param sink Receives the chunks in order.
+     * @return absl::Status Status::OK, absl::NotFoundError if the key does
+     *         not exist, the error of sink, absl::DataLossError or
+     *         absl::InternalError if the read failed.
+     */
+    absl::Status get_stream(const std::string &key, const ChunkSink &sink) const;
+    absl::Status get_stream(const std::string &key, std::ostream &output) const;
+
+    /** Called with the value of async_get(). */
+    using GetCallback = std::function<void(absl::StatusOr<std::string> value)>;
+
+    /** Called with the status of async_set() and async_del(). */
+    using StatusCallback = std::function<void(absl::Status status)>;
+
+    /**
+     * @brief Get the value of a key without blocking on the read. With
+     *        io_uring (Options::io_backend) a single thread keeps up to
+     *        Options::io_queue_depth reads in flight. The store must outlive
+     *        the operation.
+     *
+     * @param key
+     * @param done Called with the result get() would return, either before
+     *        async_get returns or from an engine thread, see
+     *        IoEngine::Callback.
+     */
+    void async_get(const std::string &key, GetCallback done) const;
+    std::future<absl::StatusOr<std::string>> async_get(const std::string &key) const;
+
+    /**
+     * @brief Set a key-value pair from an engine thread. Concurrent sets are
+     *        written together by the group commit of the datafile writer.
+     *
+     * @param key
+     * @param value
+     * @param done Called with the result of set().
+     */
+    void async_set(const std::string &key, const std::string &value, StatusCallback done);
+    std::future<absl::Status> async_set(const std::string &key, const std::string &value);
+
+    /**
+     * @brief Delete a key from an engine thread, see async_set().
+     *
+     * @param key
+     * @param done Called with the result of del().
+     */
+    void async_del(const std::string &key, StatusCallback done);
+
+    /**
+     * @brief Awaitable get(): the coroutine suspends while the value is read
+     *        and is resumed on the executor. The key is copied into the
+     *        coroutine, the store must outlive it.
+     *
+     * @param executor The executor driving the awaiting coroutine.
+     * @param key
+     * @return Task<absl::StatusOr<std::string>> The result of get().
+     */
+    Task<absl::StatusOr<std::string>> co_get(Executor &executor, std::string key) const;
+
+    /**
+     * @brief Awaitable set(), see co_get().
+     */
+    Task<absl::Status> co_set(Executor &executor, std::string key, std::string value);
+
+    /**
+     * @brief Awaitable del(), see co_get().
+     */
+    Task<absl::Status> co_del(Executor &executor, std::string key);
     absl::Status del(const std::string &key);
+
+    /**
+     * @brief Apply the sets and deletes of a batch atomically: the records
+     *        are appended with a single write, the keydir is updated in one
+     *        critical section and load_keydir drops a batch that was not
+     *        entirely written before a crash.
+     *
+     * @param batch
+     * @return absl::Status Status::OK, absl::InvalidArgumentError if a key or
+     *         a value is too large or absl::InternalError if the write failed.
+     */
+    absl::Status write(const WriteBatch &batch);
     absl::Status list() const;
 
+    /**
+     * @brief List the live keys in [begin, end) in lexicographic order, in
+     *        O(log n + k). Pages follow each other by starting the next one
+     *        right after the last key of the previous one, i.e. at
+     *        last + '\0'.
+     *
+     * @param begin First key, inclusive.
+     * @param end Last key, exclusive, empty for no bound.
+     * @param limit Maximum number of keys, 0 for no limit.
+     * @return absl::StatusOr<std::vector<std::string>> The keys, or
+     *         absl::FailedPreconditionError if Options::ordered_index is not
+     *         set.
+     */
+    absl::StatusOr<std::vector<std::string>> range(std::string_view begin, std::string_view end,
+                                                   std::size_t limit = 0) const;
+
+    /**
+     * @brief List the live keys starting with a prefix, see range().
+     */
+    absl::StatusOr<std::vector<std::string>> scan_prefix(std::string_view prefix, std::size_t limit = 0) const;
+
+    /**
+     * @brief Iterate over the live keys and their values in datafile order,
+     *        e.g. for a backup or an export. The datafiles are read
+     *        sequentially rather than with a random read per key. Waits for
+     *        the running merge, if any, and holds back the next merges until
+     *        the cursor is destroyed.
+     *
+     * @param buffer_size Bytes read from a datafile at once.
+     * @return Cursor Positioned on the first key.
+     */
+    Cursor scan(std::size_t buffer_size = Cursor::DEFAULT_BUFFER_SIZE) const;
+
+    /**
+     * @brief Flush the records appended to the active datafile to the device,
+     *        regardless of the sync policy.
+     *
+     * @return absl::Status Status::OK or absl::InternalError if the sync
+     *         failed.
+     */
+    absl::Status sync();
+
+    /**
+     * @brief Merge the sealed datafiles: rewrite the records that are still
+     *        live into new compacted datafiles, point the keydir to them and
+     *        remove the merged datafiles. The active datafile is sealed first
+     *        so that every existing record is merged, which lets the merge
+     *        drop all the tombstones and overwritten records it reads. Reads
+     *        and writes can proceed during the merge. The merge starts once
+     *        the cursors created by scan() are destroyed.
+     *
+     * @return absl::Status Status::OK or absl::InternalError if a datafile
+     *         could not be read or written.
+     */
+    absl::Status merge();
+
+    /**
+     * @brief Run merge() in a background thread.
+     *
+     * @return absl::Status Status::OK or absl::FailedPreconditionError if a
+     *         background merge is already running.
+     */
+    absl::Status start_merge();
+
+    /**
+     * @brief Wait for the background merge, if any, to finish.
+     *
+     * @return absl::Status The status of the last background merge.
+     */
+    absl::Status wait_for_merge();
+
     /**
      * @brief Populate the keydir with the entries from the datafiles, if any
-     *        exist.
+     *        exist. The datafiles written by the last merge are read first,
+     *        then the other datafiles in increasing file id order so that the
+     *        latest write of a key wins. The hint file of a datafile is read
+     *        instead of the datafile when present; missing hint files of
+     *        sealed datafiles are written. The datafiles are read in parallel
+     *        by Options::load_threads threads, see load_stats(). The last
+     *        datafile becomes the active one, unless it is already sealed.
      *
      * @return absl::Status Status::OK if the keydir was successfully loaded.
      *         Or absl::InternalError if there was an error opening a datafile.
@@ -101,25 +862,49 @@ class Store
     absl::Status load_keydir();
 
     /**
-     * @brief Read an entry from a datafile and return the value.
+     * @brief Read the value of a keydir entry with a single positional read.
+     *        The value starts right after the header and the key of the
+     *        record, so no header needs to be parsed. With
+     *        Options::verify_checksums the whole record is read and checked.
      *
-     * @param file The file stream to read from.
-     * @param vsz The size of the value.
-     * @return absl::StatusOr<std::string> The value read from the file or an
-     *        error if the value could not be read.
+     * @param entry The keydir entry of the record.
+     * @param key The key of the record.
+     * @return absl::StatusOr<std::string> The value read from the file, an
+     *        error if the value could not be read or absl::DataLossError if
+     *        the record is corrupted.
+     */
+    absl::StatusOr<std::string> read_value(const keydir::Entry &entry, const std::string &key) const;
+
+    /**
+     * @brief Pass the value of a record to a sink chunk by chunk, see
+     *        get_stream().
      */
-    absl::StatusOr<std::string> read_value(std::ifstream &file, std::uint16_t vsz) const;
+    absl::Status stream_value(const ReadableFile &file, const keydir::Entry &entry, const std::string &key,
+                              const ChunkSink &sink) const;
 
     inline uint32_t active_fileid() const
     {
         return static_cast<uint32_t>(active_fileid_);
     }
 
-    inline uint16_t active_file_offset() const
+    inline std::uint64_t active_file_offset() const
     {
         return active_file_offset_;
     }
 
+    /**
+     * @brief Counters of the value cache, all zero when it is disabled.
+     */
+    inline ValueCache::Stats value_cache_stats() const
+    {
+        return value_cache_ != nullptr ? value_cache_->stats() : ValueCache::Stats();
+    }
+
+    inline const LoadStats &load_stats() const
+    {
+        return load_stats_;
+    }
+
     inline std::size_t kd_size() const
     {
         return keydir_.size();
@@ -130,10 +915,58 @@ class Store
         return keydir_.get(key);
     }
 
+    inline keydir::Stats kd_stats() const
+    {
+        return keydir_.stats();
+    }
+
+    inline const Options &options() const
+    {
+        return options_;
+    }
+
+    inline fs::path datafile_path(fileid_t fileid) const
+    {
+        return datafile_path(db_path_, fileid);
+    }
+
+    /**
+     * @brief Path of a datafile of the store in a directory, for the tools
+     *        writing the files of a store without opening it, such as
+     *        StoreBuilder.
+     */
+    static fs::path datafile_path(const fs::path &db_path, fileid_t fileid);
+
+    /**
+     * @brief Path of the hint file of a datafile of the store in a directory.
+     */
+    static fs::path hint_path(const fs::path &db_path, fileid_t fileid);
+
+    /**
+     * @brief Compress a value as a store writing with a compressor does.
+     *
+     * @param compressor Compressor of the codec of Options::compression.
+     * @param value The value.
+     * @param buffer Holds the compressed value, if any.
+     * @param flags Set to the record flags of the codec, 0 for none: the
+     *        record of the value and its hint entry carry them.
+     * @return std::string_view The bytes to store: the value itself or the
+     *         compressed value in buffer.
+     */
+    static std::string_view encode_value(const Compressor &compressor, std::string_view value, std::string &buffer,
+                                         std::uint8_t &flags);
+
     inline fs::path active_datafile_path() const
     {
-        return fs::path(db_path_) / fs::path("datafile" + std::to_string(active_fileid_));
+        return datafile_path(active_fileid_);
     }
+
+    /**
+     * @brief List the ids of the datafiles present in the database directory.
+     *
+     * @return std::vector<fileid_t> The file ids, in increasing order.
+     */
+    std::vector<fileid_t> datafile_ids() const;
 };
 
 } // namespace store
@@ -0,0 +1,215 @@
+/**
+ * @file store_builder.hpp
+ * @author Lucas
+ * @brief StoreBuilder class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_STORE_BUILDER_HPP_
+#define BITCASK_STORE_BUILDER_HPP_
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "bulk_reader.hpp"
+#include "store.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @struct BuildStats
+ * @brief Outcome of StoreBuilder::finish().
+ */
+struct BuildStats
+{
+    std::uint64_t records = 0;   /**< Sets and deletes added */
+    std::uint64_t keys = 0;      /**< Live keys written, once deduplicated */
+    std::uint64_t datafiles = 0; /**< Datafiles written, each with its hint file */
+    std::uint64_t bytes = 0;     /**< Bytes of the datafiles */
+    std::uint64_t runs = 0;      /**< Sorted runs spilled to disk, 0 if the records fit in memory */
+    std::size_t threads = 0;     /**< Threads sorting and encoding the records */
+    double seconds = 0;
+
+    inline double records_per_second() const
+    {
+        return seconds > 0 ? static_cast<double>(records) / seconds : 0.0;
+    }
+};
+
+/**
+ * @class StoreBuilder
+ * @brief Builds a store directory offline, without the write path of Store:
+ *        the sets and deletes are gathered in memory, sorted by key and
+ *        deduplicated (the last one of a key wins), then written in key order
+ *        to sealed datafiles of at most Options::max_file_size bytes, each
+ *        with its hint file. The records are encoded in parallel in large
+ *        chunks, which are appended to the datafiles one at a time.
+ *
+ *        Once the records held in memory exceed the memory limit, they are
+ *        sorted, deduplicated and spilled to a run file in the directory, and
+ *        finish() merges the runs. Besides the memory limit, a build uses a
+ *        window of encoded chunks (about 4 * CHUNK_SIZE per thread) and a
+ *        read buffer of RUN_BUFFER_SIZE per run while merging, and the runs
+ *        take as much disk space as the records until finish() returns.
+ *
+ *        The directory must be empty, Store::load_keydir() opens it once
+ *        finish() returns.
+ */
+class StoreBuilder
+{
+  private:
+    struct Item
+    {
+        std::string key;
+        std::string value;
+        bool tombstone;
+    };
+
+    /**
+     * @struct Chunk
+     * @brief Encoded records of consecutive items, and their hints with
+     *        offsets relative to the start of the chunk.
+     */
+    struct Chunk
+    {
+        std::string bytes;
+        std::vector<hintfile::Entry> hints;
+    };
+
+    static const std::size_t CHUNK_SIZE;      /** Bytes of keys and values encoded by a task */
+    static const std::size_t RUN_BUFFER_SIZE; /** Bytes read at once from a run while merging */
+    static const std::string RUN_PREFIX;      /** Name of the run files in the directory, before their index */
+
+    std::string db_path_;
+    Options options_;
+    std::uint64_t memory_limit_;
+    ThreadPool pool_;
+    std::vector<Item> items_;
+    std::uint64_t memory_used_; /** Estimated bytes of items_ */
+    std::uint64_t records_;     /** Sets and deletes added, held in items_ or spilled */
+    std::vector<fs::path> runs_;
+    absl::Status status_; /** Error of a spill, returned by add() and finish() */
+
+    /**
+     * @brief Sort the items by key, keeping the order in which the items of a
+     *        key were added: runs are sorted in parallel, then merged.
+     */
+    static void sort(std::vector<Item> &items, ThreadPool &pool);
+
+    /**
+     * @brief Keep the last item of every key.
+     *
+     * @param keep_tombstones Keep the deletes, which override the items of
+     *        the earlier runs, or drop the deleted keys.
+     */
+    static void deduplicate(std::vector<Item> &items, bool keep_tombstones);
+
+    /**
+     * @return absl::Status Status::OK or absl::InvalidArgumentError if the key
+     *         or the value of the item is too large for a record.
+     */
+    static absl::Status check_size(const Item &item);
+
+    /**
+     * @brief Encode the records of some items.
+     *
+     * @return absl::StatusOr<Chunk> The chunk or absl::InvalidArgumentError
+     *         if a key or a value is too large for a record.
+     */
+    static absl::StatusOr<Chunk> encode(const std::vector<Item> &items, const Compressor &compressor,
+                                        std::uint32_t timestamp);
+
+    /**
+     * @brief Create the directory, which must be empty but for the runs.
+     */
+    absl::Status prepare_directory();
+
+    /**
+     * @brief Track the memory of an added item and spill the items once it
+     *        exceeds the memory limit.
+     */
+    void account(const Item &item);
+
+    /**
+     * @brief Sort and deduplicate the items held in memory and write them to
+     *        a new run file.
+     */
+    absl::Status spill();
+
+    /**
+     * @brief Remove the run files.
+     */
+    void remove_runs();
+
+  public:
+    static const std::uint64_t DEFAULT_MEMORY_LIMIT;
+
+    /**
+     * @param db_path Directory of the store, created if it does not exist.
+     * @param options Options of the store: max_file_size and the compression
+     *        settings apply to the records written.
+     * @param threads Threads sorting and encoding the records, 0 for one per
+     *        hardware thread.
+     * @param memory_limit Bytes of keys and values (plus a small overhead per
+     *        record) held in memory before they are spilled to a run, 0 for
+     *        no limit.
+     */
+    StoreBuilder(const std::string &db_path, const Options &options = Options(), std::size_t threads = 0,
+                 std::uint64_t memory_limit = DEFAULT_MEMORY_LIMIT);
+    StoreBuilder(const StoreBuilder &) = delete;
+    StoreBuilder &operator=(const StoreBuilder &) = delete;
+
+    /**
+     * @brief Remove the runs left over if finish() was not called.
+     */
+    ~StoreBuilder();
+
+    /**
+     * @brief Set a key to a value, overriding the previous sets and deletes
+     *        of the key.
+     */
+    void put(std::string key, std::string value);
+
+    /**
+     * @brief Delete a key, as far as the previous sets of the key go.
+     */
+    void del(std::string key);
+
+    /**
+     * @brief Add the records of a reader until its end.
+     *
+     * @return absl::Status Status::OK, the error of the reader or the error
+     *         of a spill. The records read before the error are kept.
+     */
+    absl::Status add(BulkReader &reader);
+
+    /**
+     * @brief Write the datafiles and the hint files. The added records are
+     *        released, whatever the outcome.
+     *
+     * @return absl::StatusOr<BuildStats> The statistics of the build,
+     *         absl::FailedPreconditionError if the directory is not empty,
+     *         absl::InvalidArgumentError if a key or a value is too large,
+     *         absl::DataLossError if a run could not be read back or
+     *         absl::InternalError if a file could not be written. The files
+     *         written and the runs are removed on error.
+     */
+    absl::StatusOr<BuildStats> finish();
+
+    /**
+     * @brief Sets and deletes added so far, spilled ones included.
+     */
+    inline std::uint64_t size() const
+    {
+        return records_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_STORE_BUILDER_HPP_
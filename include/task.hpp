@@ -0,0 +1,182 @@
+/**
+ * @file task.hpp
+ * @author Lucas
+ * @brief Task coroutine type declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_TASK_HPP_
+#define BITCASK_TASK_HPP_
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace store
+{
+
+template <typename T> class Task;
+
+namespace detail
+{
+
+/**
+ * @brief Part of the promise of a Task shared by all the result types: the
+ *        coroutine starts suspended and resumes its awaiter when it is done.
+ */
+struct TaskPromiseBase
+{
+    std::coroutine_handle<> continuation;
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <typename P> std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+        {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    // errors are returned as absl::Status, an exception is a bug
+    void unhandled_exception() noexcept
+    {
+        std::terminate();
+    }
+};
+
+template <typename T> struct TaskPromise : TaskPromiseBase
+{
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    void return_value(T result)
+    {
+        value.emplace(std::move(result));
+    }
+
+    T result()
+    {
+        return std::move(*value);
+    }
+};
+
+template <> struct TaskPromise<void> : TaskPromiseBase
+{
+    Task<void> get_return_object();
+
+    void return_void()
+    {
+    }
+
+    void result()
+    {
+    }
+};
+
+} // namespace detail
+
+/**
+ * @class Task
+ * @brief Lazily started coroutine producing a T. The coroutine runs when the
+ *        task is awaited and resumes the awaiting coroutine when it is done,
+ *        on the thread that completed it (see Executor to get back to a given
+ *        thread). A task is awaited at most once.
+ */
+template <typename T> class Task
+{
+  public:
+    using promise_type = detail::TaskPromise<T>;
+
+  private:
+    std::coroutine_handle<promise_type> handle_;
+
+  public:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle)
+    {
+    }
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return !handle_ || handle_.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume()
+    {
+        return handle_.promise().result();
+    }
+};
+
+namespace detail
+{
+
+template <typename T> Task<T> TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+} // namespace store
+
+#endif // BITCASK_TASK_HPP_
@@ -0,0 +1,81 @@
+/**
+ * @file thread_pool.hpp
+ * @author Lucas
+ * @brief ThreadPool class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_THREAD_POOL_HPP_
+#define BITCASK_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @class ThreadPool
+ * @brief Fixed set of worker threads running submitted tasks in FIFO order.
+ *        The destructor runs the tasks already submitted, then joins the
+ *        workers.
+ */
+class ThreadPool
+{
+  private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stopping_;
+
+    void worker_loop();
+
+  public:
+    /**
+     * @brief Start the workers.
+     *
+     * @param n_threads Number of workers, 0 for one per hardware thread.
+     */
+    explicit ThreadPool(std::size_t n_threads = 0);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    /**
+     * @brief Queue a task.
+     *
+     * @param task Callable without arguments.
+     * @return std::future of the result of the task.
+     */
+    template <typename F> auto submit(F &&task) -> std::future<std::invoke_result_t<F>>
+    {
+        using R = std::invoke_result_t<F>;
+        auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        std::future<R> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([packaged]() { (*packaged)(); });
+        }
+        cv_.notify_one();
+        return result;
+    }
+
+    inline std::size_t size() const
+    {
+        return workers_.size();
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_THREAD_POOL_HPP_
@@ -0,0 +1,146 @@
+/**
+ * @file value_cache.hpp
+ * @author Lucas
+ * @brief ValueCache class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_VALUE_CACHE_HPP_
+#define BITCASK_VALUE_CACHE_HPP_
+
+#include "absl/container/flat_hash_map.h"
+#include "keydir.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @class ValueCache
+ * @brief Memory-bounded cache of values keyed by the position of their
+ *        record. Records are immutable, so an entry can never be stale: a
+ *        set or a delete moves the key to a new record and the old entry is
+ *        simply never looked up again. Each shard evicts with the CLOCK
+ *        algorithm: a hit sets the reference bit of the entry and the hand
+ *        evicts the first entry whose bit is clear, clearing the bits it
+ *        passes.
+ */
+class ValueCache
+{
+  public:
+    /**
+     * @struct Stats
+     * @brief Counters of the cache, summed over the shards.
+     */
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t inserts = 0;
+        std::uint64_t evictions = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;    /** Charge of the cached entries */
+        std::size_t capacity = 0; /** Largest charge of the cached entries */
+
+        inline double hit_ratio() const
+        {
+            return hits + misses > 0 ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+        }
+    };
+
+    static const std::size_t DEFAULT_SHARDS;
+    static const std::size_t ENTRY_OVERHEAD; /** Bytes charged per entry on top of its value */
+
+  private:
+    using Key = std::pair<fileid_t, std::uint64_t>; /** fileid and vpos of the record */
+
+    struct Slot
+    {
+        Key key;
+        std::string value;
+        bool referenced = false;
+        bool used = false;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        absl::flat_hash_map<Key, std::size_t> index; /** Slot of each cached record */
+        std::vector<Slot> slots;
+        std::vector<std::size_t> free_slots;
+        std::size_t hand = 0;
+        std::size_t charge = 0;
+        std::size_t capacity = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t inserts = 0;
+        std::uint64_t evictions = 0;
+
+        /**
+         * @brief Free a slot. mutex must be held.
+         */
+        void release(std::size_t slot);
+
+        /**
+         * @brief Run the hand until the charge fits in the capacity. mutex
+         *        must be held.
+         */
+        void evict_to_fit();
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    std::size_t mask_;
+
+    Shard &shard(const Key &key) const;
+
+  public:
+    /**
+     * @param capacity Largest charge (value bytes plus ENTRY_OVERHEAD per
+     *        entry) of the cached entries, split evenly over the shards.
+     * @param n_shards Number of shards, rounded up to a power of two.
+     */
+    explicit ValueCache(std::size_t capacity, std::size_t n_shards = DEFAULT_SHARDS);
+    ValueCache(const ValueCache &) = delete;
+    ValueCache &operator=(const ValueCache &) = delete;
+
+    /**
+     * @brief Look the value of a record up.
+     *
+     * @return std::optional<std::string> A copy of the value, or nothing on
+     *         a miss.
+     */
+    std::optional<std::string> get(const keydir::Entry &entry) const;
+
+    /**
+     * @brief Cache the value of a record. Values larger than a shard are not
+     *        cached.
+     */
+    void insert(const keydir::Entry &entry, std::string_view value);
+
+    /**
+     * @brief Drop the value of a record, if cached.
+     */
+    void erase(const keydir::Entry &entry);
+
+    /**
+     * @brief Drop the values of the records of a datafile, once it is
+     *        removed by a merge.
+     */
+    void erase_file(fileid_t fileid);
+
+    Stats stats() const;
+};
+
+} // namespace store
+
+#endif // BITCASK_VALUE_CACHE_HPP_
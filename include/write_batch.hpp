@@ -0,0 +1,78 @@
+/**
+ * @file write_batch.hpp
+ * @author Lucas
+ * @brief WriteBatch class declaration
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#ifndef BITCASK_WRITE_BATCH_HPP_
+#define BITCASK_WRITE_BATCH_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @class WriteBatch
+ * @brief Sets and deletes committed together by Store::write: the records are
+ *        appended with a single write and either all or none of them survive
+ *        a crash.
+ */
+class WriteBatch
+{
+  public:
+    struct Op
+    {
+        std::string key;
+        std::string value;
+        bool tombstone; /**< Deletes the key, value is unused */
+    };
+
+  private:
+    std::vector<Op> ops_;
+    std::size_t byte_size_; /** Bytes of the keys and values */
+
+  public:
+    WriteBatch();
+
+    /**
+     * @brief Set a key to a value when the batch is written.
+     */
+    void put(std::string key, std::string value);
+
+    /**
+     * @brief Delete a key when the batch is written. Deleting a key that does
+     *        not exist is not an error.
+     */
+    void del(std::string key);
+
+    void clear();
+
+    inline const std::vector<Op> &ops() const
+    {
+        return ops_;
+    }
+
+    inline std::size_t size() const
+    {
+        return ops_.size();
+    }
+
+    inline bool empty() const
+    {
+        return ops_.empty();
+    }
+
+    inline std::size_t byte_size() const
+    {
+        return byte_size_;
+    }
+};
+
+} // namespace store
+
+#endif // BITCASK_WRITE_BATCH_HPP_
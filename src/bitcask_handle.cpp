@@ -11,7 +11,8 @@
 namespace bitcask
 {
 
-BitcaskHandle::BitcaskHandle(const std::string &db_path) : db_path_(db_path), store_(db_path)
+BitcaskHandle::BitcaskHandle(const std::string &db_path, const store::Options &options)
+    : db_path_(db_path), store_(db_path, options)
 {
     if (!std::filesystem::exists(db_path))
     {
@@ -23,7 +24,9 @@ BitcaskHandle::BitcaskHandle(const std::string &db_path) : db_path_(db_path), st
         if (store_.load_keydir().ok())
         {
             // Successfully loaded keydir in green
-            std::cout << "\033[32;1mSucessfully loaded " << store_.kd_size() << " keys to keydir\033[0m" << std::endl;
+            std::cout << "\033[32;1mSucessfully loaded " << store_.kd_size() << " keys to keydir ("
+                      << static_cast<std::size_t>(store_.kd_stats().bytes_per_key()) << " bytes/key)\033[0m"
+                      << std::endl;
         }
         else
         {
@@ -42,16 +45,79 @@ absl::StatusOr<std::string> BitcaskHandle::get(const std::string &key)
     return store_.get(key);
 }
 
+absl::StatusOr<store::ValueView> BitcaskHandle::get_view(const std::string &key)
+{
+    return store_.get_view(key);
+}
+
+std::vector<absl::StatusOr<std::string>> BitcaskHandle::multi_get(std::span<const std::string_view> keys)
+{
+    return store_.multi_get(keys);
+}
+
+absl::Status BitcaskHandle::put_stream(const std::string &key, std::istream &input, std::uint64_t size)
+{
+    return store_.put_stream(key, input, size);
+}
+
+absl::Status BitcaskHandle::get_stream(const std::string &key, std::ostream &output)
+{
+    return store_.get_stream(key, output);
+}
+
 absl::Status BitcaskHandle::del(const std::string &key)
 {
     return store_.del(key);
 }
 
+absl::Status BitcaskHandle::write(const store::WriteBatch &batch)
+{
+    return store_.write(batch);
+}
+
+store::Task<absl::StatusOr<std::string>> BitcaskHandle::co_get(store::Executor &executor, std::string key)
+{
+    return store_.co_get(executor, std::move(key));
+}
+
+store::Task<absl::Status> BitcaskHandle::co_set(store::Executor &executor, std::string key, std::string value)
+{
+    return store_.co_set(executor, std::move(key), std::move(value));
+}
+
+store::Task<absl::Status> BitcaskHandle::co_del(store::Executor &executor, std::string key)
+{
+    return store_.co_del(executor, std::move(key));
+}
+
+absl::StatusOr<store::BulkStats> BitcaskHandle::load(std::istream &input, store::BulkFormat format,
+                                                     std::size_t batch_bytes)
+{
+    store::BulkReader reader(input, format);
+    return store::bulk_load(store_, reader, batch_bytes);
+}
+
 absl::Status BitcaskHandle::list() const
 {
     return store_.list();
 }
 
+absl::StatusOr<std::vector<std::string>> BitcaskHandle::range(std::string_view begin, std::string_view end,
+                                                              std::size_t limit) const
+{
+    return store_.range(begin, end, limit);
+}
+
+absl::StatusOr<std::vector<std::string>> BitcaskHandle::scan_prefix(std::string_view prefix, std::size_t limit) const
+{
+    return store_.scan_prefix(prefix, limit);
+}
+
+absl::Status BitcaskHandle::merge()
+{
+    return store_.merge();
+}
+
 void BitcaskHandle::help() const
 {
     std::cout << "Available commands:" << '\n';
@@ -59,6 +125,7 @@ void BitcaskHandle::help() const
     std::cout << "  \033[1mset\033[0m <key> <value>\tStore a key-value pair" << '\n';
     std::cout << "  \033[1mdel\033[0m <key>\t\tRemove a key-value pair" << '\n';
     std::cout << "  \033[1mlist\033[0m\t\t\tList all key-value pairs" << '\n';
+    std::cout << "  \033[1mmerge\033[0m\t\t\tReclaim the space of overwritten and deleted keys" << '\n';
     std::cout << "  \033[1mhelp\033[0m\t\t\tDisplay this help message" << '\n';
     std::cout << "  \033[1mquit\033[0m\t\t\tExit the program" << '\n';
 }
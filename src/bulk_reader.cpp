@@ -0,0 +1,332 @@
+/**
+ * @file bulk_reader.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "bulk_reader.hpp"
+
+#include "record.hpp"
+#include "store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace store
+{
+
+const std::size_t BulkReader::DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+static const std::size_t BINARY_HEADER_SIZE = 8;
+
+absl::StatusOr<BulkFormat> parse_bulk_format(std::string_view name)
+{
+    if (name == "commands")
+    {
+        return BulkFormat::kCommands;
+    }
+    if (name == "tsv")
+    {
+        return BulkFormat::kTsv;
+    }
+    if (name == "binary")
+    {
+        return BulkFormat::kBinary;
+    }
+    return absl::InvalidArgumentError("Unknown format: " + std::string(name));
+}
+
+/**
+ * @brief Undo the escapes of a TSV field into out.
+ *
+ * @return bool false if an escape is invalid.
+ */
+static bool unescape(std::string_view field, std::string &out)
+{
+    out.clear();
+    for (std::size_t i = 0; i < field.size(); i++)
+    {
+        if (field[i] != '\\')
+        {
+            out += field[i];
+            continue;
+        }
+        if (++i == field.size())
+        {
+            return false;
+        }
+        switch (field[i])
+        {
+        case 't':
+            out += '\t';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case '\\':
+            out += '\\';
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+BulkReader::BulkReader(std::istream &input, BulkFormat format, std::size_t buffer_size)
+    : input_(input), format_(format), buffer_(std::max<std::size_t>(buffer_size, 1), '\0'), begin_(0), end_(0),
+      eof_(false), offset_(0), line_(0)
+{
+}
+
+bool BulkReader::fill(std::size_t n)
+{
+    if (end_ - begin_ >= n)
+    {
+        return true;
+    }
+
+    // move the unparsed bytes to the front, growing the buffer if they can't
+    // fit with what follows
+    std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    if (buffer_.size() < n)
+    {
+        buffer_.resize(std::max(n, 2 * buffer_.size()));
+    }
+    while (end_ < n && !eof_)
+    {
+        input_.read(buffer_.data() + end_, static_cast<std::streamsize>(buffer_.size() - end_));
+        std::size_t read = static_cast<std::size_t>(input_.gcount());
+        end_ += read;
+        eof_ = read == 0 || !input_;
+    }
+
+    return end_ >= n;
+}
+
+bool BulkReader::next_line(std::string_view &line)
+{
+    std::size_t searched = 0;
+    for (;;)
+    {
+        std::string_view pending(buffer_.data() + begin_, end_ - begin_);
+        std::size_t eol = pending.find('\n', searched);
+        std::size_t size = eol;
+        if (eol == std::string_view::npos)
+        {
+            // only the new bytes are searched after a fill
+            searched = pending.size();
+            if (fill(pending.size() + 1))
+            {
+                continue;
+            }
+            if (pending.empty())
+            {
+                return false;
+            }
+            // the last line has no line break
+            size = pending.size();
+            eol = size - 1;
+        }
+
+        line = pending.substr(0, size);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        begin_ += eol + 1;
+        offset_ += eol + 1;
+        line_++;
+        return true;
+    }
+}
+
+absl::Status BulkReader::error(std::string_view message) const
+{
+    if (format_ == BulkFormat::kBinary)
+    {
+        return absl::InvalidArgumentError("Offset " + std::to_string(offset_) + ": " + std::string(message));
+    }
+    return absl::InvalidArgumentError("Line " + std::to_string(line_) + ": " + std::string(message));
+}
+
+absl::Status BulkReader::parse_command(std::string_view line, BulkRecord &record)
+{
+    // <command> <key> [<value>], the value being the rest of the line
+    auto next_word = [&line]() {
+        std::size_t start = std::min(line.find_first_not_of(" \t"), line.size());
+        std::size_t end = std::min(line.find_first_of(" \t", start), line.size());
+        std::string_view word = line.substr(start, end - start);
+        line.remove_prefix(end);
+        return word;
+    };
+    std::string command(next_word());
+    std::transform(command.begin(), command.end(), command.begin(), ::tolower);
+    record.key = next_word();
+    line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+    if (record.key.empty())
+    {
+        return error("Missing key");
+    }
+
+    if (command == "set" || command == "s")
+    {
+        if (line.empty())
+        {
+            return error("Missing value");
+        }
+        record.value = line;
+        record.tombstone = false;
+    }
+    else if (command == "del" || command == "d")
+    {
+        if (!line.empty())
+        {
+            return error("Unexpected value");
+        }
+        record.value = std::string_view();
+        record.tombstone = true;
+    }
+    else
+    {
+        return error("Unsupported command: " + command);
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status BulkReader::parse_tsv(std::string_view line, BulkRecord &record)
+{
+    std::size_t tab = line.find('\t');
+    if (tab == std::string_view::npos)
+    {
+        return error("Missing tab");
+    }
+    record.key = line.substr(0, tab);
+    record.value = line.substr(tab + 1);
+    record.tombstone = false;
+
+    // the fields are copied only when they hold escapes
+    if (record.key.find('\\') != std::string_view::npos)
+    {
+        if (!unescape(record.key, key_))
+        {
+            return error("Invalid escape");
+        }
+        record.key = key_;
+    }
+    if (record.value.find('\\') != std::string_view::npos)
+    {
+        if (!unescape(record.value, value_))
+        {
+            return error("Invalid escape");
+        }
+        record.value = value_;
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status BulkReader::next_binary(BulkRecord &record)
+{
+    if (!fill(BINARY_HEADER_SIZE))
+    {
+        return begin_ == end_ ? absl::OutOfRangeError("End of input") : error("Truncated record");
+    }
+    std::uint32_t ksz = record::load_le32(buffer_.data() + begin_);
+    std::uint32_t vsz = record::load_le32(buffer_.data() + begin_ + 4);
+    if (ksz > UINT16_MAX)
+    {
+        return error("Key too large");
+    }
+    std::size_t size = BINARY_HEADER_SIZE + ksz + static_cast<std::size_t>(vsz);
+    if (!fill(size))
+    {
+        return error("Truncated record");
+    }
+
+    record.key = std::string_view(buffer_.data() + begin_ + BINARY_HEADER_SIZE, ksz);
+    record.value = std::string_view(buffer_.data() + begin_ + BINARY_HEADER_SIZE + ksz, vsz);
+    record.tombstone = false;
+    begin_ += size;
+    offset_ += size;
+
+    return absl::OkStatus();
+}
+
+absl::Status BulkReader::next(BulkRecord &record)
+{
+    if (format_ == BulkFormat::kBinary)
+    {
+        return next_binary(record);
+    }
+
+    std::string_view line;
+    while (next_line(line))
+    {
+        std::size_t start = line.find_first_not_of(" \t");
+        if (start == std::string_view::npos || line[start] == '#')
+        {
+            continue;
+        }
+        return format_ == BulkFormat::kTsv ? parse_tsv(line, record) : parse_command(line, record);
+    }
+
+    return absl::OutOfRangeError("End of input");
+}
+
+absl::StatusOr<BulkStats> bulk_load(Store &store, BulkReader &reader, std::size_t batch_bytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    BulkStats stats;
+    WriteBatch batch;
+    auto commit = [&]() {
+        absl::Status status = store.write(batch);
+        if (status.ok())
+        {
+            stats.records += batch.size();
+            stats.batches++;
+        }
+        batch.clear();
+        return status;
+    };
+
+    BulkRecord record;
+    absl::Status status;
+    while ((status = reader.next(record)).ok())
+    {
+        if (record.tombstone)
+        {
+            batch.del(std::string(record.key));
+        }
+        else
+        {
+            batch.put(std::string(record.key), std::string(record.value));
+        }
+        if (batch.byte_size() >= batch_bytes && !(status = commit()).ok())
+        {
+            return status;
+        }
+    }
+    if (status.code() != absl::StatusCode::kOutOfRange)
+    {
+        return status;
+    }
+    if (!batch.empty() && !(status = commit()).ok())
+    {
+        return status;
+    }
+
+    stats.bytes = reader.offset();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace store
@@ -0,0 +1,281 @@
+/**
+ * @file compression.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "compression.hpp"
+
+#include "record.hpp"
+#include <cstdint>
+#include <limits>
+
+#ifdef BITCASK_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef BITCASK_HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace store
+{
+
+// Layout of an LZ4 value: size of the uncompressed value (4 bytes,
+// little-endian), LZ4 block. Zstd values are plain Zstd frames, which record
+// the size of the uncompressed value and the id of their dictionary.
+static const std::size_t LZ4_SIZE_PREFIX = 4;
+
+#ifdef BITCASK_HAVE_ZSTD
+struct ZstdCCtxDeleter
+{
+    void operator()(ZSTD_CCtx *cctx) const
+    {
+        ZSTD_freeCCtx(cctx);
+    }
+};
+
+struct ZstdDCtxDeleter
+{
+    void operator()(ZSTD_DCtx *dctx) const
+    {
+        ZSTD_freeDCtx(dctx);
+    }
+};
+
+// contexts are reused by the calls of a thread, creating one allocates
+static ZSTD_CCtx *thread_cctx()
+{
+    thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> cctx(ZSTD_createCCtx());
+    return cctx.get();
+}
+
+static ZSTD_DCtx *thread_dctx()
+{
+    thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> dctx(ZSTD_createDCtx());
+    return dctx.get();
+}
+#endif
+
+struct Compressor::ZstdDicts
+{
+#ifdef BITCASK_HAVE_ZSTD
+    ZSTD_CDict *cdict = nullptr;
+    ZSTD_DDict *ddict = nullptr;
+    unsigned id = 0;
+
+    ~ZstdDicts()
+    {
+        ZSTD_freeCDict(cdict);
+        ZSTD_freeDDict(ddict);
+    }
+#endif
+};
+
+Compressor::Compressor(Compression codec, int level) : codec_(codec), level_(level)
+{
+}
+
+Compressor::~Compressor() = default;
+
+bool Compressor::is_available(Compression codec)
+{
+    switch (codec)
+    {
+    case Compression::kNone:
+        return true;
+    case Compression::kLz4:
+#ifdef BITCASK_HAVE_LZ4
+        return true;
+#else
+        return false;
+#endif
+    case Compression::kZstd:
+#ifdef BITCASK_HAVE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+absl::StatusOr<std::unique_ptr<Compressor>> Compressor::create(Compression codec, int level,
+                                                               std::string_view dictionary)
+{
+    if (!is_available(codec) || (!dictionary.empty() && !is_available(Compression::kZstd)))
+    {
+        return absl::FailedPreconditionError("Compression codec not available in this build");
+    }
+
+    std::unique_ptr<Compressor> compressor(new Compressor(codec, level));
+#ifdef BITCASK_HAVE_ZSTD
+    if (!dictionary.empty())
+    {
+        // digest the dictionary once rather than on every value
+        compressor->dicts_ = std::make_unique<ZstdDicts>();
+        compressor->dicts_->id = ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size());
+        compressor->dicts_->cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+        compressor->dicts_->ddict = ZSTD_createDDict(dictionary.data(), dictionary.size());
+        if (compressor->dicts_->cdict == nullptr || compressor->dicts_->ddict == nullptr)
+        {
+            return absl::InvalidArgumentError("Invalid Zstd dictionary");
+        }
+    }
+#endif
+
+    return compressor;
+}
+
+absl::StatusOr<std::string> Compressor::train_dictionary(const std::vector<std::string> &samples, std::size_t capacity)
+{
+#ifdef BITCASK_HAVE_ZSTD
+    std::string concatenated;
+    std::vector<std::size_t> sizes;
+    sizes.reserve(samples.size());
+    for (const std::string &sample : samples)
+    {
+        concatenated.append(sample);
+        sizes.push_back(sample.size());
+    }
+
+    std::string dictionary(capacity, '\0');
+    std::size_t size = ZDICT_trainFromBuffer(dictionary.data(), dictionary.size(), concatenated.data(), sizes.data(),
+                                             static_cast<unsigned>(sizes.size()));
+    if (ZDICT_isError(size))
+    {
+        return absl::InvalidArgumentError("Failed to train dictionary: " + std::string(ZDICT_getErrorName(size)));
+    }
+    dictionary.resize(size);
+
+    return dictionary;
+#else
+    (void)samples;
+    (void)capacity;
+    return absl::FailedPreconditionError("Zstd not available in this build");
+#endif
+}
+
+Compression Compressor::compress(std::string_view value, std::string &out) const
+{
+    switch (codec_)
+    {
+    case Compression::kNone:
+        break;
+    case Compression::kLz4:
+    {
+#ifdef BITCASK_HAVE_LZ4
+        if (value.size() > LZ4_MAX_INPUT_SIZE)
+        {
+            break;
+        }
+        int input_size = static_cast<int>(value.size());
+        out.resize(LZ4_SIZE_PREFIX + static_cast<std::size_t>(LZ4_compressBound(input_size)));
+        record::store_le32(out.data(), static_cast<std::uint32_t>(value.size()));
+        int size = LZ4_compress_default(value.data(), out.data() + LZ4_SIZE_PREFIX, input_size,
+                                        static_cast<int>(out.size() - LZ4_SIZE_PREFIX));
+        if (size > 0 && LZ4_SIZE_PREFIX + static_cast<std::size_t>(size) < value.size())
+        {
+            out.resize(LZ4_SIZE_PREFIX + static_cast<std::size_t>(size));
+            return Compression::kLz4;
+        }
+#endif
+        break;
+    }
+    case Compression::kZstd:
+    {
+#ifdef BITCASK_HAVE_ZSTD
+        out.resize(ZSTD_compressBound(value.size()));
+        std::size_t size =
+            dicts_ != nullptr
+                ? ZSTD_compress_usingCDict(thread_cctx(), out.data(), out.size(), value.data(), value.size(),
+                                           dicts_->cdict)
+                : ZSTD_compressCCtx(thread_cctx(), out.data(), out.size(), value.data(), value.size(), level_);
+        if (!ZSTD_isError(size) && size < value.size())
+        {
+            out.resize(size);
+            return Compression::kZstd;
+        }
+#endif
+        break;
+    }
+    }
+
+#if !defined(BITCASK_HAVE_LZ4) && !defined(BITCASK_HAVE_ZSTD)
+    (void)value;
+    (void)out;
+#endif
+    return Compression::kNone;
+}
+
+absl::Status Compressor::decompress(Compression codec, std::string_view compressed, std::string &out) const
+{
+    if (!is_available(codec))
+    {
+        return absl::FailedPreconditionError("Value compressed with a codec not available in this build");
+    }
+
+    switch (codec)
+    {
+    case Compression::kNone:
+        out.assign(compressed);
+        return absl::OkStatus();
+    case Compression::kLz4:
+    {
+#ifdef BITCASK_HAVE_LZ4
+        if (compressed.size() < LZ4_SIZE_PREFIX)
+        {
+            return absl::DataLossError("Truncated LZ4 value");
+        }
+        std::uint32_t size = record::load_le32(compressed.data());
+        if (size > LZ4_MAX_INPUT_SIZE)
+        {
+            return absl::DataLossError("Malformed LZ4 value");
+        }
+        out.resize(size);
+        int decompressed = LZ4_decompress_safe(compressed.data() + LZ4_SIZE_PREFIX, out.data(),
+                                               static_cast<int>(compressed.size() - LZ4_SIZE_PREFIX),
+                                               static_cast<int>(size));
+        if (decompressed != static_cast<int>(size))
+        {
+            return absl::DataLossError("Malformed LZ4 value");
+        }
+#endif
+        return absl::OkStatus();
+    }
+    case Compression::kZstd:
+    {
+#ifdef BITCASK_HAVE_ZSTD
+        unsigned long long size = ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+        if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN ||
+            size > std::numeric_limits<std::uint32_t>::max())
+        {
+            return absl::DataLossError("Malformed Zstd value");
+        }
+        unsigned dict_id = ZSTD_getDictID_fromFrame(compressed.data(), compressed.size());
+        if (dict_id != 0 && (dicts_ == nullptr || dicts_->id != dict_id))
+        {
+            return absl::FailedPreconditionError("Value needs Zstd dictionary " + std::to_string(dict_id));
+        }
+
+        out.resize(static_cast<std::size_t>(size));
+        std::size_t decompressed =
+            dict_id != 0 ? ZSTD_decompress_usingDDict(thread_dctx(), out.data(), out.size(), compressed.data(),
+                                                      compressed.size(), dicts_->ddict)
+                         : ZSTD_decompressDCtx(thread_dctx(), out.data(), out.size(), compressed.data(),
+                                               compressed.size());
+        if (ZSTD_isError(decompressed) || decompressed != size)
+        {
+            return absl::DataLossError("Malformed Zstd value");
+        }
+#endif
+        return absl::OkStatus();
+    }
+    }
+
+    return absl::InvalidArgumentError("Unknown compression codec");
+}
+
+} // namespace store
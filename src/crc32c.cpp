@@ -0,0 +1,157 @@
+/**
+ * @file crc32c.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "crc32c.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define BITCASK_CRC32C_SSE42 1
+#endif
+
+namespace crc32c
+{
+
+namespace
+{
+
+// reflected Castagnoli polynomial
+constexpr std::uint32_t POLY = 0x82F63B78;
+
+// tables of the slicing-by-8 algorithm: TABLES[k][b] is the CRC of the byte b
+// followed by k zero bytes
+constexpr std::array<std::array<std::uint32_t, 256>, 8> make_tables()
+{
+    std::array<std::array<std::uint32_t, 256>, 8> tables{};
+    for (std::uint32_t b = 0; b < 256; b++)
+    {
+        std::uint32_t crc = b;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ ((crc & 1) ? POLY : 0);
+        }
+        tables[0][b] = crc;
+    }
+    for (std::uint32_t b = 0; b < 256; b++)
+    {
+        for (std::size_t k = 1; k < 8; k++)
+        {
+            std::uint32_t prev = tables[k - 1][b];
+            tables[k][b] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr std::array<std::array<std::uint32_t, 256>, 8> TABLES = make_tables();
+
+inline std::uint32_t load_le32(const unsigned char *p)
+{
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+#ifdef BITCASK_CRC32C_SSE42
+__attribute__((target("sse4.2"))) std::uint32_t extend_sse42(std::uint32_t crc, const char *data, std::size_t n)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    std::uint32_t l = crc ^ 0xFFFFFFFFu;
+
+    // bytes until the next 8 byte boundary, then 8 bytes per instruction
+    while (n > 0 && (reinterpret_cast<std::uintptr_t>(p) & 7) != 0)
+    {
+        l = _mm_crc32_u8(l, *p++);
+        n--;
+    }
+#if defined(__x86_64__)
+    std::uint64_t l64 = l;
+    while (n >= 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        l64 = _mm_crc32_u64(l64, word);
+        p += 8;
+        n -= 8;
+    }
+    l = static_cast<std::uint32_t>(l64);
+#endif
+    while (n >= 4)
+    {
+        std::uint32_t word;
+        std::memcpy(&word, p, sizeof(word));
+        l = _mm_crc32_u32(l, word);
+        p += 4;
+        n -= 4;
+    }
+    while (n > 0)
+    {
+        l = _mm_crc32_u8(l, *p++);
+        n--;
+    }
+
+    return l ^ 0xFFFFFFFFu;
+}
+#endif
+
+using ExtendFn = std::uint32_t (*)(std::uint32_t, const char *, std::size_t);
+
+ExtendFn select_extend()
+{
+#ifdef BITCASK_CRC32C_SSE42
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return extend_sse42;
+    }
+#endif
+    return extend_portable;
+}
+
+ExtendFn selected_extend()
+{
+    static const ExtendFn extend = select_extend();
+    return extend;
+}
+
+} // namespace
+
+std::uint32_t extend_portable(std::uint32_t crc, const char *data, std::size_t n)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    std::uint32_t l = crc ^ 0xFFFFFFFFu;
+
+    while (n >= 8)
+    {
+        std::uint32_t lo = load_le32(p) ^ l;
+        std::uint32_t hi = load_le32(p + 4);
+        l = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^ TABLES[5][(lo >> 16) & 0xFF] ^ TABLES[4][lo >> 24] ^
+            TABLES[3][hi & 0xFF] ^ TABLES[2][(hi >> 8) & 0xFF] ^ TABLES[1][(hi >> 16) & 0xFF] ^ TABLES[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n > 0)
+    {
+        l = (l >> 8) ^ TABLES[0][(l ^ *p++) & 0xFF];
+        n--;
+    }
+
+    return l ^ 0xFFFFFFFFu;
+}
+
+std::uint32_t extend(std::uint32_t crc, const char *data, std::size_t n)
+{
+    return selected_extend()(crc, data, n);
+}
+
+bool is_accelerated()
+{
+    return selected_extend() != extend_portable;
+}
+
+} // namespace crc32c
@@ -0,0 +1,118 @@
+/**
+ * @file cursor.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "cursor.hpp"
+
+#include "store.hpp"
+
+namespace store
+{
+
+const std::size_t Cursor::DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+Cursor::Cursor(const Store *store, std::vector<fileid_t> fileids, std::size_t buffer_size)
+    : store_(store), fileids_(std::move(fileids)), next_file_(0), buffer_size_(buffer_size), fileid_(0),
+      active_(false), valid_(false), view_(), entry_(), decoded_(false)
+{
+    next();
+}
+
+Cursor::Cursor(Cursor &&other) noexcept
+    : store_(other.store_), fileids_(std::move(other.fileids_)), next_file_(other.next_file_),
+      buffer_size_(other.buffer_size_), reader_(std::move(other.reader_)), fileid_(other.fileid_),
+      active_(other.active_), valid_(other.valid_), view_(other.view_), entry_(other.entry_),
+      value_(std::move(other.value_)), decoded_(other.decoded_), status_(std::move(other.status_))
+{
+    // the key and the value point into the reader, which moved along
+    other.store_ = nullptr;
+    other.valid_ = false;
+}
+
+Cursor::~Cursor()
+{
+    if (store_ != nullptr)
+    {
+        store_->end_scan();
+    }
+}
+
+void Cursor::next()
+{
+    valid_ = false;
+    while (status_.ok())
+    {
+        if (reader_ == nullptr)
+        {
+            if (next_file_ == fileids_.size())
+            {
+                return;
+            }
+            fileid_ = fileids_[next_file_++];
+
+            // the size is read first, the active datafile may grow meanwhile.
+            // A datafile sealed before its size is read holds whole records.
+            active_ = fileid_ == store_->active_fileid();
+            std::error_code ec;
+            std::uint64_t file_size = fs::file_size(store_->datafile_path(fileid_), ec);
+            absl::StatusOr<std::shared_ptr<ReadableFile>> file =
+                ReadableFile::open(store_->datafile_path(fileid_), fileid_);
+            if (ec || !file.ok())
+            {
+                status_ = absl::InternalError("Error opening datafile " + std::to_string(fileid_));
+                return;
+            }
+            reader_ = std::make_unique<RecordReader>(*file, file_size, buffer_size_);
+        }
+
+        absl::Status status = reader_->next(view_);
+        if (!status.ok())
+        {
+            // a record being appended at the end of the active datafile is
+            // cut off by the size read. Otherwise, the records after a
+            // corrupted one are not in the keydir unless the store is set to
+            // fail on them.
+            bool dropped = (active_ && reader_->torn()) ||
+                           store_->options_.corruption_policy == CorruptionPolicy::kTruncate;
+            if (status.code() != absl::StatusCode::kOutOfRange &&
+                !(status.code() == absl::StatusCode::kDataLoss && dropped))
+            {
+                status_ = status;
+            }
+            reader_.reset();
+            continue;
+        }
+
+        // skip the records the keydir does not point to, and the expired ones
+        entry_ = {.fileid = fileid_,
+                  .vsz = view_.header.vsz,
+                  .vpos = reader_->offset() - view_.size(),
+                  .flags = static_cast<std::uint8_t>(view_.header.flags & Store::VALUE_FLAGS),
+                  .expiry = (view_.header.flags & Store::FLAG_EXPIRING) != 0 ? view_.header.timestamp : 0};
+        absl::StatusOr<keydir::Entry> current = store_->keydir_.get(view_.key);
+        if (!current.ok() || !(*current == entry_) || entry_.expired(Store::now()))
+        {
+            continue;
+        }
+
+        decoded_ = entry_.flags != 0;
+        if (decoded_)
+        {
+            absl::StatusOr<std::string> value = store_->decode_value(std::string(view_.value), entry_);
+            if (!value.ok())
+            {
+                status_ = value.status();
+                return;
+            }
+            value_ = std::move(*value);
+        }
+        valid_ = true;
+        return;
+    }
+}
+
+} // namespace store
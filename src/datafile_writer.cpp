@@ -0,0 +1,383 @@
+/**
+ * @file datafile_writer.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "datafile_writer.hpp"
+#include "file_util.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace store
+{
+
+const std::size_t DatafileWriter::MAX_BATCH_RECORDS = IOV_MAX;
+const std::size_t DatafileWriter::MAX_BATCH_BYTES = 4 * 1024 * 1024;
+
+/**
+ * @brief pwrite all the bytes, resuming short writes.
+ */
+static absl::Status write_fully(int fd, std::string_view bytes, std::uint64_t offset)
+{
+    while (!bytes.empty())
+    {
+        ssize_t written = ::pwrite(fd, bytes.data(), bytes.size(), static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return absl::InternalError("Writing to file failed: " + std::string(std::strerror(errno)));
+        }
+        bytes.remove_prefix(static_cast<std::size_t>(written));
+        offset += static_cast<std::uint64_t>(written);
+    }
+
+    return absl::OkStatus();
+}
+
+DatafileWriter::DatafileWriter(int fd, fileid_t fileid, std::uint64_t size, SyncPolicy sync_policy,
+                               std::chrono::milliseconds sync_interval)
+    : fd_(fd), fileid_(fileid), sync_policy_(sync_policy), sync_interval_(sync_interval), size_(size), dirty_(false),
+      closed_(false), stop_flusher_(false)
+{
+    if (sync_policy_ == SyncPolicy::kInterval)
+    {
+        flusher_ = std::thread(&DatafileWriter::flusher_loop, this);
+    }
+}
+
+absl::StatusOr<std::unique_ptr<DatafileWriter>> DatafileWriter::open(const fs::path &path, fileid_t fileid,
+                                                                     SyncPolicy sync_policy,
+                                                                     std::chrono::milliseconds sync_interval)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return absl::InternalError("Failed to open file for writing: " + std::string(std::strerror(errno)));
+    }
+
+    // records are appended after the existing content of the file
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return absl::InternalError("Failed to stat file: " + std::string(std::strerror(errno)));
+    }
+
+    // a new datafile starts with the file header
+    std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+    if (size == 0)
+    {
+        std::string header;
+        append_file_header(header, DATAFILE_MAGIC);
+        if (::pwrite(fd, header.data(), header.size(), 0) != static_cast<ssize_t>(header.size()))
+        {
+            ::close(fd);
+            return absl::InternalError("Failed to write file header: " + std::string(std::strerror(errno)));
+        }
+        size = header.size();
+    }
+
+    return std::unique_ptr<DatafileWriter>(new DatafileWriter(fd, fileid, size, sync_policy, sync_interval));
+}
+
+DatafileWriter::~DatafileWriter()
+{
+    // callers that care about the final sync call close() themselves
+    close().IgnoreError();
+}
+
+absl::StatusOr<std::uint64_t> DatafileWriter::append(std::string_view record, const Callback &on_written)
+{
+    Request req;
+    req.record = record;
+    req.size = record.size();
+    req.on_written = on_written ? &on_written : nullptr;
+
+    return submit(req);
+}
+
+absl::StatusOr<std::uint64_t> DatafileWriter::append_stream(std::uint64_t size, const PieceSource &next,
+                                                            const HeadCallback &head, const Callback &on_written)
+{
+    Stream stream{.next = &next, .head = &head};
+    Request req;
+    req.size = size;
+    req.stream = &stream;
+    req.on_written = on_written ? &on_written : nullptr;
+
+    return submit(req);
+}
+
+absl::StatusOr<std::uint64_t> DatafileWriter::submit(Request &req)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_.push_back(&req);
+
+    // wait until a leader wrote the record or this request is the leader
+    while (!req.done && &req != queue_.front())
+    {
+        req.cv.wait(lock);
+    }
+    if (req.done)
+    {
+        if (!req.status.ok())
+        {
+            return req.status;
+        }
+        return req.offset;
+    }
+
+    // this request is the leader: it writes as many queued records as fit in
+    // a batch. The queue is not popped until the batch is written, so no
+    // other leader can start in the meantime.
+    std::vector<Request *> batch;
+    std::size_t bytes = 0;
+    // a streamed record is written alone
+    for (Request *queued : queue_)
+    {
+        if (batch.size() == MAX_BATCH_RECORDS || (!batch.empty() && bytes + queued->size > MAX_BATCH_BYTES) ||
+            (!batch.empty() && (queued->stream != nullptr || batch.front()->stream != nullptr)))
+        {
+            break;
+        }
+        bytes += queued->size;
+        batch.push_back(queued);
+    }
+
+    absl::Status status = error_;
+    if (closed_)
+    {
+        status = absl::FailedPreconditionError("Datafile is closed");
+    }
+    std::uint64_t offset = size_;
+
+    if (status.ok())
+    {
+        lock.unlock();
+        status = batch.front()->stream != nullptr ? write_stream(*batch.front(), offset) : write_batch(batch, offset);
+        if (status.ok() && sync_policy_ == SyncPolicy::kPerBatch && ::fdatasync(fd_) != 0)
+        {
+            status = absl::InternalError("Failed to sync file: " + std::string(std::strerror(errno)));
+        }
+
+        // callbacks run in record order, before the next leader can start
+        if (status.ok())
+        {
+            std::uint64_t record_offset = offset;
+            for (Request *written : batch)
+            {
+                written->offset = record_offset;
+                if (written->on_written != nullptr)
+                {
+                    (*written->on_written)(record_offset);
+                }
+                record_offset += written->size;
+            }
+        }
+        lock.lock();
+
+        if (status.ok())
+        {
+            size_ += bytes;
+            dirty_ = sync_policy_ != SyncPolicy::kPerBatch;
+        }
+        else if (status.code() == absl::StatusCode::kInternal)
+        {
+            error_ = status;
+        }
+    }
+
+    // hand the results over to the writers of the batch and wake up the next
+    // leader
+    for (Request *done : batch)
+    {
+        queue_.pop_front();
+        done->status = status;
+        done->done = true;
+        if (done != &req)
+        {
+            done->cv.notify_one();
+        }
+    }
+    if (!queue_.empty())
+    {
+        queue_.front()->cv.notify_one();
+    }
+
+    if (!status.ok())
+    {
+        return status;
+    }
+    return req.offset;
+}
+
+absl::Status DatafileWriter::write_batch(const std::vector<Request *> &batch, std::uint64_t offset)
+{
+    std::vector<struct iovec> iov(batch.size());
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+        iov[i].iov_base = const_cast<char *>(batch[i]->record.data());
+        iov[i].iov_len = batch[i]->record.size();
+    }
+
+    // pwritev may write less than requested, resume after the written bytes
+    std::size_t first = 0;
+    while (first < iov.size())
+    {
+        ssize_t written = ::pwritev(fd_, &iov[first], static_cast<int>(iov.size() - first), static_cast<off_t>(offset));
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return absl::InternalError("Writing to file failed: " + std::string(std::strerror(errno)));
+        }
+        offset += static_cast<std::uint64_t>(written);
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while (first < iov.size() && remaining >= iov[first].iov_len)
+        {
+            remaining -= iov[first].iov_len;
+            first++;
+        }
+        if (first < iov.size())
+        {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status DatafileWriter::write_stream(const Request &req, std::uint64_t offset)
+{
+    absl::Status status;
+    std::uint64_t written = 0;
+    while (status.ok())
+    {
+        absl::StatusOr<std::string_view> piece = (*req.stream->next)();
+        if (!piece.ok())
+        {
+            status = piece.status();
+            break;
+        }
+        if (piece->empty())
+        {
+            break;
+        }
+        if (written + piece->size() > req.size)
+        {
+            status = absl::InvalidArgumentError("Streamed record is larger than announced");
+            break;
+        }
+        status = write_fully(fd_, *piece, offset + written);
+        written += piece->size();
+    }
+    if (status.ok() && written != req.size)
+    {
+        status = absl::InvalidArgumentError("Streamed record is smaller than announced");
+    }
+    if (status.ok())
+    {
+        status = write_fully(fd_, (*req.stream->head)(), offset);
+    }
+
+    // drop the partial record, the next append overwrites it otherwise
+    if (!status.ok() && written > 0 && ::ftruncate(fd_, static_cast<off_t>(offset)) != 0)
+    {
+        return absl::InternalError("Failed to truncate file: " + std::string(std::strerror(errno)));
+    }
+
+    return status;
+}
+
+absl::Status DatafileWriter::sync()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return absl::OkStatus();
+        }
+        dirty_ = false;
+    }
+    if (::fdatasync(fd_) != 0)
+    {
+        return absl::InternalError("Failed to sync file: " + std::string(std::strerror(errno)));
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status DatafileWriter::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_)
+        {
+            return absl::OkStatus();
+        }
+    }
+
+    // stop the background sync
+    if (flusher_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_flusher_ = true;
+        }
+        flusher_cv_.notify_one();
+        flusher_.join();
+    }
+
+    absl::Status status;
+    if (sync_policy_ != SyncPolicy::kNone)
+    {
+        status = sync();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    if (::close(fd_) != 0 && status.ok())
+    {
+        status = absl::InternalError("Error closing file: " + std::string(std::strerror(errno)));
+    }
+
+    return status;
+}
+
+void DatafileWriter::flusher_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_flusher_)
+    {
+        flusher_cv_.wait_for(lock, sync_interval_, [this] { return stop_flusher_; });
+        if (dirty_)
+        {
+            lock.unlock();
+            absl::Status status = sync();
+            lock.lock();
+            // the failed pages may be marked clean, a later sync would not
+            // report them: fail the next appends instead
+            if (!status.ok() && error_.ok())
+            {
+                error_ = status;
+            }
+        }
+    }
+}
+
+} // namespace store
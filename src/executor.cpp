@@ -0,0 +1,74 @@
+/**
+ * @file executor.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "executor.hpp"
+
+namespace store
+{
+
+Executor::Executor(std::function<void()> wakeup) : wakeup_(std::move(wakeup)), spawned_(0)
+{
+}
+
+Executor::Detached Executor::drive(Executor &executor, Task<void> task)
+{
+    co_await executor.schedule();
+    co_await task;
+    executor.spawned_--;
+}
+
+void Executor::post(std::coroutine_handle<> handle)
+{
+    // the executor may be destroyed as soon as the handle is resumed, so it
+    // is not touched once the lock is released
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool was_empty = ready_.empty();
+    ready_.push_back(handle);
+    cv_.notify_one();
+    if (was_empty && wakeup_)
+    {
+        wakeup_();
+    }
+}
+
+void Executor::spawn(Task<void> task)
+{
+    spawned_++;
+    drive(*this, std::move(task));
+}
+
+std::size_t Executor::poll()
+{
+    // only the coroutines ready now are resumed, the ones they post are left
+    // for the next call
+    std::deque<std::coroutine_handle<>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(ready_);
+    }
+    for (std::coroutine_handle<> handle : ready)
+    {
+        handle.resume();
+    }
+
+    return ready.size();
+}
+
+void Executor::run_one()
+{
+    std::coroutine_handle<> handle;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !ready_.empty(); });
+        handle = ready_.front();
+        ready_.pop_front();
+    }
+    handle.resume();
+}
+
+} // namespace store
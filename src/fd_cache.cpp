@@ -0,0 +1,168 @@
+/**
+ * @file fd_cache.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "fd_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace store
+{
+
+ReadableFile::ReadableFile(int fd, fileid_t fileid) : fd_(fd), fileid_(fileid)
+{
+}
+
+ReadableFile::~ReadableFile()
+{
+    ::close(fd_);
+}
+
+absl::StatusOr<std::shared_ptr<ReadableFile>> ReadableFile::open(const fs::path &path, fileid_t fileid)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return absl::NotFoundError("Datafile " + path.string() + " not found");
+        }
+        return absl::InternalError("Error opening file: " + std::string(std::strerror(errno)));
+    }
+
+    return std::make_shared<ReadableFile>(fd, fileid);
+}
+
+absl::Status ReadableFile::pread(char *buf, std::size_t n, std::uint64_t offset) const
+{
+    while (n > 0)
+    {
+        ssize_t nread = ::pread(fd_, buf, n, static_cast<off_t>(offset));
+        if (nread < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return absl::InternalError("Error reading from file: " + std::string(std::strerror(errno)));
+        }
+        if (nread == 0)
+        {
+            return absl::OutOfRangeError("Unexpected end of file");
+        }
+        buf += nread;
+        n -= static_cast<std::size_t>(nread);
+        offset += static_cast<std::uint64_t>(nread);
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status ReadableFile::preadv(std::span<iovec> iov, std::uint64_t offset) const
+{
+    while (!iov.empty())
+    {
+        // skip the buffers that are already full
+        if (iov.front().iov_len == 0)
+        {
+            iov = iov.subspan(1);
+            continue;
+        }
+
+        int iovcnt = static_cast<int>(std::min<std::size_t>(iov.size(), IOV_MAX));
+        ssize_t nread = ::preadv(fd_, iov.data(), iovcnt, static_cast<off_t>(offset));
+        if (nread < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return absl::InternalError("Error reading from file: " + std::string(std::strerror(errno)));
+        }
+        if (nread == 0)
+        {
+            return absl::OutOfRangeError("Unexpected end of file");
+        }
+        offset += static_cast<std::uint64_t>(nread);
+
+        // advance the buffers past the bytes read
+        std::size_t left = static_cast<std::size_t>(nread);
+        while (left > 0)
+        {
+            std::size_t n = std::min(left, iov.front().iov_len);
+            iov.front().iov_base = static_cast<char *>(iov.front().iov_base) + n;
+            iov.front().iov_len -= n;
+            left -= n;
+            if (iov.front().iov_len == 0)
+            {
+                iov = iov.subspan(1);
+            }
+        }
+    }
+
+    return absl::OkStatus();
+}
+
+FdCache::FdCache(std::size_t capacity) : capacity_(capacity > 0 ? capacity : 1)
+{
+}
+
+absl::StatusOr<std::shared_ptr<const ReadableFile>> FdCache::get(fileid_t fileid, const fs::path &path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(fileid);
+        if (it != files_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+            return it->second.file;
+        }
+    }
+
+    // open the file outside of the lock, another reader may race us to it in
+    // which case its descriptor is kept
+    absl::StatusOr<std::shared_ptr<ReadableFile>> opened = ReadableFile::open(path, fileid);
+    if (!opened.ok())
+    {
+        return opened.status();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(fileid);
+    if (it != files_.end())
+    {
+        return it->second.file;
+    }
+    while (files_.size() >= capacity_)
+    {
+        files_.erase(lru_.back());
+        lru_.pop_back();
+    }
+    lru_.push_front(fileid);
+    files_[fileid] = Slot{.file = *opened, .lru_pos = lru_.begin()};
+
+    return std::shared_ptr<const ReadableFile>(*opened);
+}
+
+void FdCache::evict(fileid_t fileid)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(fileid);
+    if (it == files_.end())
+    {
+        return;
+    }
+    lru_.erase(it->second.lru_pos);
+    files_.erase(it);
+}
+
+} // namespace store
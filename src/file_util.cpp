@@ -0,0 +1,125 @@
+/**
+ * @file file_util.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "file_util.hpp"
+#include "record.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+namespace store
+{
+
+void append_file_header(std::string &buffer, std::string_view magic)
+{
+    char version[4];
+    record::store_le32(version, FORMAT_VERSION);
+    buffer.append(magic);
+    buffer.append(version, sizeof(version));
+}
+
+absl::Status check_file_header(std::string_view bytes, std::string_view magic, const std::string &name)
+{
+    if (bytes.size() < FILE_HEADER_SIZE)
+    {
+        return absl::DataLossError("Truncated file header in " + name);
+    }
+    if (bytes.substr(0, magic.size()) != magic)
+    {
+        return absl::FailedPreconditionError("Unknown file format of " + name +
+                                             ", it may have been written by an older version");
+    }
+    std::uint32_t version = record::load_le32(bytes.data() + magic.size());
+    if (version != FORMAT_VERSION)
+    {
+        return absl::FailedPreconditionError("Unsupported format version " + std::to_string(version) + " of " +
+                                             name);
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status write_file_durably(const fs::path &path, std::string_view content)
+{
+    fs::path tmp_path = fs::path(path.string() + ".tmp");
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return absl::InternalError("Failed to open file for writing: " + std::string(std::strerror(errno)));
+    }
+    std::size_t written = 0;
+    while (written < content.size())
+    {
+        ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            ::close(fd);
+            return absl::InternalError("Writing to file failed: " + std::string(std::strerror(errno)));
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    // the descriptor is closed whether the sync failed or not
+    int sync_errno = ::fsync(fd) != 0 ? errno : 0;
+    int close_errno = ::close(fd) != 0 ? errno : 0;
+    if (sync_errno != 0)
+    {
+        return absl::InternalError("Failed to sync file: " + std::string(std::strerror(sync_errno)));
+    }
+    if (close_errno != 0)
+    {
+        return absl::InternalError("Failed to close file: " + std::string(std::strerror(close_errno)));
+    }
+
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        return absl::InternalError("Failed to rename file: " + ec.message());
+    }
+
+    return sync_directory(path.has_parent_path() ? path.parent_path() : fs::path("."));
+}
+
+absl::Status sync_directory(const fs::path &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return absl::InternalError("Failed to open directory: " + std::string(std::strerror(errno)));
+    }
+    int sync_errno = ::fsync(fd) != 0 ? errno : 0;
+    ::close(fd);
+    if (sync_errno != 0)
+    {
+        return absl::InternalError("Failed to sync directory: " + std::string(std::strerror(sync_errno)));
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status seal_file(const fs::path &path)
+{
+    std::error_code ec;
+    fs::permissions(path, fs::perms::owner_write | fs::perms::group_write | fs::perms::others_write,
+                    fs::perm_options::remove, ec);
+    if (ec)
+    {
+        return absl::InternalError("Error sealing datafile: " + ec.message());
+    }
+
+    return absl::OkStatus();
+}
+
+} // namespace store
@@ -0,0 +1,114 @@
+/**
+ * @file hintfile.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "hintfile.hpp"
+#include "crc32c.hpp"
+#include "file_util.hpp"
+#include "record.hpp"
+
+#include <fstream>
+
+namespace hintfile
+{
+
+// Layout of an entry, integers little-endian: CRC32C of the rest of the entry
+// (4 bytes), tombstone flag (1 byte), record flags (1 byte), ksz (2 bytes), vsz
+// (4 bytes), vpos (8 bytes), expiry (4 bytes), key (ksz bytes). The entries
+// follow the file header.
+static const std::size_t CRC_SIZE = 4;
+static const std::size_t ENTRY_HEADER_SIZE = CRC_SIZE + 1 + 1 + 2 + 4 + 8 + 4;
+
+absl::Status write(const fs::path &path, const std::vector<Entry> &entries)
+{
+    std::string content;
+    std::size_t size = store::FILE_HEADER_SIZE;
+    for (const Entry &entry : entries)
+    {
+        size += ENTRY_HEADER_SIZE + entry.key.size();
+    }
+    content.reserve(size);
+    store::append_file_header(content, store::HINTFILE_MAGIC);
+
+    for (const Entry &entry : entries)
+    {
+        char header[ENTRY_HEADER_SIZE];
+        std::uint16_t ksz = static_cast<std::uint16_t>(entry.key.size());
+        header[4] = entry.tombstone ? 1 : 0;
+        header[5] = static_cast<char>(entry.flags);
+        record::store_le16(header + 6, ksz);
+        record::store_le32(header + 8, entry.vsz);
+        record::store_le64(header + 12, entry.vpos);
+        record::store_le32(header + 20, entry.expiry);
+        std::size_t start = content.size();
+        content.append(header, ENTRY_HEADER_SIZE);
+        content.append(entry.key);
+        record::store_le32(content.data() + start,
+                           crc32c::value(std::string_view(content).substr(start + CRC_SIZE)));
+    }
+
+    return store::write_file_durably(path, content);
+}
+
+absl::Status read(const fs::path &path, const std::function<absl::Status(const Entry &)> &callback)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return absl::NotFoundError("Hint file " + path.string() + " not found");
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad())
+    {
+        return absl::InternalError("Error reading from file");
+    }
+    absl::Status status = store::check_file_header(std::string_view(content).substr(0, store::FILE_HEADER_SIZE),
+                                                   store::HINTFILE_MAGIC, "hint file " + path.string());
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    Entry entry;
+    std::size_t pos = store::FILE_HEADER_SIZE;
+    while (pos < content.size())
+    {
+        if (content.size() - pos < ENTRY_HEADER_SIZE)
+        {
+            return absl::DataLossError("Truncated hint file " + path.string());
+        }
+        const char *header = content.data() + pos;
+        std::uint16_t ksz = record::load_le16(header + 6);
+        if (content.size() - pos - ENTRY_HEADER_SIZE < ksz)
+        {
+            return absl::DataLossError("Truncated hint file " + path.string());
+        }
+        std::string_view bytes = std::string_view(content).substr(pos, ENTRY_HEADER_SIZE + ksz);
+        if (crc32c::value(bytes.substr(CRC_SIZE)) != record::load_le32(header))
+        {
+            return absl::DataLossError("Checksum mismatch in hint file " + path.string() + " at offset " +
+                                       std::to_string(pos));
+        }
+        entry.tombstone = header[4] != 0;
+        entry.flags = static_cast<std::uint8_t>(header[5]);
+        entry.vsz = record::load_le32(header + 8);
+        entry.vpos = record::load_le64(header + 12);
+        entry.expiry = record::load_le32(header + 20);
+        entry.key.assign(bytes.substr(ENTRY_HEADER_SIZE));
+        pos += bytes.size();
+
+        status = callback(entry);
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+
+    return absl::OkStatus();
+}
+
+} // namespace hintfile
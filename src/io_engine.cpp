@@ -0,0 +1,369 @@
+/**
+ * @file io_engine.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "io_engine.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace store
+{
+
+/**
+ * @class IoUring
+ * @brief Minimal io_uring instance driven with the raw system calls: a
+ *        submission ring filled under the engine mutex and a completion ring
+ *        drained by the reaper thread only. The reaper only waits on the ring
+ *        while reads are in flight, their completions wake it up.
+ */
+class IoUring
+{
+  private:
+    int fd_;
+    void *sq_ring_;
+    std::size_t sq_ring_size_;
+    void *cq_ring_;
+    std::size_t cq_ring_size_;
+    io_uring_sqe *sqes_;
+    std::size_t sqes_size_;
+
+    unsigned *sq_tail_;
+    unsigned *sq_mask_;
+    unsigned *sq_array_;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned *cq_mask_;
+    io_uring_cqe *cqes_;
+
+    IoUring() : fd_(-1), sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED), sqes_(static_cast<io_uring_sqe *>(MAP_FAILED))
+    {
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+  public:
+    IoUring(const IoUring &) = delete;
+    IoUring &operator=(const IoUring &) = delete;
+
+    ~IoUring()
+    {
+        if (sqes_ != MAP_FAILED)
+        {
+            ::munmap(sqes_, sqes_size_);
+        }
+        if (cq_ring_ != MAP_FAILED)
+        {
+            ::munmap(cq_ring_, cq_ring_size_);
+        }
+        if (sq_ring_ != MAP_FAILED)
+        {
+            ::munmap(sq_ring_, sq_ring_size_);
+        }
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+
+    static absl::StatusOr<std::unique_ptr<IoUring>> create(unsigned entries)
+    {
+        std::unique_ptr<IoUring> ring(new IoUring());
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        ring->fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (ring->fd_ < 0)
+        {
+            return absl::UnavailableError("io_uring is not available: " + std::string(std::strerror(errno)));
+        }
+
+        // the rings are mapped separately, which also works on kernels
+        // without IORING_FEAT_SINGLE_MMAP
+        ring->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->sq_ring_ = ::mmap(nullptr, ring->sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ring->fd_, IORING_OFF_SQ_RING);
+        ring->cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ring->cq_ring_ = ::mmap(nullptr, ring->cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ring->fd_, IORING_OFF_CQ_RING);
+        ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        ring->sqes_ = static_cast<io_uring_sqe *>(::mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                                                         MAP_SHARED | MAP_POPULATE, ring->fd_, IORING_OFF_SQES));
+        if (ring->sq_ring_ == MAP_FAILED || ring->cq_ring_ == MAP_FAILED || ring->sqes_ == MAP_FAILED)
+        {
+            return absl::UnavailableError("Failed to map the io_uring rings: " + std::string(std::strerror(errno)));
+        }
+
+        char *sq = static_cast<char *>(ring->sq_ring_);
+        ring->sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        ring->sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        ring->sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        char *cq = static_cast<char *>(ring->cq_ring_);
+        ring->cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        ring->cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        ring->cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        ring->cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        return ring;
+    }
+
+    /**
+     * @brief Queue an operation and submit it to the kernel. The caller must
+     *        serialize the submissions and keep fewer operations in flight
+     *        than the ring has entries.
+     */
+    absl::Status submit(std::uint8_t opcode, int fd, const iovec *iov, std::uint64_t offset, std::uint64_t user_data)
+    {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & *sq_mask_;
+        io_uring_sqe &sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe.len = iov != nullptr ? 1 : 0;
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+
+        while (enter(1, 0, 0) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            // the kernel did not consume the entry, take it back
+            int error = errno;
+            std::atomic_ref<unsigned>(*sq_tail_).store(tail, std::memory_order_release);
+            return absl::InternalError("Failed to submit to io_uring: " + std::string(std::strerror(error)));
+        }
+
+        return absl::OkStatus();
+    }
+
+    /**
+     * @brief Block until at least one completion is available.
+     */
+    void wait()
+    {
+        while (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR)
+        {
+        }
+    }
+
+    /**
+     * @brief Pass the available completions to fn(user_data, res) and
+     *        release them.
+     */
+    template <typename F> void reap(F &&fn)
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+            std::uint64_t user_data = cqe.user_data;
+            int res = cqe.res;
+            std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+            fn(user_data, res);
+        }
+    }
+};
+
+IoEngine::IoEngine(std::unique_ptr<IoUring> ring, unsigned queue_depth, std::size_t n_threads)
+    : ring_(std::move(ring)), queue_depth_(queue_depth > 0 ? queue_depth : 1), pool_(n_threads), in_flight_(0),
+      stopping_(false)
+{
+    if (ring_ != nullptr)
+    {
+        reaper_ = std::thread(&IoEngine::reaper_loop, this);
+    }
+}
+
+IoEngine::~IoEngine()
+{
+    if (ring_ == nullptr)
+    {
+        return;
+    }
+
+    // the reaper exits once the reads in flight are done, their completions
+    // wake it up if it waits on the ring
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    reaper_cv_.notify_one();
+    reaper_.join();
+}
+
+absl::StatusOr<std::unique_ptr<IoEngine>> IoEngine::create(IoBackend backend, unsigned queue_depth,
+                                                           std::size_t n_threads)
+{
+    std::unique_ptr<IoUring> ring;
+    if (backend != IoBackend::kThreadPool)
+    {
+        absl::StatusOr<std::unique_ptr<IoUring>> created = IoUring::create(queue_depth > 0 ? queue_depth : 1);
+        if (created.ok())
+        {
+            ring = std::move(*created);
+        }
+        else if (backend == IoBackend::kIoUring)
+        {
+            return created.status();
+        }
+    }
+
+    return std::make_unique<IoEngine>(std::move(ring), queue_depth, n_threads);
+}
+
+void IoEngine::read(std::shared_ptr<const ReadableFile> file, char *buf, std::size_t n, std::uint64_t offset,
+                    Callback done)
+{
+    if (n == 0)
+    {
+        done(absl::OkStatus());
+        return;
+    }
+    if (ring_ == nullptr)
+    {
+        pool_.submit([file = std::move(file), buf, n, offset, done = std::move(done)]() {
+            done(file->pread(buf, n, offset));
+        });
+        return;
+    }
+
+    ReadOp *op = new ReadOp{
+        .file = std::move(file), .iov = {.iov_base = buf, .iov_len = n}, .offset = offset, .done = std::move(done)};
+    absl::Status status;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (in_flight_ == queue_depth_)
+        {
+            backlog_.push_back(op);
+            return;
+        }
+        // a read counts as in flight only once submitted: the reaper would
+        // otherwise wait on the ring for a completion that never comes
+        status = submit(op);
+        if (status.ok())
+        {
+            in_flight_++;
+        }
+    }
+    if (!status.ok())
+    {
+        op->done(status);
+        delete op;
+        return;
+    }
+    reaper_cv_.notify_one();
+}
+
+void IoEngine::run(std::function<void()> task)
+{
+    pool_.submit(std::move(task));
+}
+
+absl::Status IoEngine::submit(ReadOp *op)
+{
+    return ring_->submit(IORING_OP_READV, op->file->fd(), &op->iov, op->offset, reinterpret_cast<std::uint64_t>(op));
+}
+
+void IoEngine::finish(ReadOp *op, absl::Status status)
+{
+    // hand the slot over to the next read of the backlog
+    std::vector<ReadOp *> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_--;
+        while (!backlog_.empty() && in_flight_ < queue_depth_)
+        {
+            ReadOp *next = backlog_.front();
+            backlog_.pop_front();
+            in_flight_++;
+            if (!submit(next).ok())
+            {
+                in_flight_--;
+                failed.push_back(next);
+            }
+        }
+    }
+
+    op->done(status);
+    delete op;
+    for (ReadOp *next : failed)
+    {
+        next->done(absl::InternalError("Failed to submit to io_uring"));
+        delete next;
+    }
+}
+
+void IoEngine::reaper_loop()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            reaper_cv_.wait(lock, [this]() { return stopping_ || in_flight_ > 0; });
+            if (in_flight_ == 0 && backlog_.empty())
+            {
+                break;
+            }
+        }
+
+        // the reads are submitted under mutex_, taking it orders their
+        // fields before their completions for tools that do not see through
+        // the ring, such as the thread sanitizer
+        ring_->wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        ring_->reap([this](std::uint64_t user_data, int res) {
+            ReadOp *op = reinterpret_cast<ReadOp *>(user_data);
+            absl::Status status;
+            if (res == -EINTR || res == -EAGAIN)
+            {
+                res = 0; // resubmitted as is
+            }
+            else if (res < 0)
+            {
+                status = absl::InternalError("Error reading from file: " + std::string(std::strerror(-res)));
+            }
+            else if (res == 0)
+            {
+                status = absl::OutOfRangeError("Unexpected end of file");
+            }
+
+            // resume short reads after the bytes read
+            op->iov.iov_base = static_cast<char *>(op->iov.iov_base) + res;
+            op->iov.iov_len -= static_cast<std::size_t>(res);
+            op->offset += static_cast<std::uint64_t>(res);
+            if (status.ok() && op->iov.iov_len > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                status = submit(op);
+                if (status.ok())
+                {
+                    return;
+                }
+            }
+            finish(op, status);
+        });
+    }
+}
+
+} // namespace store
@@ -8,39 +8,366 @@
 
 #include "keydir.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace keydir
 {
 
-KeyDir::KeyDir()
+const std::size_t KeyArena::MIN_BLOCK_SIZE = 1024;
+const std::size_t KeyArena::BLOCK_SIZE = 64 * 1024;
+const std::size_t KeyDir::DEFAULT_SHARDS = 64;
+
+KeyArena::KeyArena() : block_size_(0), block_used_(0), allocated_bytes_(0)
+{
+}
+
+std::string_view KeyArena::add(std::string_view key)
+{
+    // keys larger than a block get a block of their own, the current block
+    // keeps being filled
+    if (key.size() > BLOCK_SIZE / 4)
+    {
+        auto block = std::make_unique<char[]>(key.size());
+        std::memcpy(block.get(), key.data(), key.size());
+        std::string_view copy(block.get(), key.size());
+        blocks_.insert(blocks_.end() - (blocks_.empty() ? 0 : 1), std::move(block));
+        allocated_bytes_ += key.size();
+        return copy;
+    }
+
+    if (block_used_ + key.size() > block_size_)
+    {
+        block_size_ = std::max(std::clamp(allocated_bytes_, MIN_BLOCK_SIZE, BLOCK_SIZE), key.size());
+        blocks_.push_back(std::make_unique<char[]>(block_size_));
+        block_used_ = 0;
+        allocated_bytes_ += block_size_;
+    }
+    char *dst = blocks_.back().get() + block_used_;
+    std::memcpy(dst, key.data(), key.size());
+    block_used_ += key.size();
+
+    return std::string_view(dst, key.size());
+}
+
+void KeyDir::Shard::put(std::string_view key, const Entry &entry)
+{
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+        it->second = entry;
+        return;
+    }
+    entries.emplace(arena->add(key), entry);
+    live_bytes += key.size();
+}
+
+bool KeyDir::Shard::erase(std::string_view key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        return false;
+    }
+    entries.erase(it);
+    live_bytes -= key.size();
+    dead_bytes += key.size();
+
+    return true;
+}
+
+void KeyDir::Shard::maybe_compact()
+{
+    if (dead_bytes < KeyArena::BLOCK_SIZE || dead_bytes < live_bytes)
+    {
+        return;
+    }
+
+    auto compacted = std::make_unique<KeyArena>();
+    absl::flat_hash_map<std::string_view, Entry> moved;
+    moved.reserve(entries.size());
+    for (const auto &[key, entry] : entries)
+    {
+        moved.emplace(compacted->add(key), entry);
+    }
+    entries = std::move(moved);
+    arena = std::move(compacted);
+    dead_bytes = 0;
+}
+
+void KeyDir::OrderedIndex::put(std::string_view key, std::uint32_t expiry)
+{
+    auto it = keys.find(key);
+    if (it != keys.end())
+    {
+        it->second = expiry;
+        return;
+    }
+    keys.emplace(key, expiry);
+}
+
+KeyDir::KeyDir(std::size_t n_shards, bool ordered)
 {
-    std::unordered_map<std::string, Entry> keydir_;
+    std::size_t count = 1;
+    while (count < n_shards)
+    {
+        count <<= 1;
+    }
+    shards_ = std::make_unique<Shard[]>(count);
+    shard_mask_ = count - 1;
+    if (ordered)
+    {
+        index_ = std::make_unique<OrderedIndex>();
+    }
 }
 
-absl::Status KeyDir::set(const std::string &key, const Entry &entry)
+std::size_t KeyDir::shard_index(std::string_view key) const
 {
-    keydir_[key] = entry;
+    // the tables of the shards probe with the low bits of the same hash,
+    // pick the shard with the high bits
+    std::uint64_t hash = absl::Hash<std::string_view>{}(key);
+    return (hash >> 48) & shard_mask_;
+}
+
+absl::Status KeyDir::set(std::string_view key, const Entry &entry)
+{
+    Shard &s = shard(key);
+    std::unique_lock<std::shared_mutex> lock(s.mutex);
+    s.put(key, entry);
+    if (index_ != nullptr)
+    {
+        std::unique_lock<std::shared_mutex> index_lock(index_->mutex);
+        index_->put(key, entry.expiry);
+    }
 
     return absl::OkStatus();
 }
 
-absl::StatusOr<Entry> KeyDir::get(const std::string &key) const
+absl::StatusOr<Entry> KeyDir::get(std::string_view key) const
 {
-    if (keydir_.find(key) == keydir_.end())
+    const Shard &s = shard(key);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if (it == s.entries.end())
     {
-        return absl::NotFoundError("Key: " + key + " not found");
+        return absl::NotFoundError("Key: " + std::string(key) + " not found");
     }
-    return keydir_.at(key);
+    return it->second;
 }
 
-absl::Status KeyDir::del(const std::string &key)
+absl::Status KeyDir::del(std::string_view key)
 {
-    if (keydir_.find(key) == keydir_.end())
+    Shard &s = shard(key);
+    std::unique_lock<std::shared_mutex> lock(s.mutex);
+    if (!s.erase(key))
     {
-        return absl::NotFoundError("Key: " + key + " not found");
+        return absl::NotFoundError("Key: " + std::string(key) + " not found");
     }
-    keydir_.erase(key);
+    if (index_ != nullptr)
+    {
+        std::unique_lock<std::shared_mutex> index_lock(index_->mutex);
+        index_->keys.erase(key);
+    }
+    s.maybe_compact();
 
     return absl::OkStatus();
 }
 
-} // namespace keydir
\ No newline at end of file
+bool KeyDir::replace_if(std::string_view key, const Entry &expected, const Entry &replacement)
+{
+    Shard &s = shard(key);
+    std::unique_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if (it == s.entries.end() || !(it->second == expected))
+    {
+        return false;
+    }
+    it->second = replacement;
+
+    return true;
+}
+
+bool KeyDir::erase_if(std::string_view key, const Entry &expected)
+{
+    Shard &s = shard(key);
+    std::unique_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    if (it == s.entries.end() || !(it->second == expected))
+    {
+        return false;
+    }
+    s.erase(key);
+    if (index_ != nullptr)
+    {
+        std::unique_lock<std::shared_mutex> index_lock(index_->mutex);
+        index_->keys.erase(key);
+    }
+    s.maybe_compact();
+
+    return true;
+}
+
+std::size_t KeyDir::erase_expired(std::uint32_t now)
+{
+    std::size_t erased = 0;
+    for (std::size_t i = 0; i <= shard_mask_; i++)
+    {
+        Shard &s = shards_[i];
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        for (auto it = s.entries.begin(); it != s.entries.end();)
+        {
+            if (!it->second.expired(now))
+            {
+                ++it;
+                continue;
+            }
+            if (index_ != nullptr)
+            {
+                std::unique_lock<std::shared_mutex> index_lock(index_->mutex);
+                index_->keys.erase(it->first);
+            }
+            s.live_bytes -= it->first.size();
+            s.dead_bytes += it->first.size();
+            s.entries.erase(it++);
+            erased++;
+        }
+        s.maybe_compact();
+    }
+
+    return erased;
+}
+
+bool KeyDir::contains(std::string_view key) const
+{
+    const Shard &s = shard(key);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    return s.entries.contains(key);
+}
+
+void KeyDir::apply(const std::vector<Update> &updates)
+{
+    // lock the shards in index order so that concurrent batches cannot
+    // deadlock
+    std::vector<std::size_t> indexes;
+    indexes.reserve(updates.size());
+    for (const Update &update : updates)
+    {
+        indexes.push_back(shard_index(update.key));
+    }
+    std::vector<std::size_t> locked = indexes;
+    std::sort(locked.begin(), locked.end());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(locked.size());
+    for (std::size_t index : locked)
+    {
+        locks.emplace_back(shards_[index].mutex);
+    }
+
+    for (std::size_t i = 0; i < updates.size(); i++)
+    {
+        Shard &s = shards_[indexes[i]];
+        if (updates[i].remove)
+        {
+            s.erase(updates[i].key);
+        }
+        else
+        {
+            s.put(updates[i].key, updates[i].entry);
+        }
+    }
+    if (index_ != nullptr)
+    {
+        std::unique_lock<std::shared_mutex> index_lock(index_->mutex);
+        for (const Update &update : updates)
+        {
+            if (update.remove)
+            {
+                index_->keys.erase(update.key);
+            }
+            else
+            {
+                index_->put(update.key, update.entry.expiry);
+            }
+        }
+    }
+    for (std::size_t index : locked)
+    {
+        shards_[index].maybe_compact();
+    }
+}
+
+std::vector<std::string> KeyDir::keys() const
+{
+    std::vector<std::string> keys;
+    keys.reserve(size());
+    for (std::size_t i = 0; i <= shard_mask_; i++)
+    {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+        for (const auto &[key, entry] : shards_[i].entries)
+        {
+            keys.emplace_back(key);
+        }
+    }
+
+    return keys;
+}
+
+absl::StatusOr<std::vector<std::string>> KeyDir::range(std::string_view begin, std::string_view end,
+                                                       std::size_t limit, std::uint32_t now) const
+{
+    if (index_ == nullptr)
+    {
+        return absl::FailedPreconditionError("The keydir is not ordered");
+    }
+
+    std::vector<std::string> keys;
+    std::shared_lock<std::shared_mutex> lock(index_->mutex);
+    for (auto it = index_->keys.lower_bound(begin); it != index_->keys.end(); ++it)
+    {
+        if ((!end.empty() && it->first >= end) || (limit != 0 && keys.size() == limit))
+        {
+            break;
+        }
+        if (it->second == 0 || it->second > now)
+        {
+            keys.push_back(it->first);
+        }
+    }
+
+    return keys;
+}
+
+std::size_t KeyDir::size() const
+{
+    std::size_t size = 0;
+    for (std::size_t i = 0; i <= shard_mask_; i++)
+    {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+        size += shards_[i].entries.size();
+    }
+
+    return size;
+}
+
+Stats KeyDir::stats() const
+{
+    using Slot = std::pair<const std::string_view, Entry>;
+
+    Stats stats;
+    for (std::size_t i = 0; i <= shard_mask_; i++)
+    {
+        std::shared_lock<std::shared_mutex> lock(shards_[i].mutex);
+        const Shard &s = shards_[i];
+        stats.keys += s.entries.size();
+        // one slot and one control byte per bucket
+        stats.table_bytes += s.entries.capacity() * (sizeof(Slot) + 1);
+        stats.arena_bytes += s.arena->allocated_bytes();
+        stats.dead_bytes += s.dead_bytes;
+    }
+
+    return stats;
+}
+
+} // namespace keydir
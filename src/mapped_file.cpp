@@ -0,0 +1,125 @@
+/**
+ * @file mapped_file.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace store
+{
+
+MappedFile::MappedFile(const char *data, std::size_t size, fileid_t fileid) : data_(data), size_(size), fileid_(fileid)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if (size_ > 0)
+    {
+        ::munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+absl::StatusOr<std::shared_ptr<MappedFile>> MappedFile::open(const fs::path &path, fileid_t fileid,
+                                                             MadvisePolicy policy)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        if (errno == ENOENT)
+        {
+            return absl::NotFoundError("Datafile " + path.string() + " not found");
+        }
+        return absl::InternalError("Error opening file: " + std::string(std::strerror(errno)));
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return absl::InternalError("Failed to stat file: " + std::string(std::strerror(errno)));
+    }
+
+    // mmap rejects empty mappings
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size == 0)
+    {
+        ::close(fd);
+        return std::make_shared<MappedFile>(nullptr, 0, fileid);
+    }
+
+    // the mapping keeps a reference on the file, the descriptor is not needed
+    void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return absl::InternalError("Failed to map file: " + std::string(std::strerror(errno)));
+    }
+
+    int advice = MADV_NORMAL;
+    switch (policy)
+    {
+    case MadvisePolicy::kRandom:
+        advice = MADV_RANDOM;
+        break;
+    case MadvisePolicy::kSequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case MadvisePolicy::kNormal:
+        break;
+    }
+    ::madvise(data, size, advice);
+
+    return std::make_shared<MappedFile>(static_cast<const char *>(data), size, fileid);
+}
+
+absl::StatusOr<std::string_view> MappedFile::view(std::uint64_t offset, std::size_t n) const
+{
+    if (offset > size_ || n > size_ - offset)
+    {
+        return absl::OutOfRangeError("Unexpected end of file");
+    }
+
+    return std::string_view(data_ + offset, n);
+}
+
+MmapCache::MmapCache(MadvisePolicy policy) : policy_(policy)
+{
+}
+
+absl::StatusOr<std::shared_ptr<const MappedFile>> MmapCache::get(fileid_t fileid, const fs::path &path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(fileid);
+    if (it != files_.end())
+    {
+        return it->second;
+    }
+
+    absl::StatusOr<std::shared_ptr<MappedFile>> mapped = MappedFile::open(path, fileid, policy_);
+    if (!mapped.ok())
+    {
+        return mapped.status();
+    }
+    files_[fileid] = *mapped;
+
+    return std::shared_ptr<const MappedFile>(*mapped);
+}
+
+void MmapCache::evict(fileid_t fileid)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.erase(fileid);
+}
+
+} // namespace store
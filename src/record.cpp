@@ -0,0 +1,78 @@
+/**
+ * @file record.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "record.hpp"
+
+#include "crc32c.hpp"
+
+namespace record
+{
+
+void encode_header(const Header &header, char *out)
+{
+    store_le32(out, header.crc);
+    store_le32(out + CRC_SIZE, header.timestamp);
+    store_le16(out + CRC_SIZE + TIMESTAMP_SIZE, header.ksz);
+    store_le32(out + CRC_SIZE + TIMESTAMP_SIZE + KSZ_SIZE, header.vsz);
+    out[CRC_SIZE + TIMESTAMP_SIZE + KSZ_SIZE + VSZ_SIZE] = static_cast<char>(header.flags);
+}
+
+Header decode_header(const char *in)
+{
+    return Header{.crc = load_le32(in),
+                  .timestamp = load_le32(in + CRC_SIZE),
+                  .ksz = load_le16(in + CRC_SIZE + TIMESTAMP_SIZE),
+                  .vsz = load_le32(in + CRC_SIZE + TIMESTAMP_SIZE + KSZ_SIZE),
+                  .flags = static_cast<std::uint8_t>(in[CRC_SIZE + TIMESTAMP_SIZE + KSZ_SIZE + VSZ_SIZE])};
+}
+
+void append(std::string &buffer, std::string_view key, std::string_view value, std::uint8_t flags,
+            std::uint32_t timestamp)
+{
+    std::size_t start = buffer.size();
+    buffer.resize(start + encoded_size(key.size(), value.size()));
+    char *out = buffer.data() + start;
+
+    Header header{.crc = 0,
+                  .timestamp = timestamp,
+                  .ksz = static_cast<std::uint16_t>(key.size()),
+                  .vsz = static_cast<std::uint32_t>(value.size()),
+                  .flags = flags};
+    encode_header(header, out);
+    key.copy(out + HEADER_SIZE, key.size());
+    value.copy(out + HEADER_SIZE + key.size(), value.size());
+
+    // the checksum covers everything after itself
+    std::size_t size = buffer.size() - start;
+    store_le32(out, crc32c::extend(0, out + CRC_SIZE, size - CRC_SIZE));
+}
+
+ParseResult parse(std::string_view bytes, View &view)
+{
+    if (bytes.size() < HEADER_SIZE)
+    {
+        return ParseResult::kTruncated;
+    }
+    view.header = decode_header(bytes.data());
+
+    std::uint64_t size = encoded_size(view.header.ksz, view.header.vsz);
+    if (bytes.size() < size)
+    {
+        return ParseResult::kTruncated;
+    }
+    if (crc32c::extend(0, bytes.data() + CRC_SIZE, size - CRC_SIZE) != view.header.crc)
+    {
+        return ParseResult::kCorrupted;
+    }
+
+    view.key = bytes.substr(HEADER_SIZE, view.header.ksz);
+    view.value = bytes.substr(HEADER_SIZE + view.header.ksz, view.header.vsz);
+    return ParseResult::kOk;
+}
+
+} // namespace record
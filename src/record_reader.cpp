@@ -0,0 +1,107 @@
+/**
+ * @file record_reader.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "record_reader.hpp"
+#include "file_util.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+
+namespace store
+{
+
+RecordReader::RecordReader(std::shared_ptr<const ReadableFile> file, std::uint64_t file_size, std::size_t buffer_size)
+    : file_(std::move(file)), file_size_(file_size), buffer_size_(buffer_size),
+      buffer_(std::min<std::uint64_t>(file_size, buffer_size), '\0')
+{
+    // a hint only, reading works the same without it
+    ::posix_fadvise(file_->fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+absl::Status RecordReader::read_header()
+{
+    // a datafile created just before a crash may not have its header yet
+    std::string header(std::min<std::uint64_t>(file_size_, FILE_HEADER_SIZE), '\0');
+    absl::Status status = file_->pread(header.data(), header.size(), 0);
+    if (!status.ok())
+    {
+        return absl::InternalError("Error reading from file: " + std::string(status.message()));
+    }
+    if (file_size_ > 0)
+    {
+        torn_ = file_size_ < FILE_HEADER_SIZE;
+        status = check_file_header(header, DATAFILE_MAGIC, "datafile " + std::to_string(file_->fileid()));
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+    buffer_offset_ = header.size();
+    header_checked_ = true;
+
+    return absl::OkStatus();
+}
+
+absl::Status RecordReader::next(record::View &view)
+{
+    if (!header_checked_)
+    {
+        absl::Status status = read_header();
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+
+    while (offset() < file_size_)
+    {
+        record::ParseResult result = record::parse(std::string_view(buffer_.data() + pos_, buffered_ - pos_), view);
+        if (result == record::ParseResult::kOk)
+        {
+            pos_ += view.size();
+            return absl::OkStatus();
+        }
+        if (result == record::ParseResult::kCorrupted)
+        {
+            return absl::DataLossError("Checksum mismatch in datafile " + std::to_string(file_->fileid()) +
+                                       " at offset " + std::to_string(offset()));
+        }
+
+        // a record running past the end of the file is torn, its size is not
+        // trusted to grow the buffer
+        std::uint64_t needed = buffered_ - pos_ < record::HEADER_SIZE
+                                   ? record::HEADER_SIZE
+                                   : record::encoded_size(view.header.ksz, view.header.vsz);
+        if (offset() + needed > file_size_)
+        {
+            torn_ = true;
+            return absl::DataLossError("Truncated record in datafile " + std::to_string(file_->fileid()) +
+                                       " at offset " + std::to_string(offset()));
+        }
+
+        // move the start of the record to the front of the buffer, growing it
+        // if the record does not fit, and read what follows
+        buffer_.erase(0, pos_);
+        buffered_ -= pos_;
+        buffer_offset_ += pos_;
+        pos_ = 0;
+        buffer_.resize(std::max<std::uint64_t>(needed, buffer_size_));
+        std::size_t n = static_cast<std::size_t>(
+            std::min<std::uint64_t>(buffer_.size() - buffered_, file_size_ - buffer_offset_ - buffered_));
+        absl::Status status = file_->pread(buffer_.data() + buffered_, n, buffer_offset_ + buffered_);
+        if (!status.ok())
+        {
+            return absl::InternalError("Error reading from file: " + std::string(status.message()));
+        }
+        buffered_ += n;
+    }
+
+    return absl::OutOfRangeError("End of datafile");
+}
+
+} // namespace store
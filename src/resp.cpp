@@ -0,0 +1,193 @@
+/**
+ * @file resp.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "resp.hpp"
+
+#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <charconv>
+
+namespace resp
+{
+
+/**
+ * @brief Parse the integer of a *<n> or $<len> line.
+ */
+static bool parse_length(std::string_view line, std::int64_t &value)
+{
+    const char *end = line.data() + line.size();
+    std::from_chars_result result = std::from_chars(line.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+static ParseResult parse_inline(std::string_view bytes, std::vector<std::string_view> &args, std::size_t &consumed,
+                                std::string &error)
+{
+    std::size_t eol = bytes.find('\n');
+    if (eol == std::string_view::npos)
+    {
+        if (bytes.size() > MAX_INLINE_SIZE)
+        {
+            error = "Protocol error: too big inline request";
+            return ParseResult::kError;
+        }
+        return ParseResult::kIncomplete;
+    }
+
+    std::string_view line = bytes.substr(0, eol);
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    std::size_t pos = 0;
+    while (pos < line.size())
+    {
+        if (line[pos] == ' ' || line[pos] == '\t')
+        {
+            pos++;
+            continue;
+        }
+        std::size_t end = line.find_first_of(" \t", pos);
+        end = end == std::string_view::npos ? line.size() : end;
+        args.push_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+    consumed = eol + 1;
+
+    return ParseResult::kOk;
+}
+
+ParseResult parse(std::string_view bytes, std::vector<std::string_view> &args, std::size_t &consumed,
+                  std::string &error)
+{
+    args.clear();
+    if (bytes.empty())
+    {
+        return ParseResult::kIncomplete;
+    }
+    if (bytes[0] != '*')
+    {
+        return parse_inline(bytes, args, consumed, error);
+    }
+
+    // reads the line starting at pos, the one of a *<n> or a $<len>
+    std::size_t pos = 0;
+    auto read_length = [&](std::int64_t &value) {
+        std::size_t eol = bytes.find("\r\n", pos);
+        if (eol == std::string_view::npos)
+        {
+            if (bytes.size() - pos > MAX_INLINE_SIZE)
+            {
+                error = "Protocol error: too big length line";
+                return ParseResult::kError;
+            }
+            return ParseResult::kIncomplete;
+        }
+        if (!parse_length(bytes.substr(pos + 1, eol - pos - 1), value))
+        {
+            error = "Protocol error: invalid length";
+            return ParseResult::kError;
+        }
+        pos = eol + 2;
+        return ParseResult::kOk;
+    };
+
+    std::int64_t n_args = 0;
+    ParseResult result = read_length(n_args);
+    if (result != ParseResult::kOk)
+    {
+        return result;
+    }
+    if (n_args > static_cast<std::int64_t>(MAX_ARGS))
+    {
+        error = "Protocol error: invalid multibulk length";
+        return ParseResult::kError;
+    }
+
+    for (std::int64_t i = 0; i < n_args; i++)
+    {
+        if (pos == bytes.size())
+        {
+            return ParseResult::kIncomplete;
+        }
+        if (bytes[pos] != '$')
+        {
+            error = std::string("Protocol error: expected '$', got '") + bytes[pos] + "'";
+            return ParseResult::kError;
+        }
+        std::int64_t size = 0;
+        result = read_length(size);
+        if (result != ParseResult::kOk)
+        {
+            return result;
+        }
+        if (size < 0 || size > static_cast<std::int64_t>(MAX_BULK_SIZE))
+        {
+            error = "Protocol error: invalid bulk length";
+            return ParseResult::kError;
+        }
+
+        std::size_t end = pos + static_cast<std::size_t>(size);
+        if (end + 2 > bytes.size())
+        {
+            return ParseResult::kIncomplete;
+        }
+        if (bytes[end] != '\r' || bytes[end + 1] != '\n')
+        {
+            error = "Protocol error: bulk string not terminated by CRLF";
+            return ParseResult::kError;
+        }
+        args.push_back(bytes.substr(pos, static_cast<std::size_t>(size)));
+        pos = end + 2;
+    }
+    consumed = pos;
+
+    return ParseResult::kOk;
+}
+
+void append_simple(std::string &out, std::string_view value)
+{
+    out += '+';
+    out += value;
+    out += "\r\n";
+}
+
+void append_error(std::string &out, std::string_view message)
+{
+    // the message may quote a key, which must not end the line
+    out += '-';
+    std::size_t start = out.size();
+    out += message;
+    std::replace_if(out.begin() + static_cast<std::ptrdiff_t>(start), out.end(),
+                    [](char c) { return c == '\r' || c == '\n'; }, ' ');
+    out += "\r\n";
+}
+
+void append_integer(std::string &out, std::int64_t value)
+{
+    absl::StrAppend(&out, ":", value, "\r\n");
+}
+
+void append_bulk(std::string &out, std::string_view value)
+{
+    absl::StrAppend(&out, "$", value.size(), "\r\n");
+    out += value;
+    out += "\r\n";
+}
+
+void append_null(std::string &out)
+{
+    out += "$-1\r\n";
+}
+
+void append_array(std::string &out, std::size_t n)
+{
+    absl::StrAppend(&out, "*", n, "\r\n");
+}
+
+} // namespace resp
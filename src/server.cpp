@@ -0,0 +1,695 @@
+/**
+ * @file server.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "server.hpp"
+
+#include "absl/strings/str_cat.h"
+#include "resp.hpp"
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace store
+{
+
+const std::size_t Session::MAX_CURSORS = 64;
+const std::size_t Session::MAX_SCAN_COUNT = 10000;
+
+// pipelined SETs are committed once they reach this size, or with the other
+// commands of the same read
+static const std::size_t MAX_BATCH_BYTES = 1024 * 1024;
+static const std::size_t READ_BUFFER_SIZE = 64 * 1024;
+static const int MAX_EVENTS = 256;
+
+static bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+template <typename T> static bool parse_integer(std::string_view text, T &value)
+{
+    const char *end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+Session::Session(Store &store, ServerStats *stats)
+    : store_(store), stats_(stats), input_pos_(0), closing_(false), next_cursor_(1)
+{
+}
+
+void Session::feed(std::string_view bytes)
+{
+    if (closing_)
+    {
+        return;
+    }
+    input_.append(bytes);
+
+    // the arguments point into input_, which does not change until all the
+    // complete commands are processed
+    std::vector<std::string_view> args;
+    while (!closing_)
+    {
+        std::size_t consumed = 0;
+        std::string error;
+        resp::ParseResult result =
+            resp::parse(std::string_view(input_).substr(input_pos_), args, consumed, error);
+        if (result == resp::ParseResult::kIncomplete)
+        {
+            break;
+        }
+        if (result == resp::ParseResult::kError)
+        {
+            flush_batch();
+            resp::append_error(output_, "ERR " + error);
+            closing_ = true;
+            break;
+        }
+        input_pos_ += consumed;
+        if (!args.empty())
+        {
+            execute(args);
+        }
+    }
+    flush_batch();
+
+    input_.erase(0, input_pos_);
+    input_pos_ = 0;
+}
+
+void Session::consume_output(std::size_t n)
+{
+    output_.erase(0, n);
+}
+
+void Session::flush_batch()
+{
+    if (batch_.empty())
+    {
+        return;
+    }
+    absl::Status status = store_.write(batch_);
+    for (std::size_t i = 0; i < batch_.size(); i++)
+    {
+        if (status.ok())
+        {
+            resp::append_simple(output_, "OK");
+        }
+        else
+        {
+            resp::append_error(output_, absl::StrCat("ERR ", status.message()));
+        }
+    }
+    batch_.clear();
+}
+
+void Session::execute(const std::vector<std::string_view> &args)
+{
+    if (stats_ != nullptr)
+    {
+        stats_->commands.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::string_view name = args[0];
+    auto is = [&](std::string_view command) { return equals_ignore_case(name, command); };
+    auto wrong_arity = [&]() {
+        std::string command(name);
+        std::transform(command.begin(), command.end(), command.begin(), ::tolower);
+        resp::append_error(output_, "ERR wrong number of arguments for '" + command + "' command");
+    };
+
+    // plain SETs are batched, any other command first commits them so that
+    // it sees their values
+    if (is("SET") && args.size() == 3)
+    {
+        batch_.put(std::string(args[1]), std::string(args[2]));
+        if (batch_.byte_size() >= MAX_BATCH_BYTES)
+        {
+            flush_batch();
+        }
+        return;
+    }
+    flush_batch();
+
+    if (is("GET"))
+    {
+        if (args.size() != 2)
+        {
+            return wrong_arity();
+        }
+        absl::StatusOr<std::string> value = store_.get(std::string(args[1]));
+        if (value.ok())
+        {
+            resp::append_bulk(output_, *value);
+        }
+        else if (value.status().code() == absl::StatusCode::kNotFound)
+        {
+            resp::append_null(output_);
+        }
+        else
+        {
+            resp::append_error(output_, absl::StrCat("ERR ", value.status().message()));
+        }
+    }
+    else if (is("SET"))
+    {
+        set(args);
+    }
+    else if (is("DEL"))
+    {
+        if (args.size() < 2)
+        {
+            return wrong_arity();
+        }
+        std::int64_t deleted = 0;
+        for (std::size_t i = 1; i < args.size(); i++)
+        {
+            absl::Status status = store_.del(std::string(args[i]));
+            if (status.ok())
+            {
+                deleted++;
+            }
+            else if (status.code() != absl::StatusCode::kNotFound)
+            {
+                resp::append_error(output_, absl::StrCat("ERR ", status.message()));
+                return;
+            }
+        }
+        resp::append_integer(output_, deleted);
+    }
+    else if (is("MGET"))
+    {
+        if (args.size() < 2)
+        {
+            return wrong_arity();
+        }
+        std::vector<absl::StatusOr<std::string>> values =
+            store_.multi_get(std::span<const std::string_view>(args.data() + 1, args.size() - 1));
+        for (const absl::StatusOr<std::string> &value : values)
+        {
+            if (!value.ok() && value.status().code() != absl::StatusCode::kNotFound)
+            {
+                resp::append_error(output_, absl::StrCat("ERR ", value.status().message()));
+                return;
+            }
+        }
+        resp::append_array(output_, values.size());
+        for (const absl::StatusOr<std::string> &value : values)
+        {
+            if (value.ok())
+            {
+                resp::append_bulk(output_, *value);
+            }
+            else
+            {
+                resp::append_null(output_);
+            }
+        }
+    }
+    else if (is("SCAN"))
+    {
+        scan(args);
+    }
+    else if (is("INFO"))
+    {
+        info();
+    }
+    else if (is("PING"))
+    {
+        if (args.size() > 2)
+        {
+            return wrong_arity();
+        }
+        if (args.size() == 2)
+        {
+            resp::append_bulk(output_, args[1]);
+        }
+        else
+        {
+            resp::append_simple(output_, "PONG");
+        }
+    }
+    else if (is("ECHO"))
+    {
+        if (args.size() != 2)
+        {
+            return wrong_arity();
+        }
+        resp::append_bulk(output_, args[1]);
+    }
+    else if (is("QUIT"))
+    {
+        resp::append_simple(output_, "OK");
+        closing_ = true;
+    }
+    else if (is("COMMAND") || (is("CONFIG") && args.size() >= 2 && equals_ignore_case(args[1], "GET")))
+    {
+        // asked by redis-cli and redis-benchmark when they connect, nothing
+        // to report
+        resp::append_array(output_, 0);
+    }
+    else
+    {
+        resp::append_error(output_, "ERR unknown command '" + std::string(name) + "'");
+    }
+}
+
+void Session::set(const std::vector<std::string_view> &args)
+{
+    if (args.size() < 3)
+    {
+        resp::append_error(output_, "ERR wrong number of arguments for 'set' command");
+        return;
+    }
+
+    // SET key value EX seconds | PX milliseconds
+    std::int64_t ttl = 0;
+    if (args.size() != 5 || !parse_integer(args[4], ttl))
+    {
+        resp::append_error(output_, "ERR syntax error");
+        return;
+    }
+    if (equals_ignore_case(args[3], "PX"))
+    {
+        ttl = ttl / 1000 + (ttl % 1000 > 0 ? 1 : 0);
+    }
+    else if (!equals_ignore_case(args[3], "EX"))
+    {
+        resp::append_error(output_, "ERR syntax error");
+        return;
+    }
+    if (ttl <= 0)
+    {
+        resp::append_error(output_, "ERR invalid expire time in 'set' command");
+        return;
+    }
+
+    absl::Status status = store_.set_with_ttl(std::string(args[1]), std::string(args[2]), std::chrono::seconds(ttl));
+    if (status.ok())
+    {
+        resp::append_simple(output_, "OK");
+    }
+    else
+    {
+        resp::append_error(output_, absl::StrCat("ERR ", status.message()));
+    }
+}
+
+void Session::scan(const std::vector<std::string_view> &args)
+{
+    // SCAN cursor [MATCH pattern] [COUNT count]
+    std::uint64_t cursor = 0;
+    if (args.size() < 2 || args.size() % 2 != 0)
+    {
+        resp::append_error(output_, "ERR wrong number of arguments for 'scan' command");
+        return;
+    }
+    if (!parse_integer(args[1], cursor) || (cursor != 0 && !cursors_.contains(cursor)))
+    {
+        resp::append_error(output_, "ERR invalid cursor");
+        return;
+    }
+    std::string_view pattern = "*";
+    std::size_t count = 10;
+    for (std::size_t i = 2; i < args.size(); i += 2)
+    {
+        if (equals_ignore_case(args[i], "MATCH"))
+        {
+            pattern = args[i + 1];
+        }
+        else if (equals_ignore_case(args[i], "COUNT") && parse_integer(args[i + 1], count) && count > 0)
+        {
+            count = std::min(count, MAX_SCAN_COUNT);
+        }
+        else
+        {
+            resp::append_error(output_, "ERR syntax error");
+            return;
+        }
+    }
+
+    // the keys matching the pattern all start with its literal prefix, the
+    // scan starts there and ends after the last key with the prefix
+    std::string_view prefix = pattern.substr(0, pattern.find_first_of("*?\\"));
+    std::string begin(prefix);
+    if (cursor != 0)
+    {
+        begin = std::move(cursors_[cursor]);
+        cursors_.erase(cursor);
+    }
+    absl::StatusOr<std::vector<std::string>> page = store_.range(begin, "", count);
+    if (!page.ok())
+    {
+        resp::append_error(output_, absl::StrCat("ERR ", page.status().message()));
+        return;
+    }
+
+    bool done = page->size() < count || !page->back().starts_with(prefix);
+    std::uint64_t next = 0;
+    if (!done)
+    {
+        next = next_cursor_++;
+        cursors_[next] = page->back() + '\0';
+        if (cursors_.size() > MAX_CURSORS)
+        {
+            cursors_.erase(cursors_.begin());
+        }
+    }
+
+    std::vector<std::string_view> matched;
+    for (const std::string &key : *page)
+    {
+        if (key.starts_with(prefix) && glob_match(pattern, key))
+        {
+            matched.push_back(key);
+        }
+    }
+    resp::append_array(output_, 2);
+    resp::append_bulk(output_, absl::StrCat(next));
+    resp::append_array(output_, matched.size());
+    for (std::string_view key : matched)
+    {
+        resp::append_bulk(output_, key);
+    }
+}
+
+void Session::info()
+{
+    std::string info = absl::StrCat("# Server\r\nbitcask_version:0.1.0\r\n");
+    if (stats_ != nullptr)
+    {
+        absl::StrAppend(&info, "\r\n# Clients\r\nconnected_clients:", stats_->connections.load(),
+                        "\r\n\r\n# Stats\r\ntotal_connections_received:", stats_->total_connections.load(),
+                        "\r\ntotal_commands_processed:", stats_->commands.load(), "\r\n");
+    }
+    absl::StrAppend(&info, "\r\n# Keyspace\r\nkeys:", store_.kd_size(),
+                    "\r\nkeydir_bytes_per_key:", static_cast<std::size_t>(store_.kd_stats().bytes_per_key()),
+                    "\r\nactive_fileid:", store_.active_fileid(), "\r\n");
+    resp::append_bulk(output_, info);
+}
+
+bool glob_match(std::string_view pattern, std::string_view key)
+{
+    // on a mismatch, the last '*' seen absorbs one more byte of the key
+    std::size_t p = 0;
+    std::size_t k = 0;
+    std::size_t star = std::string_view::npos;
+    std::size_t star_key = 0;
+    while (k < key.size())
+    {
+        if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_key = k;
+            continue;
+        }
+        if (p < pattern.size())
+        {
+            bool escaped = pattern[p] == '\\' && p + 1 < pattern.size();
+            if (!escaped && pattern[p] == '?')
+            {
+                p++;
+                k++;
+                continue;
+            }
+            if (pattern[escaped ? p + 1 : p] == key[k])
+            {
+                p += escaped ? 2 : 1;
+                k++;
+                continue;
+            }
+        }
+        if (star == std::string_view::npos)
+        {
+            return false;
+        }
+        p = star + 1;
+        k = ++star_key;
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+    {
+        p++;
+    }
+
+    return p == pattern.size();
+}
+
+/**
+ * @struct Server::Connection
+ * @brief Client socket and its session, owned by the worker that accepted
+ *        it.
+ */
+struct Server::Connection
+{
+    int fd;
+    Session session;
+    bool read_closed = false; /** The client shut down its side */
+};
+
+Server::Server(Store &store, const ServerOptions &options)
+    : store_(store), options_(options), listen_fd_(-1), stop_fd_(-1), port_(0)
+{
+}
+
+Server::~Server()
+{
+    stop();
+}
+
+absl::StatusOr<std::unique_ptr<Server>> Server::start(Store &store, const ServerOptions &options)
+{
+    std::unique_ptr<Server> server(new Server(store, options));
+    absl::Status status = server->listen();
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    std::size_t n_threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    for (std::size_t i = 0; i < std::max<std::size_t>(n_threads, 1); i++)
+    {
+        server->workers_.emplace_back(&Server::worker_loop, server.get());
+    }
+
+    return server;
+}
+
+absl::Status Server::listen()
+{
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options_.port);
+    if (::inet_pton(AF_INET, options_.bind_address.c_str(), &address.sin_addr) != 1)
+    {
+        return absl::InvalidArgumentError("Invalid bind address: " + options_.bind_address);
+    }
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    if (listen_fd_ < 0 || ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        ::bind(listen_fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0)
+    {
+        return absl::InternalError(absl::StrCat("Error listening on ", options_.bind_address, ":", options_.port,
+                                                ": ", std::strerror(errno)));
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address), &length);
+    port_ = ntohs(address.sin_port);
+
+    stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0)
+    {
+        return absl::InternalError(absl::StrCat("Error creating eventfd: ", std::strerror(errno)));
+    }
+
+    return absl::OkStatus();
+}
+
+void Server::stop()
+{
+    if (stop_fd_ >= 0)
+    {
+        // the eventfd stays readable, it wakes every worker up
+        std::uint64_t one = 1;
+        ssize_t written = ::write(stop_fd_, &one, sizeof(one));
+        (void)written;
+    }
+    for (std::thread &worker : workers_)
+    {
+        worker.join();
+    }
+    workers_.clear();
+    for (int *fd : {&listen_fd_, &stop_fd_})
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void Server::worker_loop()
+{
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        return;
+    }
+
+    // the listening socket is marked by a null pointer, the eventfd by a
+    // pointer to it, the connections by their Connection
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = nullptr;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd_, &event);
+    event.events = EPOLLIN;
+    event.data.ptr = &stop_fd_;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, stop_fd_, &event);
+
+    std::unordered_map<Connection *, std::unique_ptr<Connection>> connections;
+    std::string buffer(READ_BUFFER_SIZE, '\0');
+
+    auto close_connection = [&](Connection *connection) {
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection->fd, nullptr);
+        ::close(connection->fd);
+        connections.erase(connection);
+        stats_.connections.fetch_sub(1, std::memory_order_relaxed);
+    };
+
+    // send the pending replies, false if the connection is broken
+    auto send_output = [](Connection *connection) {
+        while (!connection->session.output().empty())
+        {
+            const std::string &output = connection->session.output();
+            ssize_t n = ::send(connection->fd, output.data(), output.size(), MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                connection->session.consume_output(static_cast<std::size_t>(n));
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return true;
+            }
+            else if (errno != EINTR)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // sockets are edge-triggered: read until the socket is drained, unless
+    // the client does not read its replies, then wait for it to catch up
+    auto serve = [&](Connection *connection) {
+        if (!send_output(connection))
+        {
+            return close_connection(connection);
+        }
+        while (!connection->read_closed && !connection->session.closing() &&
+               connection->session.output().size() < options_.max_pending_output)
+        {
+            ssize_t n = ::read(connection->fd, buffer.data(), buffer.size());
+            if (n > 0)
+            {
+                connection->session.feed(std::string_view(buffer.data(), static_cast<std::size_t>(n)));
+                if (!send_output(connection))
+                {
+                    return close_connection(connection);
+                }
+            }
+            else if (n == 0)
+            {
+                connection->read_closed = true;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            else if (errno != EINTR)
+            {
+                return close_connection(connection);
+            }
+        }
+        if ((connection->read_closed || connection->session.closing()) && connection->session.output().empty())
+        {
+            close_connection(connection);
+        }
+    };
+
+    std::vector<epoll_event> events(MAX_EVENTS);
+    bool running = true;
+    while (running)
+    {
+        int n = ::epoll_wait(epoll_fd, events.data(), MAX_EVENTS, -1);
+        if (n < 0 && errno != EINTR)
+        {
+            break;
+        }
+        for (int i = 0; i < n; i++)
+        {
+            void *ptr = events[i].data.ptr;
+            if (ptr == &stop_fd_)
+            {
+                running = false;
+            }
+            else if (ptr == nullptr)
+            {
+                int fd;
+                while ((fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    int one = 1;
+                    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    auto connection = std::make_unique<Connection>(Connection{fd, Session(store_, &stats_)});
+                    epoll_event connection_event{};
+                    connection_event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    connection_event.data.ptr = connection.get();
+                    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &connection_event) != 0)
+                    {
+                        ::close(fd);
+                        continue;
+                    }
+                    stats_.connections.fetch_add(1, std::memory_order_relaxed);
+                    stats_.total_connections.fetch_add(1, std::memory_order_relaxed);
+                    connections.emplace(connection.get(), std::move(connection));
+                }
+            }
+            else
+            {
+                Connection *connection = static_cast<Connection *>(ptr);
+                if ((events[i].events & EPOLLERR) != 0)
+                {
+                    close_connection(connection);
+                    continue;
+                }
+                serve(connection);
+            }
+        }
+    }
+
+    for (auto &[ptr, connection] : connections)
+    {
+        ::close(connection->fd);
+        stats_.connections.fetch_sub(1, std::memory_order_relaxed);
+    }
+    ::close(epoll_fd);
+}
+
+} // namespace store
@@ -7,27 +7,137 @@
  */
 
 #include "store.hpp"
+#include "crc32c.hpp"
+#include "file_util.hpp"
+#include "record_reader.hpp"
+
+#include <climits>
+#include <deque>
+#include <future>
+#include <tuple>
+#include <unordered_set>
 
 namespace store
 {
 
-const std::uint64_t Store::TOMBSTONE = 0xDEADDEADDEADDEAD;
-const int Store::TOMBSTONE_SIZE = 20;
-const int Store::CRC_SIZE = 4;
-const int Store::KSZ_SIZE = 2;
-const int Store::VSZ_SIZE = 2;
+const int Store::CRC_SIZE = record::CRC_SIZE;
+const int Store::HEADER_SIZE = record::HEADER_SIZE;
+const std::uint8_t Store::FLAG_BATCH = 0x01;
+const std::uint8_t Store::FLAG_BATCH_END = 0x02;
+const std::uint8_t Store::FLAG_LZ4 = 0x04;
+const std::uint8_t Store::FLAG_ZSTD = 0x08;
+const std::uint8_t Store::VALUE_FLAGS = Store::FLAG_LZ4 | Store::FLAG_ZSTD;
+const std::uint8_t Store::FLAG_TOMBSTONE = 0x10;
+const std::uint8_t Store::FLAG_EXPIRING = 0x20;
+const std::string Store::DATAFILE_PREFIX = "datafile";
+const std::string Store::HINT_SUFFIX = ".hint";
+const std::string Store::MERGE_SUFFIX = ".merge";
+const std::string Store::MERGE_MANIFEST = "MERGE";
+const int Store::MAX_READ_ATTEMPTS = 3;
+const std::uint64_t Store::MULTI_GET_MAX_GAP = 4096;
+const std::size_t Store::SCAN_BUFFER_SIZE = 256 * 1024;
+const std::size_t Store::STREAM_CHUNK_SIZE = 256 * 1024;
+
+Store::Store(const std::string &db_path, const Options &options)
+    : db_path_(db_path), options_(options), active_fileid_(1), active_file_offset_(0), next_fileid_(2),
+      keydir_(keydir::KeyDir::DEFAULT_SHARDS, options.ordered_index),
+      fd_cache_(options.max_open_files), mmap_cache_(options.madvise_policy), merge_running_(false),
+      sweep_stop_(false), open_cursors_(0), merging_(false)
+{
+    if (options_.value_cache_bytes > 0)
+    {
+        value_cache_ = std::make_unique<ValueCache>(options_.value_cache_bytes);
+    }
+
+    absl::StatusOr<std::unique_ptr<Compressor>> compressor =
+        Compressor::create(options_.compression, options_.compression_level, options_.compression_dictionary);
+    if (!compressor.ok())
+    {
+        // the uncompressed values and those of the available codecs can
+        // still be read, writing fails
+        compression_status_ = compressor.status();
+        compressor = Compressor::create(Compression::kNone);
+    }
+    compressor_ = std::move(*compressor);
+
+    if (options_.expiry_sweep_interval.count() > 0)
+    {
+        sweep_thread_ = std::thread(&Store::run_sweeps, this);
+    }
+}
 
-Store::Store(const std::string &db_path) : db_path_(db_path), active_fileid_(1), active_file_offset_(0), keydir_()
+Store::~Store()
 {
+    if (sweep_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(sweep_mutex_);
+            sweep_stop_ = true;
+        }
+        sweep_cv_.notify_all();
+        sweep_thread_.join();
+    }
+    // the outcome of a background merge has no one left to report to
+    wait_for_merge().IgnoreError();
+
+    // the asynchronous operations in flight use the store
+    io_engine_.reset();
 }
 
 absl::Status Store::set(const std::string &key, const std::string &value)
 {
-    // open the active file for writing in binary append mode
-    std::ofstream file(active_datafile_path(), std::ios::binary | std::ios::app);
-    if (!file.is_open())
+    return append_record(key, value, 0);
+}
+
+absl::Status Store::set_with_ttl(const std::string &key, const std::string &value, std::chrono::seconds ttl)
+{
+    std::uint64_t expiry = now() + static_cast<std::uint64_t>(std::max<std::int64_t>(ttl.count(), 0));
+    return append_record(key, value, Store::FLAG_EXPIRING,
+                         static_cast<std::uint32_t>(
+                             std::min<std::uint64_t>(expiry, std::numeric_limits<std::uint32_t>::max())));
+}
+
+std::size_t Store::purge_expired()
+{
+    return keydir_.erase_expired(now());
+}
+
+void Store::run_sweeps()
+{
+    std::unique_lock<std::mutex> lock(sweep_mutex_);
+    while (!sweep_cv_.wait_for(lock, options_.expiry_sweep_interval, [this]() { return sweep_stop_; }))
+    {
+        lock.unlock();
+        purge_expired();
+        lock.lock();
+    }
+}
+
+std::uint32_t Store::now()
+{
+    return static_cast<std::uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+}
+
+absl::StatusOr<keydir::Entry> Store::lookup(std::string_view key) const
+{
+    absl::StatusOr<keydir::Entry> entry = keydir_.get(key);
+    if (entry.ok() && entry->expired(now()))
+    {
+        // the entry stays until the next sweep, merge or load drops it
+        return absl::NotFoundError("Key: " + std::string(key) + " expired");
+    }
+
+    return entry;
+}
+
+absl::Status Store::append_record(const std::string &key, const std::string &value, std::uint8_t type,
+                                  std::uint32_t expiry)
+{
+    if (!compression_status_.ok())
     {
-        return absl::InternalError("Failed to open file for writing");
+        return compression_status_;
     }
 
     // check the key and value sizes
@@ -35,232 +145,1850 @@ absl::Status Store::set(const std::string &key, const std::string &value)
     {
         return absl::InvalidArgumentError("Key size is too large");
     }
-    std::uint16_t ksz = static_cast<std::uint16_t>(key.size());
-    if (value.size() > std::numeric_limits<std::uint16_t>::max())
+    if (value.size() > std::numeric_limits<std::uint32_t>::max())
     {
         return absl::InvalidArgumentError("Value size is too large");
     }
-    std::uint16_t vsz = static_cast<std::uint16_t>(value.size());
-
-    // create the datafile entry
-    store::DatafileEntry df_entry(ksz, vsz);
-    std::memcpy(df_entry.CRC, "0000", 4);
+    forget_value(key);
 
-    // copy the key and value to the df_entry
-    // /!\ valgrind writing 1 byte after ?
-    std::memcpy(df_entry.key.get(), key.c_str(), ksz);
-    std::memcpy(df_entry.value.get(), value.c_str(), vsz);
+    // each thread serializes its records into its own buffers, which stop
+    // allocating once they have grown to the largest record
+    thread_local std::string compressed;
+    thread_local std::string encoded;
+    bool tombstone = type == Store::FLAG_TOMBSTONE;
+    std::uint8_t flags = 0;
+    std::string_view stored = tombstone ? std::string_view(value) : encode_value(value, compressed, flags);
+    std::uint32_t vsz = static_cast<std::uint32_t>(stored.size());
+    encoded.clear();
+    record::append(encoded, key, stored, flags | type, type == Store::FLAG_EXPIRING ? expiry : now());
 
-    // write the df_entry to the file
-    file.write(reinterpret_cast<const char*>(&df_entry), sizeof(df_entry) - 2 * sizeof(std::unique_ptr<char[]>));
-    file.write(reinterpret_cast<const char*>(df_entry.key.get()), ksz);
-    file.write(reinterpret_cast<const char*>(df_entry.value.get()), vsz);
-    if (file.fail())
+    std::shared_lock<std::shared_mutex> lock(write_mutex_, std::defer_lock);
+    absl::Status status = begin_append(lock, encoded.size());
+    if (!status.ok())
     {
-        return absl::InternalError("Writing to file failed");
+        return status;
     }
 
-    // close the file
-    file.close();
-    if (!file.good())
+    // append the record and update the keydir once it is written
+    fileid_t fileid = writer_->fileid();
+    absl::StatusOr<std::uint64_t> offset = writer_->append(encoded, [&](std::uint64_t record_offset) {
+        active_hints_.push_back({.key = key,
+                                 .vsz = vsz,
+                                 .vpos = record_offset,
+                                 .tombstone = tombstone,
+                                 .flags = flags,
+                                 .expiry = expiry});
+        if (tombstone)
+        {
+            // the key may already be gone if it was deleted concurrently
+            keydir_.del(key).IgnoreError();
+            return;
+        }
+        keydir::Entry kd_entry = {.fileid = fileid, .vsz = vsz, .vpos = record_offset, .flags = flags, .expiry = expiry};
+        status = keydir_.set(key, kd_entry);
+    });
+    if (!offset.ok())
     {
-        return absl::InternalError("Error closing file");
+        abort_append(lock);
+        return offset.status();
     }
 
-    // update the keydir
-    keydir::Entry kd_entry = { .fileid = active_fileid_, .vsz = vsz, .vpos = active_file_offset_ };
-    absl::Status status = keydir_.set(key, kd_entry);
-
-    // increment the offset as the write and keydir update were successful
-    active_file_offset_ += sizeof(df_entry) - 2 * sizeof(std::unique_ptr<char[]>) + ksz + vsz;
-
     return status;
 }
 
-absl::StatusOr<std::string> Store::get(const std::string &key) const
+absl::Status Store::write(const WriteBatch &batch)
 {
-    // get the entry from the keydir
-    absl::StatusOr<keydir::Entry> kd_entry = keydir_.get(key);
-    if (!kd_entry.ok())
+    if (batch.empty())
+    {
+        return absl::OkStatus();
+    }
+    if (!compression_status_.ok())
     {
-        return kd_entry.status();
+        return compression_status_;
     }
 
-    // open the file for reading
-    std::ifstream file;
-    file.open(active_datafile_path(), std::ios::in);
+    // check the key and value sizes
+    for (const WriteBatch::Op &op : batch.ops())
+    {
+        if (op.key.size() > std::numeric_limits<std::uint16_t>::max())
+        {
+            return absl::InvalidArgumentError("Key size is too large");
+        }
+        if (op.value.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            return absl::InvalidArgumentError("Value size is too large");
+        }
+    }
 
-    if (!file.is_open())
+    // serialize the whole batch in one buffer, the last record closes it.
+    // The entries are relative to the start of the buffer until it is
+    // written.
+    std::string buffer;
+    buffer.reserve(batch.byte_size() + batch.size() * Store::HEADER_SIZE);
+    std::vector<keydir::Entry> entries;
+    entries.reserve(batch.size());
+    std::string compressed;
+    std::uint32_t timestamp = now();
+    for (std::size_t i = 0; i < batch.size(); i++)
     {
-        return absl::InternalError("Error opening file");
+        const WriteBatch::Op &op = batch.ops()[i];
+        std::uint8_t value_flags = 0;
+        std::string_view stored = op.tombstone ? std::string_view() : encode_value(op.value, compressed, value_flags);
+        std::uint8_t flags = Store::FLAG_BATCH | (i + 1 == batch.size() ? Store::FLAG_BATCH_END : 0) |
+                             (op.tombstone ? Store::FLAG_TOMBSTONE : 0) | value_flags;
+        entries.push_back({.fileid = 0,
+                           .vsz = static_cast<std::uint32_t>(stored.size()),
+                           .vpos = buffer.size(),
+                           .flags = value_flags});
+        record::append(buffer, op.key, stored, flags, timestamp);
+        forget_value(op.key);
+    }
+
+    std::shared_lock<std::shared_mutex> lock(write_mutex_, std::defer_lock);
+    absl::Status status = begin_append(lock, buffer.size());
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    // append the batch and update the keydir once it is written
+    fileid_t fileid = writer_->fileid();
+    absl::StatusOr<std::uint64_t> offset = writer_->append(buffer, [&](std::uint64_t batch_offset) {
+        std::vector<keydir::KeyDir::Update> updates;
+        updates.reserve(batch.size());
+        for (std::size_t i = 0; i < batch.size(); i++)
+        {
+            const WriteBatch::Op &op = batch.ops()[i];
+            keydir::Entry entry = entries[i];
+            entry.fileid = fileid;
+            entry.vpos += batch_offset;
+            active_hints_.push_back({.key = op.key,
+                                     .vsz = entry.vsz,
+                                     .vpos = entry.vpos,
+                                     .tombstone = op.tombstone,
+                                     .flags = entry.flags});
+            updates.push_back({.key = op.key, .entry = entry, .remove = op.tombstone});
+        }
+        keydir_.apply(updates);
+    });
+    if (!offset.ok())
+    {
+        abort_append(lock);
+        return offset.status();
     }
 
-    // seek to the position of the entry in the datafile
-    file.seekg(kd_entry->vpos);
+    return absl::OkStatus();
+}
 
-    absl::StatusOr<std::string> value = read_value(file, kd_entry->vsz);
-    if (!value.ok())
+absl::Status Store::begin_append(std::shared_lock<std::shared_mutex> &lock, std::uint64_t size)
+{
+    // appends share the lock so that the datafile writer can batch them,
+    // rolling over to a new datafile takes it exclusively
+    lock.lock();
+    while (!reserve_append(size))
     {
-        return value.status();
+        lock.unlock();
+        {
+            std::lock_guard<std::shared_mutex> exclusive_lock(write_mutex_);
+            absl::Status status = prepare_append(size);
+            if (!status.ok())
+            {
+                return status;
+            }
+        }
+        lock.lock();
     }
 
-    if (file.fail())
+    return absl::OkStatus();
+}
+
+void Store::abort_append(std::shared_lock<std::shared_mutex> &lock)
+{
+    // the appends in flight hold the lock shared, the size of the datafile is
+    // settled once it is taken exclusively
+    lock.unlock();
+    std::lock_guard<std::shared_mutex> exclusive_lock(write_mutex_);
+    if (writer_ != nullptr)
     {
-        return absl::InternalError("Error reading from file");
+        active_file_offset_ = writer_->size();
     }
+}
 
-    // close the file
-    file.close();
-    if (!file.good())
+bool Store::reserve_append(std::uint64_t record_size)
+{
+    if (writer_ == nullptr)
     {
-        return absl::InternalError("Error closing file");
+        return false;
     }
 
-    return value;
+    std::uint64_t offset = active_file_offset_;
+    do
+    {
+        if (offset > FILE_HEADER_SIZE && offset + record_size > options_.max_file_size)
+        {
+            return false;
+        }
+    } while (!active_file_offset_.compare_exchange_weak(offset, offset + record_size));
+
+    return true;
 }
 
-absl::Status Store::del(const std::string &key)
+absl::Status Store::prepare_append(std::uint64_t record_size)
 {
-    // open the file for writing in binary append mode
-    std::ofstream file;
-    file.open(active_datafile_path(), std::ios::binary | std::ios::app);
+    // roll over to a new datafile if the record would exceed the size threshold
+    if (active_file_offset_ > FILE_HEADER_SIZE && active_file_offset_ + record_size > options_.max_file_size)
+    {
+        absl::Status status = rotate();
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
 
-    if (!file.is_open())
+    return open_writer();
+}
+
+absl::Status Store::verify_record(std::string_view record, std::string_view key)
+{
+    if (crc32c::value(record.substr(Store::CRC_SIZE)) != record::load_le32(record.data()))
     {
-        return absl::InternalError("Error opening file");
+        return absl::DataLossError("Checksum mismatch");
+    }
+    if (record.substr(Store::HEADER_SIZE, key.size()) != key)
+    {
+        return absl::DataLossError("Record does not hold the key");
     }
 
-    // check if the key exists in the keydir
-    if (keydir_.find(key) == keydir_.end())
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> Store::get(const std::string &key) const
+{
+    for (int attempt = 1;; attempt++)
     {
-        return absl::NotFoundError("Key not found");
+        // get the entry from the keydir
+        absl::StatusOr<keydir::Entry> kd_entry = lookup(key);
+        if (!kd_entry.ok())
+        {
+            return kd_entry.status();
+        }
+
+        absl::StatusOr<std::string> value;
+        if (is_mapped(*kd_entry))
+        {
+            absl::StatusOr<ValueView> view = map_value(*kd_entry, key);
+            value = view.ok() ? absl::StatusOr<std::string>(std::string(view->view())) : view.status();
+        }
+        else
+        {
+            value = read_cached_value(*kd_entry, key);
+        }
+
+        // the datafile may have been removed by a merge since the keydir
+        // lookup, the keydir then points to the merged copy of the record
+        if (value.status().code() != absl::StatusCode::kNotFound || attempt == MAX_READ_ATTEMPTS)
+        {
+            return value;
+        }
     }
+}
 
-    // write the entry to the file
-    absl::Status status = set(key, std::to_string(Store::TOMBSTONE));
-    if (!status.ok())
+absl::StatusOr<ValueView> Store::get_view(const std::string &key) const
+{
+    for (int attempt = 1;; attempt++)
     {
-        return status;
+        // get the entry from the keydir
+        absl::StatusOr<keydir::Entry> kd_entry = lookup(key);
+        if (!kd_entry.ok())
+        {
+            return kd_entry.status();
+        }
+
+        absl::StatusOr<ValueView> view;
+        if (is_mapped(*kd_entry))
+        {
+            view = map_value(*kd_entry, key);
+        }
+        else
+        {
+            absl::StatusOr<std::string> value = read_cached_value(*kd_entry, key);
+            view = value.ok() ? absl::StatusOr<ValueView>(ValueView(std::move(*value))) : value.status();
+        }
+
+        // see get()
+        if (view.status().code() != absl::StatusCode::kNotFound || attempt == MAX_READ_ATTEMPTS)
+        {
+            return view;
+        }
     }
+}
 
-    // close the file
-    file.close();
-    if (!file.good())
+absl::Status Store::put_stream(const std::string &key, std::uint64_t size, const ChunkSource &source)
+{
+    // check the key and value sizes
+    if (key.size() > std::numeric_limits<std::uint16_t>::max())
+    {
+        return absl::InvalidArgumentError("Key size is too large");
+    }
+    if (size > std::numeric_limits<std::uint32_t>::max())
     {
-        return absl::InternalError("Error closing file");
+        return absl::InvalidArgumentError("Value size is too large");
     }
+    std::uint32_t vsz = static_cast<std::uint32_t>(size);
+    forget_value(key);
+
+    // the header and the key go first, with the checksum filled in once the
+    // whole value went through it
+    std::string head(Store::HEADER_SIZE + key.size(), '\0');
+    record::encode_header(
+        {.crc = 0, .timestamp = now(), .ksz = static_cast<std::uint16_t>(key.size()), .vsz = vsz, .flags = 0},
+        head.data());
+    key.copy(head.data() + Store::HEADER_SIZE, key.size());
+    std::uint32_t crc = crc32c::value(std::string_view(head).substr(Store::CRC_SIZE));
+    bool head_written = false;
+    DatafileWriter::PieceSource next = [&]() -> absl::StatusOr<std::string_view> {
+        if (!head_written)
+        {
+            head_written = true;
+            return std::string_view(head);
+        }
+        absl::StatusOr<std::string_view> chunk = source();
+        if (chunk.ok())
+        {
+            crc = crc32c::extend(crc, *chunk);
+        }
+        return chunk;
+    };
+    DatafileWriter::HeadCallback finish = [&]() {
+        record::store_le32(head.data(), crc);
+        return std::string_view(head).substr(0, Store::CRC_SIZE);
+    };
 
-    // remove the key from the keydir
-    status = keydir_.del(key);
+    std::shared_lock<std::shared_mutex> lock(write_mutex_, std::defer_lock);
+    absl::Status status = begin_append(lock, record::encoded_size(key.size(), vsz));
     if (!status.ok())
     {
         return status;
     }
 
+    // append the record and update the keydir once it is written
+    fileid_t fileid = writer_->fileid();
+    absl::StatusOr<std::uint64_t> offset = writer_->append_stream(
+        record::encoded_size(key.size(), vsz), next, finish, [&](std::uint64_t record_offset) {
+            active_hints_.push_back({.key = key, .vsz = vsz, .vpos = record_offset, .tombstone = false});
+            keydir::Entry kd_entry = {.fileid = fileid, .vsz = vsz, .vpos = record_offset};
+            status = keydir_.set(key, kd_entry);
+        });
+    if (!offset.ok())
+    {
+        abort_append(lock);
+        return offset.status();
+    }
+
     return status;
 }
 
-absl::Status Store::list() const
+absl::Status Store::put_stream(const std::string &key, std::istream &input, std::uint64_t size)
+{
+    std::string chunk(std::min<std::uint64_t>(size, STREAM_CHUNK_SIZE), '\0');
+    std::uint64_t remaining = size;
+    return put_stream(key, size, [&]() -> absl::StatusOr<std::string_view> {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, chunk.size()));
+        if (n == 0)
+        {
+            return std::string_view();
+        }
+        if (!input.read(chunk.data(), static_cast<std::streamsize>(n)))
+        {
+            return absl::InvalidArgumentError("Input ended before the announced value size");
+        }
+        remaining -= n;
+        return std::string_view(chunk.data(), n);
+    });
+}
+
+absl::Status Store::get_stream(const std::string &key, const ChunkSink &sink) const
 {
-    std::vector<std::string> keys;
-    for (auto [key, entry] : keydir_)
+    for (int attempt = 1;; attempt++)
     {
-        keys.push_back(key);
+        absl::StatusOr<keydir::Entry> kd_entry = lookup(key);
+        if (!kd_entry.ok())
+        {
+            return kd_entry.status();
+        }
+
+        // the datafile may have been removed by a merge since the keydir
+        // lookup. Once the file is open, a merge can no longer pull it away.
+        absl::StatusOr<std::shared_ptr<const ReadableFile>> file =
+            fd_cache_.get(kd_entry->fileid, datafile_path(kd_entry->fileid));
+        if (file.ok())
+        {
+            return stream_value(**file, *kd_entry, key, sink);
+        }
+        if (file.status().code() != absl::StatusCode::kNotFound || attempt == MAX_READ_ATTEMPTS)
+        {
+            return file.status();
+        }
     }
-    if (keys.empty())
-    {
-        std::cout << "Empty" << std::endl;
+}
+
+absl::Status Store::get_stream(const std::string &key, std::ostream &output) const
+{
+    return get_stream(key, [&](std::string_view chunk) {
+        if (!output.write(chunk.data(), static_cast<std::streamsize>(chunk.size())))
+        {
+            return absl::InternalError("Error writing the value to the output stream");
+        }
         return absl::OkStatus();
-    }
-    std::string joined_keys = absl::StrJoin(keys, ", ");
-    std::cout << absl::StrCat("Keys[", keys.size(), "]: ", joined_keys) << std::endl;
-    return absl::OkStatus();
+    });
 }
 
-absl::Status Store::load_keydir()
+std::vector<absl::StatusOr<std::string>> Store::multi_get(std::span<const std::string_view> keys) const
 {
-    // open the active file for reading
-    std::ifstream file;
-    file.open(active_datafile_path(), std::ios::in);
+    std::vector<absl::StatusOr<std::string>> values(keys.size(), absl::InternalError("Value not read"));
 
-    if (!file.is_open())
+    // look all the keys up first, the values served from a mapping need no
+    // read
+    std::vector<PendingRead> reads;
+    std::vector<std::size_t> retries;
+    reads.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); i++)
     {
-        return absl::InternalError("Error opening file");
+        absl::StatusOr<keydir::Entry> kd_entry = lookup(keys[i]);
+        if (!kd_entry.ok())
+        {
+            values[i] = kd_entry.status();
+        }
+        else if (is_mapped(*kd_entry))
+        {
+            absl::StatusOr<ValueView> view = map_value(*kd_entry, keys[i]);
+            values[i] = view.ok() ? absl::StatusOr<std::string>(std::string(view->view())) : view.status();
+            if (view.status().code() == absl::StatusCode::kNotFound)
+            {
+                retries.push_back(i);
+            }
+        }
+        else if (std::optional<std::string> cached = value_cache_ != nullptr ? value_cache_->get(*kd_entry)
+                                                                             : std::nullopt)
+        {
+            values[i] = std::move(*cached);
+        }
+        else
+        {
+            reads.push_back({.index = i, .entry = *kd_entry});
+        }
+    }
+
+    // then read the values datafile by datafile, in offset order
+    std::sort(reads.begin(), reads.end(), [](const PendingRead &a, const PendingRead &b) {
+        return std::tie(a.entry.fileid, a.entry.vpos) < std::tie(b.entry.fileid, b.entry.vpos);
+    });
+    std::size_t begin = 0;
+    while (begin < reads.size())
+    {
+        std::size_t end = begin + 1;
+        while (end < reads.size() && reads[end].entry.fileid == reads[begin].entry.fileid)
+        {
+            end++;
+        }
+        read_values(reads[begin].entry.fileid, std::span<const PendingRead>(reads).subspan(begin, end - begin), keys,
+                    values);
+        begin = end;
+    }
+    for (const PendingRead &read : reads)
+    {
+        if (values[read.index].status().code() == absl::StatusCode::kNotFound)
+        {
+            retries.push_back(read.index);
+        }
+    }
+
+    // the datafile may have been removed by a merge since the keydir lookup,
+    // see get()
+    for (std::size_t i : retries)
+    {
+        values[i] = get(std::string(keys[i]));
     }
 
-    // get the file size
-    file.seekg(0, std::ios::end);
-    std::size_t file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    return values;
+}
+
+void Store::async_get(const std::string &key, GetCallback done) const
+{
+    absl::StatusOr<IoEngine *> engine = io_engine();
+    if (!engine.ok())
+    {
+        done(engine.status());
+        return;
+    }
 
-    // read the entries from the file
-    DatafileEntry cur_df_entry;
-    while (active_file_offset_ < file_size)
+    absl::StatusOr<keydir::Entry> kd_entry = lookup(key);
+    if (!kd_entry.ok())
+    {
+        done(kd_entry.status());
+        return;
+    }
+    if (is_mapped(*kd_entry))
     {
-        // read the entry from the file
-        file.read(reinterpret_cast<char*>(&cur_df_entry), sizeof(cur_df_entry) - 2 * sizeof(std::unique_ptr<char[]>));
-        cur_df_entry.key = std::make_unique<char[]>(cur_df_entry.ksz);
-        cur_df_entry.value = std::make_unique<char[]>(cur_df_entry.vsz);
-        file.read(reinterpret_cast<char*>(cur_df_entry.key.get()), cur_df_entry.ksz);
-        file.read(reinterpret_cast<char*>(cur_df_entry.value.get()), cur_df_entry.vsz);
-        if (file.fail())
+        absl::StatusOr<ValueView> view = map_value(*kd_entry, key);
+        if (view.status().code() != absl::StatusCode::kNotFound)
         {
-            return absl::InternalError("Error reading from file");
+            done(view.ok() ? absl::StatusOr<std::string>(std::string(view->view())) : view.status());
+            return;
         }
+    }
 
-        std::string key_str = std::string(cur_df_entry.key.get(), cur_df_entry.ksz);
-        std::string value_str = std::string(cur_df_entry.value.get(), cur_df_entry.vsz);
+    if (value_cache_ != nullptr && !is_mapped(*kd_entry))
+    {
+        std::optional<std::string> cached = value_cache_->get(*kd_entry);
+        if (cached.has_value())
+        {
+            done(std::move(*cached));
+            return;
+        }
+    }
 
-        // don't add keys with tombstone values to the keydir
-        if (value_str == std::to_string(TOMBSTONE))
+    // the datafile may have been removed by a merge since the keydir lookup,
+    // get() retries the lookup
+    absl::StatusOr<std::shared_ptr<const ReadableFile>> file =
+        is_mapped(*kd_entry) ? absl::NotFoundError("Datafile removed")
+                             : fd_cache_.get(kd_entry->fileid, datafile_path(kd_entry->fileid));
+    if (!file.ok())
+    {
+        if (file.status().code() != absl::StatusCode::kNotFound)
         {
-            // remove the key from the keydir in case it was added before
-            absl::Status status = keydir_.del(key_str);
-            // increment the offset
-            active_file_offset_ += Store::CRC_SIZE + Store::KSZ_SIZE + Store::VSZ_SIZE + cur_df_entry.ksz + cur_df_entry.vsz;
-            continue;
+            done(file.status());
+            return;
         }
+        (*engine)->run([this, key, done = std::move(done)]() { done(get(key)); });
+        return;
+    }
+
+    auto [offset, size] = value_range(*kd_entry, key.size());
+    auto buffer = std::make_shared<std::string>(size, '\0');
+    keydir::Entry entry = *kd_entry;
+    (*engine)->read(*file, buffer->data(), size, offset,
+                    [this, key, entry, buffer, done = std::move(done)](absl::Status status) {
+                        if (!status.ok())
+                        {
+                            done(absl::InternalError("Failed to read value from file: " +
+                                                     std::string(status.message())));
+                            return;
+                        }
+                        absl::StatusOr<std::string> value = finish_value(std::move(*buffer), entry, key);
+                        if (value_cache_ != nullptr && value.ok())
+                        {
+                            value_cache_->insert(entry, *value);
+                        }
+                        done(std::move(value));
+                    });
+}
 
-        // update the keydir
-        keydir::Entry entry_info = {active_fileid_, static_cast<std::uint16_t>(cur_df_entry.vsz), active_file_offset_};
-        absl::Status status = keydir_.set(key_str, entry_info);
+std::future<absl::StatusOr<std::string>> Store::async_get(const std::string &key) const
+{
+    auto promise = std::make_shared<std::promise<absl::StatusOr<std::string>>>();
+    std::future<absl::StatusOr<std::string>> value = promise->get_future();
+    async_get(key, [promise](absl::StatusOr<std::string> result) { promise->set_value(std::move(result)); });
+    return value;
+}
 
-        // increment the offset
-        active_file_offset_ += Store::CRC_SIZE + Store::KSZ_SIZE + Store::VSZ_SIZE + cur_df_entry.ksz + cur_df_entry.vsz;
+void Store::async_set(const std::string &key, const std::string &value, StatusCallback done)
+{
+    absl::StatusOr<IoEngine *> engine = io_engine();
+    if (!engine.ok())
+    {
+        done(engine.status());
+        return;
     }
 
-    // close the file
-    file.close();
+    // concurrent appends are written together by the group commit of the
+    // datafile writer
+    (*engine)->run([this, key, value, done = std::move(done)]() { done(set(key, value)); });
+}
 
-    return absl::OkStatus();
+std::future<absl::Status> Store::async_set(const std::string &key, const std::string &value)
+{
+    auto promise = std::make_shared<std::promise<absl::Status>>();
+    std::future<absl::Status> status = promise->get_future();
+    async_set(key, value, [promise](absl::Status result) { promise->set_value(std::move(result)); });
+    return status;
 }
 
-absl::StatusOr<std::string> Store::read_value(std::ifstream &file, std::uint16_t vsz) const
+void Store::async_del(const std::string &key, StatusCallback done)
 {
-    // seek to the position of the key size in the file
-    file.seekg(Store::CRC_SIZE, std::ios::cur);
-    if (file.fail())
+    absl::StatusOr<IoEngine *> engine = io_engine();
+    if (!engine.ok())
     {
-        return absl::InternalError("Failed to seek to value position");
+        done(engine.status());
+        return;
     }
 
-    // read the key size to get the position of the value
-    std::uint16_t ksz;
-    file.read(reinterpret_cast<char*>(&ksz), sizeof(ksz));
+    (*engine)->run([this, key, done = std::move(done)]() { done(del(key)); });
+}
+
+Task<absl::StatusOr<std::string>> Store::co_get(Executor &executor, std::string key) const
+{
+    co_return co_await CallbackAwaiter<absl::StatusOr<std::string>>(
+        executor, [this, &key](GetCallback done) { async_get(key, std::move(done)); });
+}
+
+Task<absl::Status> Store::co_set(Executor &executor, std::string key, std::string value)
+{
+    co_return co_await CallbackAwaiter<absl::Status>(
+        executor, [this, &key, &value](StatusCallback done) { async_set(key, value, std::move(done)); });
+}
+
+Task<absl::Status> Store::co_del(Executor &executor, std::string key)
+{
+    co_return co_await CallbackAwaiter<absl::Status>(
+        executor, [this, &key](StatusCallback done) { async_del(key, std::move(done)); });
+}
+
+absl::StatusOr<IoEngine *> Store::io_engine() const
+{
+    std::call_once(io_engine_once_, [this]() {
+        absl::StatusOr<std::unique_ptr<IoEngine>> engine =
+            IoEngine::create(options_.io_backend, options_.io_queue_depth, options_.io_threads);
+        if (engine.ok())
+        {
+            io_engine_ = std::move(*engine);
+        }
+        else
+        {
+            io_engine_status_ = engine.status();
+        }
+    });
+    if (io_engine_ == nullptr)
+    {
+        return io_engine_status_;
+    }
+
+    return io_engine_.get();
+}
+
+void Store::read_values(fileid_t fileid, std::span<const PendingRead> reads, std::span<const std::string_view> keys,
+                        std::vector<absl::StatusOr<std::string>> &values) const
+{
+    absl::StatusOr<std::shared_ptr<const ReadableFile>> file = fd_cache_.get(fileid, datafile_path(fileid));
+    if (!file.ok())
+    {
+        for (const PendingRead &read : reads)
+        {
+            values[read.index] = file.status();
+        }
+        return;
+    }
 
-    // seek to the position of the value in the file
-    file.seekg(Store::VSZ_SIZE + ksz, std::ios::cur);
+    auto range = [&](const PendingRead &read) { return value_range(read.entry, keys[read.index].size()); };
 
-    // read the value
-    std::string value_str;
-    value_str.resize(vsz);
-    file.read(reinterpret_cast<char*>(&value_str[0]), vsz);
-    if (file.fail())
+    std::string gap(MULTI_GET_MAX_GAP, '\0');
+    std::vector<std::string> buffers(reads.size());
+    std::vector<iovec> iov;
+    std::size_t begin = 0;
+    while (begin < reads.size())
     {
-        return absl::InternalError("Failed to read value from file");
+        // extend the run with the following values while the gap to the
+        // previous one is small. A value read twice starts a new run.
+        auto [offset, size] = range(reads[begin]);
+        std::uint64_t run_end = offset + size;
+        buffers[begin].resize(size);
+        iov.assign(1, {.iov_base = buffers[begin].data(), .iov_len = size});
+        std::size_t end = begin + 1;
+        for (; end < reads.size() && iov.size() + 2 <= IOV_MAX; end++)
+        {
+            auto [next_offset, next_size] = range(reads[end]);
+            if (next_offset < run_end || next_offset - run_end > MULTI_GET_MAX_GAP)
+            {
+                break;
+            }
+            if (next_offset > run_end)
+            {
+                iov.push_back({.iov_base = gap.data(), .iov_len = static_cast<std::size_t>(next_offset - run_end)});
+            }
+            buffers[end].resize(next_size);
+            iov.push_back({.iov_base = buffers[end].data(), .iov_len = next_size});
+            run_end = next_offset + next_size;
+        }
+
+        absl::Status status = (*file)->preadv(iov, offset);
+        for (std::size_t i = begin; i < end; i++)
+        {
+            std::size_t index = reads[i].index;
+            if (!status.ok())
+            {
+                values[index] = absl::InternalError("Failed to read value from file: " + std::string(status.message()));
+                continue;
+            }
+            values[index] = finish_value(std::move(buffers[i]), reads[i].entry, keys[index]);
+            if (value_cache_ != nullptr && values[index].ok())
+            {
+                value_cache_->insert(reads[i].entry, *values[index]);
+            }
+        }
+        begin = end;
+    }
+}
+
+absl::Status Store::del(const std::string &key)
+{
+    // check if the key exists in the keydir
+    if (!lookup(key).ok())
+    {
+        return absl::NotFoundError("Key not found");
+    }
+
+    // write the tombstone to the file, the key is removed from the keydir
+    // once it is written
+    return append_record(key, std::string(), Store::FLAG_TOMBSTONE);
+}
+
+absl::Status Store::list() const
+{
+    std::vector<std::string> keys = keydir_.keys();
+    if (keys.empty())
+    {
+        std::cout << "Empty" << std::endl;
+        return absl::OkStatus();
+    }
+    std::string joined_keys = absl::StrJoin(keys, ", ");
+    std::cout << absl::StrCat("Keys[", keys.size(), "]: ", joined_keys) << std::endl;
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>> Store::range(std::string_view begin, std::string_view end,
+                                                      std::size_t limit) const
+{
+    return keydir_.range(begin, end, limit, now());
+}
+
+absl::StatusOr<std::vector<std::string>> Store::scan_prefix(std::string_view prefix, std::size_t limit) const
+{
+    // the keys with the prefix end before the smallest key greater than all
+    // of them: the prefix without its trailing 0xFF bytes, last byte + 1
+    std::string end(prefix);
+    while (!end.empty() && static_cast<unsigned char>(end.back()) == 0xFF)
+    {
+        end.pop_back();
+    }
+    if (!end.empty())
+    {
+        end.back() = static_cast<char>(static_cast<unsigned char>(end.back()) + 1);
+    }
+
+    return range(prefix, end, limit);
+}
+
+Cursor Store::scan(std::size_t buffer_size) const
+{
+    {
+        std::unique_lock<std::mutex> lock(scan_mutex_);
+        scan_cv_.wait(lock, [this]() { return !merging_; });
+        open_cursors_++;
+    }
+
+    return Cursor(this, datafile_ids(), buffer_size);
+}
+
+void Store::end_scan() const
+{
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex_);
+        open_cursors_--;
+    }
+    scan_cv_.notify_all();
+}
+
+absl::Status Store::sync()
+{
+    std::shared_lock<std::shared_mutex> lock(write_mutex_);
+    if (writer_ == nullptr)
+    {
+        return absl::OkStatus();
+    }
+    return writer_->sync();
+}
+
+absl::Status Store::load_keydir()
+{
+    std::lock_guard<std::shared_mutex> lock(write_mutex_);
+
+    absl::StatusOr<MergeManifest> merged = recover_merge();
+    if (!merged.ok())
+    {
+        return merged.status();
+    }
+
+    // the file ids of the last merge are never reused, even if it removed
+    // every datafile
+    fileid_t merged_fileid = merged->max_fileid();
+    std::vector<fileid_t> fileids = datafile_ids();
+    if (fileids.empty())
+    {
+        active_fileid_ = merged_fileid + 1;
+        active_file_offset_ = 0;
+        next_fileid_ = active_fileid_ + 1;
+        return absl::OkStatus();
+    }
+
+    // the records of the last merge are older than the records of the other
+    // datafiles, whatever their file ids: read them first, then the other
+    // datafiles from the oldest to the newest so that the latest write of a
+    // key overrides the previous ones
+    std::unordered_set<fileid_t> merged_set(merged->outputs.begin(), merged->outputs.end());
+    std::stable_partition(fileids.begin(), fileids.end(),
+                          [&](fileid_t fileid) { return merged_set.count(fileid) > 0; });
+
+    auto is_sealed = [&](fileid_t fileid) {
+        fs::perms perms = fs::status(datafile_path(fileid)).permissions();
+        return (perms & fs::perms::owner_write) == fs::perms::none;
+    };
+
+    // read the datafiles in parallel and apply their partial keydirs in
+    // order. Only a window of datafiles is read ahead of the one being
+    // applied to bound the memory used by the partial keydirs.
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(options_.load_threads);
+    std::size_t window = 2 * pool.size();
+    std::deque<std::future<absl::StatusOr<PartialKeyDir>>> pending;
+    std::size_t next = 0;
+    auto submit_next = [&]() {
+        fileid_t fileid = fileids[next++];
+        bool sealed = is_sealed(fileid);
+        pending.push_back(pool.submit([this, fileid, sealed]() { return read_partial_keydir(fileid, sealed); }));
+    };
+    while (next < fileids.size() && pending.size() < window)
+    {
+        submit_next();
+    }
+
+    LoadStats stats;
+    stats.threads = pool.size();
+    fileid_t max_fileid = *std::max_element(fileids.begin(), fileids.end());
+    fileid_t last_fileid = 0;
+    std::uint64_t last_file_size = 0;
+    std::vector<hintfile::Entry> last_hints;
+    for (fileid_t fileid : fileids)
+    {
+        absl::StatusOr<PartialKeyDir> partial = pending.front().get();
+        pending.pop_front();
+        if (next < fileids.size())
+        {
+            submit_next();
+        }
+        if (!partial.ok())
+        {
+            return partial.status();
+        }
+
+        // don't add keys with tombstone values to the keydir, remove the key
+        // in case it was added by a previous datafile
+        for (const auto &[key, latest] : partial->latest)
+        {
+            if (latest.tombstone)
+            {
+                keydir_.del(key).IgnoreError();
+                continue;
+            }
+            absl::Status status = keydir_.set(key, latest.entry);
+            if (!status.ok())
+            {
+                return status;
+            }
+        }
+        stats.files.push_back({.fileid = fileid,
+                               .from_hint = partial->from_hint,
+                               .records = partial->records,
+                               .bytes = partial->file_size + partial->discarded_bytes,
+                               .discarded_bytes = partial->discarded_bytes,
+                               .duration = partial->duration});
+
+        // only the last datafile takes appends: an older one left unsealed
+        // (e.g. by a crash between the commit of a merge, whose outputs get
+        // higher file ids, and the rotation that follows it) is sealed
+        if (fileid != max_fileid && !is_sealed(fileid))
+        {
+            absl::Status status = seal_file(datafile_path(fileid));
+            if (!status.ok())
+            {
+                return status;
+            }
+            // hint files are best effort, the datafile is scanned when missing
+            hintfile::write(hint_path(fileid), partial->hints).IgnoreError();
+        }
+
+        if (fileid > last_fileid)
+        {
+            last_fileid = fileid;
+            last_file_size = partial->file_size;
+            last_hints = std::move(partial->hints);
+        }
+    }
+    stats.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    load_stats_ = std::move(stats);
+
+    // resume appending to the last datafile, unless it was already sealed
+    active_fileid_ = last_fileid;
+    active_file_offset_ = last_file_size;
+    next_fileid_ = std::max(last_fileid, merged_fileid) + 1;
+    active_hints_ = std::move(last_hints);
+    if (is_sealed(last_fileid))
+    {
+        active_fileid_ = allocate_fileid();
+        active_file_offset_ = 0;
+        active_hints_.clear();
+    }
+
+    return absl::OkStatus();
+}
+
+absl::StatusOr<Store::PartialKeyDir> Store::read_partial_keydir(fileid_t fileid, bool sealed) const
+{
+    auto start = std::chrono::steady_clock::now();
+    PartialKeyDir partial;
+
+    // prefer the hint file, fall back to the datafile if it is malformed
+    absl::Status status = absl::NotFoundError("No hint file");
+    if (sealed && fs::exists(hint_path(fileid)))
+    {
+        status = load_hintfile(fileid, partial);
+        partial.from_hint = status.ok();
+    }
+    if (!status.ok())
+    {
+        partial = PartialKeyDir();
+        status = load_datafile(fileid, partial);
+        bool truncated =
+            status.code() == absl::StatusCode::kDataLoss && options_.corruption_policy == CorruptionPolicy::kTruncate;
+        if (!status.ok() && !truncated)
+        {
+            return status;
+        }
+
+        // appends resume after the last valid record of the active datafile.
+        // Sealed datafiles are left as they are and get no hint file, so the
+        // corruption is reported again on every load.
+        if (truncated && !sealed)
+        {
+            std::error_code ec;
+            fs::resize_file(datafile_path(fileid), partial.file_size, ec);
+            if (ec)
+            {
+                return absl::InternalError("Failed to truncate datafile: " + ec.message());
+            }
+        }
+
+        // hint files are best effort, the datafile is scanned when missing
+        if (!truncated && sealed)
+        {
+            hintfile::write(hint_path(fileid), partial.hints).IgnoreError();
+        }
+    }
+    else
+    {
+        partial.file_size = fs::file_size(datafile_path(fileid));
+    }
+
+    partial.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return partial;
+}
+
+absl::Status Store::load_datafile(fileid_t fileid, PartialKeyDir &partial) const
+{
+    std::uint64_t valid_size = 0;
+    std::uint32_t load_time = now();
+    absl::Status status = scan_datafile(
+        fileid,
+        [&](std::string_view key, std::string_view value, const keydir::Entry &entry, const record::Header &header) {
+            bool tombstone = (header.flags & Store::FLAG_TOMBSTONE) != 0;
+            partial.hints.push_back({.key = std::string(key),
+                                     .vsz = entry.vsz,
+                                     .vpos = entry.vpos,
+                                     .tombstone = tombstone,
+                                     .flags = entry.flags,
+                                     .expiry = entry.expiry});
+            // an expired record deletes its key like a tombstone
+            partial.latest[std::string(key)] = {.entry = entry, .tombstone = tombstone || entry.expired(load_time)};
+            partial.records++;
+            valid_size = entry.vpos + Store::HEADER_SIZE + key.size() + value.size();
+            return absl::OkStatus();
+        },
+        partial.file_size);
+
+    // only the records before a corrupted one are kept, and the file header
+    // if it is whole (a bad one is not a DataLossError)
+    if (status.code() == absl::StatusCode::kDataLoss)
+    {
+        if (valid_size == 0 && partial.file_size >= FILE_HEADER_SIZE)
+        {
+            valid_size = FILE_HEADER_SIZE;
+        }
+        partial.discarded_bytes = partial.file_size - valid_size;
+        partial.file_size = valid_size;
+    }
+
+    return status;
+}
+
+absl::Status Store::load_hintfile(fileid_t fileid, PartialKeyDir &partial) const
+{
+    std::uint32_t load_time = now();
+    return hintfile::read(hint_path(fileid), [&](const hintfile::Entry &hint) {
+        keydir::Entry entry = {
+            .fileid = fileid, .vsz = hint.vsz, .vpos = hint.vpos, .flags = hint.flags, .expiry = hint.expiry};
+        partial.latest[hint.key] = {.entry = entry, .tombstone = hint.tombstone || entry.expired(load_time)};
+        partial.records++;
+        return absl::OkStatus();
+    });
+}
+
+absl::Status Store::scan_datafile(fileid_t fileid, const ScanCallback &callback, std::uint64_t &file_size) const
+{
+    // open the datafile for reading
+    std::error_code ec;
+    file_size = fs::file_size(datafile_path(fileid), ec);
+    if (ec)
+    {
+        return absl::InternalError("Error opening file");
+    }
+    absl::StatusOr<std::shared_ptr<ReadableFile>> file = ReadableFile::open(datafile_path(fileid), fileid);
+    if (!file.ok())
+    {
+        return absl::InternalError("Error opening file");
+    }
+
+    // records of a batch are held back until the end of the batch was read,
+    // their keys and values are copied to batch_bytes since the scan buffer
+    // is refilled in the meantime
+    struct PendingRecord
+    {
+        std::size_t pos;
+        keydir::Entry entry;
+        record::Header header;
+    };
+    std::vector<PendingRecord> batch;
+    std::string batch_bytes;
+    std::uint64_t batch_offset = 0;
+
+    // the records are parsed in place, the file being read a chunk at a time
+    RecordReader reader(*file, file_size, SCAN_BUFFER_SIZE);
+    record::View view;
+    for (;;)
+    {
+        absl::Status read_status = reader.next(view);
+        if (read_status.code() == absl::StatusCode::kOutOfRange)
+        {
+            break;
+        }
+        if (!read_status.ok())
+        {
+            return read_status;
+        }
+        std::uint64_t offset = reader.offset() - view.size();
+
+        keydir::Entry entry_info = {
+            .fileid = fileid,
+            .vsz = view.header.vsz,
+            .vpos = offset,
+            .flags = static_cast<std::uint8_t>(view.header.flags & Store::VALUE_FLAGS),
+            .expiry = (view.header.flags & Store::FLAG_EXPIRING) != 0 ? view.header.timestamp : 0};
+
+        bool in_batch = (view.header.flags & Store::FLAG_BATCH) != 0;
+        if (!in_batch && !batch.empty())
+        {
+            return absl::DataLossError("Unterminated batch in datafile " + std::to_string(fileid) + " at offset " +
+                                       std::to_string(batch_offset));
+        }
+        if (in_batch)
+        {
+            if (batch.empty())
+            {
+                batch_offset = offset;
+                batch_bytes.clear();
+            }
+            batch.push_back({batch_bytes.size(), entry_info, view.header});
+            batch_bytes.append(view.key);
+            batch_bytes.append(view.value);
+        }
+
+        absl::Status status;
+        if (!in_batch)
+        {
+            status = callback(view.key, view.value, entry_info, view.header);
+        }
+        else if ((view.header.flags & Store::FLAG_BATCH_END) != 0)
+        {
+            std::string_view bytes(batch_bytes);
+            for (const PendingRecord &record : batch)
+            {
+                status = callback(bytes.substr(record.pos, record.header.ksz),
+                                  bytes.substr(record.pos + record.header.ksz, record.entry.vsz), record.entry,
+                                  record.header);
+                if (!status.ok())
+                {
+                    break;
+                }
+            }
+            batch.clear();
+        }
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+
+    // a batch cut short by a crash is dropped as a whole
+    if (!batch.empty())
+    {
+        return absl::DataLossError("Incomplete batch in datafile " + std::to_string(fileid) + " at offset " +
+                                   std::to_string(batch_offset));
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status Store::rotate()
+{
+    // close the append handle, syncing the datafile if the policy asks for it
+    if (writer_ != nullptr)
+    {
+        absl::Status status = writer_->close();
+        writer_.reset();
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+
+    // seal the active datafile by removing its write permissions and write
+    // its hint file, the datafile may not exist yet if nothing was written
+    // to it
+    if (fs::exists(active_datafile_path()))
+    {
+        absl::Status status = seal_file(active_datafile_path());
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        // hint files are best effort, the datafile is scanned when missing
+        hintfile::write(hint_path(active_fileid_), active_hints_).IgnoreError();
+    }
+    active_hints_.clear();
+
+    active_fileid_ = allocate_fileid();
+    active_file_offset_ = 0;
+
+    return absl::OkStatus();
+}
+
+absl::Status Store::open_writer()
+{
+    if (writer_ != nullptr)
+    {
+        return absl::OkStatus();
+    }
+
+    absl::StatusOr<std::unique_ptr<DatafileWriter>> writer =
+        DatafileWriter::open(active_datafile_path(), active_fileid_, options_.sync_policy, options_.sync_interval);
+    if (!writer.ok())
+    {
+        return writer.status();
+    }
+    writer_ = std::move(*writer);
+    // a new datafile starts with its file header
+    active_file_offset_ = writer_->size();
+
+    return absl::OkStatus();
+}
+
+absl::Status Store::merge()
+{
+    std::lock_guard<std::mutex> merge_lock(merge_mutex_);
+
+    // a cursor would miss the records moved to the outputs, which it does not
+    // read
+    {
+        std::unique_lock<std::mutex> lock(scan_mutex_);
+        scan_cv_.wait(lock, [this]() { return open_cursors_ == 0; });
+        merging_ = true;
+    }
+    absl::Status status = merge_datafiles();
+    {
+        std::lock_guard<std::mutex> lock(scan_mutex_);
+        merging_ = false;
+    }
+    scan_cv_.notify_all();
+
+    return status;
+}
+
+absl::Status Store::merge_datafiles()
+{
+    // seal the active datafile so that every existing record is merged
+    std::vector<fileid_t> inputs;
+    {
+        std::lock_guard<std::shared_mutex> lock(write_mutex_);
+        if (active_file_offset_ > FILE_HEADER_SIZE)
+        {
+            absl::Status status = rotate();
+            if (!status.ok())
+            {
+                return status;
+            }
+        }
+        for (fileid_t fileid : datafile_ids())
+        {
+            if (fileid != active_fileid_)
+            {
+                inputs.push_back(fileid);
+            }
+        }
+    }
+    if (inputs.empty())
+    {
+        return absl::OkStatus();
+    }
+
+    // copy the live records to the outputs. Every older version of a key is
+    // part of the inputs, so the tombstones can be dropped.
+    struct MovedRecord
+    {
+        std::string key;
+        keydir::Entry from;
+        keydir::Entry to;
+    };
+    std::vector<MovedRecord> moved;
+    MergeManifest manifest;
+    manifest.inputs = inputs;
+    std::unique_ptr<DatafileWriter> output;
+    std::vector<hintfile::Entry> output_hints;
+
+    // close the current output and write its hint file, which is only used
+    // once the output is installed
+    auto close_output = [&]() {
+        absl::Status status = output->close();
+        if (status.ok())
+        {
+            status = hintfile::write(hint_path(output->fileid()), output_hints);
+        }
+        output.reset();
+        output_hints.clear();
+        return status;
+    };
+
+    absl::Status status;
+    std::string encoded;
+    std::uint32_t merge_time = now();
+    for (fileid_t fileid : inputs)
+    {
+        std::uint64_t file_size = 0;
+        status = scan_datafile(
+            fileid,
+            [&](std::string_view key, std::string_view value, const keydir::Entry &entry, const record::Header &header) {
+                if ((header.flags & Store::FLAG_TOMBSTONE) != 0)
+                {
+                    return absl::OkStatus();
+                }
+                absl::StatusOr<keydir::Entry> current = keydir_.get(key);
+                if (!current.ok() || !(*current == entry))
+                {
+                    return absl::OkStatus(); // overwritten or deleted since
+                }
+                if (entry.expired(merge_time))
+                {
+                    keydir_.erase_if(key, entry);
+                    return absl::OkStatus();
+                }
+
+                encoded.clear();
+                // the value is copied as it is stored, compressed or not
+                record::append(encoded, key, value, header.flags & (Store::VALUE_FLAGS | Store::FLAG_EXPIRING),
+                               header.timestamp);
+                if (output == nullptr ||
+                    (output->size() > FILE_HEADER_SIZE && output->size() + encoded.size() > options_.max_file_size))
+                {
+                    if (output != nullptr)
+                    {
+                        absl::Status close_status = close_output();
+                        if (!close_status.ok())
+                        {
+                            return close_status;
+                        }
+                    }
+                    fileid_t output_fileid;
+                    {
+                        std::lock_guard<std::shared_mutex> lock(write_mutex_);
+                        output_fileid = allocate_fileid();
+                    }
+                    manifest.outputs.push_back(output_fileid);
+                    absl::StatusOr<std::unique_ptr<DatafileWriter>> opened =
+                        DatafileWriter::open(merge_output_path(output_fileid), output_fileid, SyncPolicy::kPerBatch);
+                    if (!opened.ok())
+                    {
+                        return opened.status();
+                    }
+                    output = std::move(*opened);
+                }
+
+                absl::StatusOr<std::uint64_t> offset = output->append(encoded);
+                if (!offset.ok())
+                {
+                    return offset.status();
+                }
+                keydir::Entry moved_entry = entry;
+                moved_entry.fileid = output->fileid();
+                moved_entry.vpos = *offset;
+                moved.push_back({std::string(key), entry, moved_entry});
+                output_hints.push_back({.key = std::string(key),
+                                        .vsz = entry.vsz,
+                                        .vpos = *offset,
+                                        .tombstone = false,
+                                        .flags = entry.flags,
+                                        .expiry = entry.expiry});
+                return absl::OkStatus();
+            },
+            file_size);
+
+        // the records after a corrupted one are not in the keydir either
+        if (status.code() == absl::StatusCode::kDataLoss && options_.corruption_policy == CorruptionPolicy::kTruncate)
+        {
+            status = absl::OkStatus();
+        }
+        if (!status.ok())
+        {
+            break;
+        }
+    }
+    if (status.ok() && output != nullptr)
+    {
+        status = close_output();
+    }
+    output.reset();
+
+    // commit the merge
+    if (status.ok())
+    {
+        status = write_merge_manifest(manifest);
+    }
+    if (!status.ok())
+    {
+        for (fileid_t fileid : manifest.outputs)
+        {
+            std::error_code ec;
+            fs::remove(merge_output_path(fileid), ec);
+            fs::remove(hint_path(fileid), ec);
+        }
+        return status;
+    }
+
+    // point the keydir to the merged records, unless they were overwritten
+    // or deleted during the merge, then drop the merged datafiles
+    status = install_merge_outputs(manifest.outputs);
+    if (!status.ok())
+    {
+        return status;
+    }
+    // the outputs got file ids above the active datafile, which would no
+    // longer be the last one on reload: seal it and append after the outputs
+    {
+        std::lock_guard<std::shared_mutex> lock(write_mutex_);
+        status = rotate();
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+    for (const MovedRecord &record : moved)
+    {
+        keydir_.replace_if(record.key, record.from, record.to);
+    }
+
+    return finish_merge(manifest);
+}
+
+absl::Status Store::start_merge()
+{
+    std::lock_guard<std::mutex> lock(merge_state_mutex_);
+    if (merge_running_)
+    {
+        return absl::FailedPreconditionError("A merge is already running");
+    }
+    if (merge_thread_.joinable())
+    {
+        merge_thread_.join();
+    }
+
+    merge_running_ = true;
+    merge_thread_ = std::thread([this]() {
+        absl::Status status = merge();
+        std::lock_guard<std::mutex> lock(merge_state_mutex_);
+        merge_status_ = status;
+        merge_running_ = false;
+    });
+
+    return absl::OkStatus();
+}
+
+absl::Status Store::wait_for_merge()
+{
+    std::thread merge_thread;
+    {
+        std::lock_guard<std::mutex> lock(merge_state_mutex_);
+        merge_thread = std::move(merge_thread_);
+    }
+    if (merge_thread.joinable())
+    {
+        merge_thread.join();
+    }
+
+    std::lock_guard<std::mutex> lock(merge_state_mutex_);
+    return merge_status_;
+}
+
+fileid_t Store::MergeManifest::max_fileid() const
+{
+    fileid_t max_fileid = last_fileid;
+    for (const std::vector<fileid_t> *fileids : {&outputs, &inputs})
+    {
+        for (fileid_t fileid : *fileids)
+        {
+            max_fileid = std::max(max_fileid, fileid);
+        }
+    }
+
+    return max_fileid;
+}
+
+absl::StatusOr<Store::MergeManifest> Store::read_merge_manifest() const
+{
+    MergeManifest manifest;
+    std::ifstream file(merge_manifest_path());
+    if (!file.is_open())
+    {
+        return manifest;
+    }
+
+    // one "<output|input> <fileid>" line per datafile, and a "last <fileid>"
+    // line once the inputs are removed
+    std::string kind;
+    fileid_t fileid;
+    while (file >> kind >> fileid)
+    {
+        if (kind == "output")
+        {
+            manifest.outputs.push_back(fileid);
+        }
+        else if (kind == "input")
+        {
+            manifest.inputs.push_back(fileid);
+        }
+        else if (kind == "last")
+        {
+            manifest.last_fileid = fileid;
+        }
+        else
+        {
+            return absl::InternalError("Corrupted merge manifest");
+        }
+    }
+    if (!file.eof())
+    {
+        return absl::InternalError("Corrupted merge manifest");
+    }
+
+    return manifest;
+}
+
+absl::Status Store::write_merge_manifest(const MergeManifest &manifest) const
+{
+    std::string content;
+    for (fileid_t fileid : manifest.outputs)
+    {
+        absl::StrAppend(&content, "output ", fileid, "\n");
+    }
+    for (fileid_t fileid : manifest.inputs)
+    {
+        absl::StrAppend(&content, "input ", fileid, "\n");
+    }
+    if (manifest.last_fileid > 0)
+    {
+        absl::StrAppend(&content, "last ", manifest.last_fileid, "\n");
+    }
+
+    return write_file_durably(merge_manifest_path(), content);
+}
+
+absl::Status Store::install_merge_outputs(const std::vector<fileid_t> &outputs) const
+{
+    bool renamed = false;
+    for (fileid_t fileid : outputs)
+    {
+        if (!fs::exists(merge_output_path(fileid)))
+        {
+            continue;
+        }
+        absl::Status status = seal_file(merge_output_path(fileid));
+        if (!status.ok())
+        {
+            return status;
+        }
+        std::error_code ec;
+        fs::rename(merge_output_path(fileid), datafile_path(fileid), ec);
+        if (ec)
+        {
+            return absl::InternalError("Failed to rename merged datafile: " + ec.message());
+        }
+        renamed = true;
+    }
+
+    // the renames must be durable before the inputs are removed
+    return renamed ? sync_directory(db_path_) : absl::OkStatus();
+}
+
+absl::Status Store::remove_merge_inputs(const std::vector<fileid_t> &inputs) const
+{
+    for (fileid_t fileid : inputs)
+    {
+        fd_cache_.evict(fileid);
+        mmap_cache_.evict(fileid);
+        if (value_cache_ != nullptr)
+        {
+            value_cache_->erase_file(fileid);
+        }
+        std::error_code ec;
+        fs::remove(hint_path(fileid), ec);
+        fs::remove(datafile_path(fileid), ec);
+        if (ec)
+        {
+            return absl::InternalError("Failed to remove merged datafile: " + ec.message());
+        }
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status Store::finish_merge(const MergeManifest &manifest) const
+{
+    absl::Status status = remove_merge_inputs(manifest.inputs);
+    if (!status.ok() || manifest.inputs.empty())
+    {
+        return status;
+    }
+
+    // the outputs are kept, load_keydir reads them before the other datafiles
+    MergeManifest finished;
+    finished.outputs = manifest.outputs;
+    finished.last_fileid = manifest.max_fileid();
+    return write_merge_manifest(finished);
+}
+
+absl::StatusOr<Store::MergeManifest> Store::recover_merge() const
+{
+    absl::StatusOr<MergeManifest> manifest = read_merge_manifest();
+    if (!manifest.ok())
+    {
+        return manifest.status();
+    }
+
+    absl::Status status = install_merge_outputs(manifest->outputs);
+    if (!status.ok())
+    {
+        return status;
+    }
+    status = finish_merge(*manifest);
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    // the outputs (and their hint files) of a merge that did not commit are
+    // left over, as well as temporary files
+    std::error_code ec;
+    for (const fs::directory_entry &dir_entry : fs::directory_iterator(db_path_, ec))
+    {
+        fs::path path = dir_entry.path();
+        if (path.extension() == MERGE_SUFFIX || path.extension() == ".tmp" ||
+            (path.extension() == HINT_SUFFIX && !fs::exists(fs::path(path).replace_extension())))
+        {
+            fs::remove(path, ec);
+        }
+    }
+
+    return manifest;
+}
+
+fs::path Store::datafile_path(const fs::path &db_path, fileid_t fileid)
+{
+    return db_path / fs::path(DATAFILE_PREFIX + std::to_string(fileid));
+}
+
+fs::path Store::hint_path(const fs::path &db_path, fileid_t fileid)
+{
+    return fs::path(datafile_path(db_path, fileid).string() + HINT_SUFFIX);
+}
+
+std::vector<fileid_t> Store::datafile_ids() const
+{
+    std::vector<fileid_t> fileids;
+    std::error_code ec;
+    for (const fs::directory_entry &dir_entry : fs::directory_iterator(db_path_, ec))
+    {
+        std::string name = dir_entry.path().filename().string();
+        if (name.size() <= DATAFILE_PREFIX.size() || name.compare(0, DATAFILE_PREFIX.size(), DATAFILE_PREFIX) != 0)
+        {
+            continue;
+        }
+        std::string suffix = name.substr(DATAFILE_PREFIX.size());
+        if (suffix.find_first_not_of("0123456789") != std::string::npos)
+        {
+            continue;
+        }
+        fileids.push_back(static_cast<fileid_t>(std::stoul(suffix)));
+    }
+    std::sort(fileids.begin(), fileids.end());
+
+    return fileids;
+}
+
+absl::StatusOr<std::string> Store::read_value(const keydir::Entry &entry, const std::string &key) const
+{
+    absl::StatusOr<std::shared_ptr<const ReadableFile>> file = fd_cache_.get(entry.fileid, datafile_path(entry.fileid));
+    if (!file.ok())
+    {
+        return file.status();
+    }
+
+    auto [offset, size] = value_range(entry, key.size());
+    std::string value_str(size, '\0');
+    absl::Status status = (*file)->pread(value_str.data(), value_str.size(), offset);
+    if (!status.ok())
+    {
+        return absl::InternalError("Failed to read value from file: " + std::string(status.message()));
+    }
+
+    return finish_value(std::move(value_str), entry, key);
+}
+
+absl::Status Store::stream_value(const ReadableFile &file, const keydir::Entry &entry, const std::string &key,
+                                 const ChunkSink &sink) const
+{
+    // a compressed value is only checked and decompressed whole, it is then
+    // handed out in chunks
+    if ((entry.flags & Store::VALUE_FLAGS) != 0)
+    {
+        auto [offset, size] = value_range(entry, key.size());
+        std::string bytes(size, '\0');
+        absl::Status status = file.pread(bytes.data(), bytes.size(), offset);
+        if (!status.ok())
+        {
+            return absl::InternalError("Failed to read value from file: " + std::string(status.message()));
+        }
+        absl::StatusOr<std::string> value = finish_value(std::move(bytes), entry, key);
+        if (!value.ok())
+        {
+            return value.status();
+        }
+        for (std::size_t done = 0; done < value->size(); done += STREAM_CHUNK_SIZE)
+        {
+            status = sink(std::string_view(*value).substr(done, STREAM_CHUNK_SIZE));
+            if (!status.ok())
+            {
+                return status;
+            }
+        }
+        return absl::OkStatus();
+    }
+
+    // the header and the key are only read to check the record
+    std::string chunk(std::min<std::uint64_t>(std::max<std::uint64_t>(entry.vsz, Store::HEADER_SIZE + key.size()),
+                                              STREAM_CHUNK_SIZE),
+                      '\0');
+    std::uint32_t crc = 0;
+    std::uint32_t stored = 0;
+    if (options_.verify_checksums)
+    {
+        absl::Status status = file.pread(chunk.data(), Store::HEADER_SIZE + key.size(), entry.vpos);
+        if (!status.ok())
+        {
+            return absl::InternalError("Failed to read value from file: " + std::string(status.message()));
+        }
+        std::string_view head(chunk.data(), Store::HEADER_SIZE + key.size());
+        if (head.substr(Store::HEADER_SIZE) != key)
+        {
+            return absl::DataLossError("Record does not hold the key");
+        }
+        stored = record::load_le32(head.data());
+        crc = crc32c::value(head.substr(Store::CRC_SIZE));
+    }
+
+    std::uint64_t value_pos = entry.vpos + Store::HEADER_SIZE + key.size();
+    for (std::uint64_t done = 0; done < entry.vsz;)
+    {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(entry.vsz - done, chunk.size()));
+        absl::Status status = file.pread(chunk.data(), n, value_pos + done);
+        if (!status.ok())
+        {
+            return absl::InternalError("Failed to read value from file: " + std::string(status.message()));
+        }
+        std::string_view piece(chunk.data(), n);
+        crc = options_.verify_checksums ? crc32c::extend(crc, piece) : crc;
+        status = sink(piece);
+        if (!status.ok())
+        {
+            return status;
+        }
+        done += n;
+    }
+
+    if (options_.verify_checksums && crc != stored)
+    {
+        return absl::DataLossError("Checksum mismatch");
+    }
+
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::string> Store::read_cached_value(const keydir::Entry &entry, const std::string &key) const
+{
+    if (value_cache_ == nullptr)
+    {
+        return read_value(entry, key);
+    }
+
+    std::optional<std::string> cached = value_cache_->get(entry);
+    if (cached.has_value())
+    {
+        return std::move(*cached);
+    }
+    absl::StatusOr<std::string> value = read_value(entry, key);
+    if (value.ok())
+    {
+        value_cache_->insert(entry, *value);
+    }
+
+    return value;
+}
+
+void Store::forget_value(std::string_view key) const
+{
+    if (value_cache_ == nullptr)
+    {
+        return;
+    }
+
+    absl::StatusOr<keydir::Entry> previous = keydir_.get(key);
+    if (previous.ok())
+    {
+        value_cache_->erase(*previous);
+    }
+}
+
+std::pair<std::uint64_t, std::size_t> Store::value_range(const keydir::Entry &entry, std::size_t key_size) const
+{
+    // the value is located after the header and the key of the record, the
+    // whole record is read to check it
+    std::size_t value_pos = Store::HEADER_SIZE + key_size;
+    if (options_.verify_checksums)
+    {
+        return {entry.vpos, value_pos + entry.vsz};
+    }
+    return {entry.vpos + value_pos, entry.vsz};
+}
+
+absl::StatusOr<std::string> Store::finish_value(std::string bytes, const keydir::Entry &entry,
+                                                 std::string_view key) const
+{
+    if (options_.verify_checksums)
+    {
+        absl::Status status = verify_record(bytes, key);
+        if (!status.ok())
+        {
+            return status;
+        }
+        bytes.erase(0, Store::HEADER_SIZE + key.size());
+    }
+
+    return decode_value(std::move(bytes), entry);
+}
+
+std::string_view Store::encode_value(std::string_view value, std::string &buffer, std::uint8_t &flags) const
+{
+    return encode_value(*compressor_, value, buffer, flags);
+}
+
+std::string_view Store::encode_value(const Compressor &compressor, std::string_view value, std::string &buffer,
+                                     std::uint8_t &flags)
+{
+    switch (compressor.compress(value, buffer))
+    {
+    case Compression::kLz4:
+        flags = Store::FLAG_LZ4;
+        return buffer;
+    case Compression::kZstd:
+        flags = Store::FLAG_ZSTD;
+        return buffer;
+    case Compression::kNone:
+        break;
+    }
+
+    flags = 0;
+    return value;
+}
+
+absl::StatusOr<std::string> Store::decode_value(std::string bytes, const keydir::Entry &entry) const
+{
+    if ((entry.flags & Store::VALUE_FLAGS) == 0)
+    {
+        return bytes;
+    }
+
+    Compression codec = (entry.flags & Store::FLAG_LZ4) != 0 ? Compression::kLz4 : Compression::kZstd;
+    std::string value;
+    absl::Status status = compressor_->decompress(codec, bytes, value);
+    if (!status.ok())
+    {
+        return status;
+    }
+
+    return value;
+}
+
+absl::StatusOr<ValueView> Store::map_value(const keydir::Entry &entry, std::string_view key) const
+{
+    absl::StatusOr<std::shared_ptr<const MappedFile>> file = mmap_cache_.get(entry.fileid, datafile_path(entry.fileid));
+    if (!file.ok())
+    {
+        return file.status();
+    }
+
+    std::size_t value_pos = Store::HEADER_SIZE + key.size();
+    absl::StatusOr<std::string_view> bytes = (*file)->view(entry.vpos, value_pos + entry.vsz);
+    if (!bytes.ok())
+    {
+        return absl::InternalError("Failed to read value from file: " + std::string(bytes.status().message()));
+    }
+
+    if (options_.verify_checksums)
+    {
+        absl::Status status = verify_record(*bytes, key);
+        if (!status.ok())
+        {
+            return status;
+        }
+    }
+
+    // compressed values can't be served from the mapping
+    if ((entry.flags & Store::VALUE_FLAGS) != 0)
+    {
+        absl::StatusOr<std::string> value = decode_value(std::string(bytes->substr(value_pos)), entry);
+        if (!value.ok())
+        {
+            return value.status();
+        }
+        return ValueView(std::move(*value));
     }
 
-    return value_str;
+    return ValueView(*file, bytes->substr(value_pos));
 }
 
 // absl::StatusOr<std::ofstream> Store::create_writer(fileid_t fileid)
@@ -0,0 +1,641 @@
+/**
+ * @file store_builder.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "store_builder.hpp"
+#include "file_util.hpp"
+#include "record_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <limits>
+
+namespace store
+{
+
+// Runs hold the items as records, deletes flagged as such. They are only read
+// back by the builder.
+static const std::uint8_t RUN_TOMBSTONE = 0x01;
+
+/**
+ * @class RunMerger
+ * @brief Merges the sorted runs of a build: yields every key once, in order,
+ *        with its item from the latest run holding it and without the deleted
+ *        keys.
+ */
+class RunMerger
+{
+  private:
+    struct Run
+    {
+        std::unique_ptr<RecordReader> reader;
+        record::View view; /** Current record, valid until the reader moves on */
+    };
+
+    std::vector<Run> runs_;
+    std::vector<std::size_t> heap_; /** Runs with a current record, the smallest key (latest run first) on top */
+
+    bool after(std::size_t a, std::size_t b) const
+    {
+        int order = runs_[a].view.key.compare(runs_[b].view.key);
+        return order != 0 ? order > 0 : a < b;
+    }
+
+    /**
+     * @brief Move a run to its next record, it leaves the heap at its end.
+     */
+    absl::Status advance(std::size_t run)
+    {
+        absl::Status status = runs_[run].reader->next(runs_[run].view);
+        if (status.code() == absl::StatusCode::kOutOfRange)
+        {
+            return absl::OkStatus();
+        }
+        if (!status.ok())
+        {
+            return status;
+        }
+        heap_.push_back(run);
+        std::push_heap(heap_.begin(), heap_.end(), [this](std::size_t a, std::size_t b) { return after(a, b); });
+        return absl::OkStatus();
+    }
+
+    std::size_t pop()
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), [this](std::size_t a, std::size_t b) { return after(a, b); });
+        std::size_t run = heap_.back();
+        heap_.pop_back();
+        return run;
+    }
+
+  public:
+    absl::Status open(const std::vector<fs::path> &paths, std::size_t buffer_size)
+    {
+        runs_.resize(paths.size());
+        for (std::size_t i = 0; i < paths.size(); i++)
+        {
+            std::error_code ec;
+            std::uint64_t file_size = fs::file_size(paths[i], ec);
+            absl::StatusOr<std::shared_ptr<ReadableFile>> file =
+                ReadableFile::open(paths[i], static_cast<fileid_t>(i));
+            if (ec || !file.ok())
+            {
+                return absl::InternalError("Error opening run " + paths[i].string());
+            }
+            runs_[i].reader = std::make_unique<RecordReader>(*file, file_size, buffer_size);
+            absl::Status status = advance(i);
+            if (!status.ok())
+            {
+                return status;
+            }
+        }
+
+        return absl::OkStatus();
+    }
+
+    /**
+     * @return absl::StatusOr<bool> Whether an item was read, false once the
+     *         runs are merged, or the error of a run.
+     */
+    absl::StatusOr<bool> next(std::string &key, std::string &value)
+    {
+        while (!heap_.empty())
+        {
+            std::size_t run = pop();
+            key.assign(runs_[run].view.key);
+            value.assign(runs_[run].view.value);
+            bool tombstone = (runs_[run].view.header.flags & RUN_TOMBSTONE) != 0;
+            absl::Status status = advance(run);
+
+            // the items of the key in the earlier runs are overridden
+            while (status.ok() && !heap_.empty() && runs_[heap_.front()].view.key == key)
+            {
+                status = advance(pop());
+            }
+            if (!status.ok())
+            {
+                return status;
+            }
+            if (!tombstone)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+const std::size_t StoreBuilder::CHUNK_SIZE = 4 * 1024 * 1024;
+const std::size_t StoreBuilder::RUN_BUFFER_SIZE = 1024 * 1024;
+const std::string StoreBuilder::RUN_PREFIX = "build.run";
+const std::uint64_t StoreBuilder::DEFAULT_MEMORY_LIMIT = 1024 * 1024 * 1024;
+
+StoreBuilder::StoreBuilder(const std::string &db_path, const Options &options, std::size_t threads,
+                           std::uint64_t memory_limit)
+    : db_path_(db_path), options_(options), memory_limit_(memory_limit), pool_(threads), memory_used_(0),
+      records_(0)
+{
+}
+
+StoreBuilder::~StoreBuilder()
+{
+    remove_runs();
+}
+
+void StoreBuilder::put(std::string key, std::string value)
+{
+    // after a failed spill the build fails, the items are not kept
+    if (!status_.ok())
+    {
+        records_++;
+        return;
+    }
+    items_.push_back({std::move(key), std::move(value), false});
+    account(items_.back());
+}
+
+void StoreBuilder::del(std::string key)
+{
+    if (!status_.ok())
+    {
+        records_++;
+        return;
+    }
+    items_.push_back({std::move(key), std::string(), true});
+    account(items_.back());
+}
+
+void StoreBuilder::account(const Item &item)
+{
+    records_++;
+    memory_used_ += sizeof(Item) + item.key.size() + item.value.size();
+    if (memory_limit_ > 0 && memory_used_ > memory_limit_)
+    {
+        status_ = spill();
+    }
+}
+
+absl::Status StoreBuilder::add(BulkReader &reader)
+{
+    BulkRecord record;
+    absl::Status status;
+    while (status_.ok() && (status = reader.next(record)).ok())
+    {
+        if (record.tombstone)
+        {
+            del(std::string(record.key));
+        }
+        else
+        {
+            put(std::string(record.key), std::string(record.value));
+        }
+    }
+    if (!status_.ok())
+    {
+        return status_;
+    }
+
+    return status.code() == absl::StatusCode::kOutOfRange ? absl::OkStatus() : status;
+}
+
+void StoreBuilder::sort(std::vector<Item> &items, ThreadPool &pool)
+{
+    auto by_key = [](const Item &a, const Item &b) { return a.key < b.key; };
+    std::size_t n_runs = std::min(pool.size(), items.size());
+    if (n_runs == 0)
+    {
+        return;
+    }
+
+    // bounds[i] is the start of run i, and the last bound the end of the items
+    std::vector<std::size_t> bounds;
+    for (std::size_t run = 0; run <= n_runs; run++)
+    {
+        bounds.push_back(items.size() * run / n_runs);
+    }
+    std::vector<std::future<void>> pending;
+    for (std::size_t run = 0; run < n_runs; run++)
+    {
+        pending.push_back(pool.submit([&items, &by_key, begin = bounds[run], end = bounds[run + 1]]() {
+            std::stable_sort(items.begin() + static_cast<std::ptrdiff_t>(begin),
+                             items.begin() + static_cast<std::ptrdiff_t>(end), by_key);
+        }));
+    }
+    for (std::future<void> &task : pending)
+    {
+        task.get();
+    }
+
+    // merge neighbouring runs pairwise until one is left, a merge is stable
+    // so the items of a key stay in the order they were added
+    while (bounds.size() > 2)
+    {
+        pending.clear();
+        std::vector<std::size_t> merged;
+        std::size_t i = 0;
+        for (; i + 2 < bounds.size(); i += 2)
+        {
+            pending.push_back(
+                pool.submit([&items, &by_key, begin = bounds[i], middle = bounds[i + 1], end = bounds[i + 2]]() {
+                    std::inplace_merge(items.begin() + static_cast<std::ptrdiff_t>(begin),
+                                       items.begin() + static_cast<std::ptrdiff_t>(middle),
+                                       items.begin() + static_cast<std::ptrdiff_t>(end), by_key);
+                }));
+            merged.push_back(bounds[i]);
+        }
+        if (i < bounds.size() - 1)
+        {
+            merged.push_back(bounds[i]); // odd run out, merged at the next level
+        }
+        merged.push_back(bounds.back());
+        for (std::future<void> &task : pending)
+        {
+            task.get();
+        }
+        bounds = std::move(merged);
+    }
+}
+
+void StoreBuilder::deduplicate(std::vector<Item> &items, bool keep_tombstones)
+{
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < items.size();)
+    {
+        std::size_t last = i;
+        while (last + 1 < items.size() && items[last + 1].key == items[i].key)
+        {
+            last++;
+        }
+        // nothing older than the builder is on disk: a deleted key is dropped
+        // unless it was set in an earlier run
+        if (keep_tombstones || !items[last].tombstone)
+        {
+            if (kept != last)
+            {
+                items[kept] = std::move(items[last]);
+            }
+            kept++;
+        }
+        i = last + 1;
+    }
+    items.erase(items.begin() + static_cast<std::ptrdiff_t>(kept), items.end());
+}
+
+absl::Status StoreBuilder::check_size(const Item &item)
+{
+    if (item.key.size() > std::numeric_limits<std::uint16_t>::max())
+    {
+        return absl::InvalidArgumentError("Key size is too large");
+    }
+    if (item.value.size() > std::numeric_limits<std::uint32_t>::max())
+    {
+        return absl::InvalidArgumentError("Value size is too large");
+    }
+
+    return absl::OkStatus();
+}
+
+absl::StatusOr<StoreBuilder::Chunk> StoreBuilder::encode(const std::vector<Item> &items, const Compressor &compressor,
+                                                         std::uint32_t timestamp)
+{
+    Chunk chunk;
+    std::string compressed;
+    for (const Item &item : items)
+    {
+        absl::Status status = check_size(item);
+        if (!status.ok())
+        {
+            return status;
+        }
+
+        std::uint8_t flags = 0;
+        std::string_view stored = Store::encode_value(compressor, item.value, compressed, flags);
+        chunk.hints.push_back({.key = item.key,
+                               .vsz = static_cast<std::uint32_t>(stored.size()),
+                               .vpos = chunk.bytes.size(),
+                               .tombstone = false,
+                               .flags = flags});
+        record::append(chunk.bytes, item.key, stored, flags, timestamp);
+    }
+
+    return chunk;
+}
+
+absl::Status StoreBuilder::prepare_directory()
+{
+    std::error_code ec;
+    for (const fs::directory_entry &entry : fs::directory_iterator(db_path_, ec))
+    {
+        if (std::find(runs_.begin(), runs_.end(), entry.path()) == runs_.end())
+        {
+            return absl::FailedPreconditionError("Directory is not empty: " + db_path_);
+        }
+    }
+    fs::create_directories(db_path_, ec);
+    if (ec)
+    {
+        return absl::InternalError("Failed to create directory: " + ec.message());
+    }
+
+    return absl::OkStatus();
+}
+
+absl::Status StoreBuilder::spill()
+{
+    absl::Status status = runs_.empty() ? prepare_directory() : absl::OkStatus();
+    if (!status.ok())
+    {
+        return status;
+    }
+    sort(items_, pool_);
+    deduplicate(items_, true);
+
+    // the run is removed with the others if it is not written whole
+    runs_.push_back(fs::path(db_path_) / fs::path(RUN_PREFIX + std::to_string(runs_.size())));
+    absl::StatusOr<std::unique_ptr<DatafileWriter>> run =
+        DatafileWriter::open(runs_.back(), static_cast<fileid_t>(runs_.size()), SyncPolicy::kNone);
+    if (!run.ok())
+    {
+        return run.status();
+    }
+    std::string buffer;
+    for (std::size_t i = 0; status.ok() && i < items_.size(); i++)
+    {
+        const Item &item = items_[i];
+        status = check_size(item);
+        if (status.ok())
+        {
+            record::append(buffer, item.key, item.value, item.tombstone ? RUN_TOMBSTONE : 0, 0);
+        }
+        if (status.ok() && (buffer.size() >= CHUNK_SIZE || i + 1 == items_.size()))
+        {
+            status = (*run)->append(buffer).status();
+            buffer.clear();
+        }
+    }
+    if (status.ok())
+    {
+        status = (*run)->close();
+    }
+
+    items_.clear();
+    memory_used_ = 0;
+    return status;
+}
+
+void StoreBuilder::remove_runs()
+{
+    std::error_code ec;
+    for (const fs::path &run : runs_)
+    {
+        fs::remove(run, ec);
+    }
+    runs_.clear();
+}
+
+absl::StatusOr<BuildStats> StoreBuilder::finish()
+{
+    auto start = std::chrono::steady_clock::now();
+    BuildStats stats;
+    stats.records = records_;
+    stats.threads = pool_.size();
+    records_ = 0;
+
+    // the items left in memory become the last run, unless none was spilled
+    absl::Status status = status_;
+    status_ = absl::OkStatus();
+    if (status.ok() && !runs_.empty() && !items_.empty())
+    {
+        status = spill();
+    }
+    if (status.ok() && runs_.empty())
+    {
+        status = prepare_directory();
+    }
+    absl::StatusOr<std::unique_ptr<Compressor>> compressor =
+        Compressor::create(options_.compression, options_.compression_level, options_.compression_dictionary);
+    if (status.ok() && !compressor.ok())
+    {
+        status = compressor.status();
+    }
+    std::vector<Item> items = std::move(items_);
+    items_ = std::vector<Item>();
+    memory_used_ = 0;
+    if (!status.ok())
+    {
+        remove_runs();
+        return status;
+    }
+
+    RunMerger merger;
+    stats.runs = runs_.size();
+    if (runs_.empty())
+    {
+        sort(items, pool_);
+        deduplicate(items, false);
+    }
+    else
+    {
+        status = merger.open(runs_, RUN_BUFFER_SIZE);
+    }
+
+    // encode chunks of items in parallel, only a window of chunks is encoded
+    // ahead of the one being written to bound the memory they use
+    std::uint32_t timestamp = static_cast<std::uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count());
+    std::deque<std::future<absl::StatusOr<Chunk>>> pending;
+    std::size_t next = 0;
+    bool exhausted = false;
+    auto submit_next = [&]() {
+        std::vector<Item> batch;
+        std::size_t bytes = 0;
+        Item item{.key = std::string(), .value = std::string(), .tombstone = false};
+        while (bytes < CHUNK_SIZE)
+        {
+            if (runs_.empty())
+            {
+                if (next == items.size())
+                {
+                    break;
+                }
+                item = std::move(items[next++]);
+            }
+            else
+            {
+                absl::StatusOr<bool> read = merger.next(item.key, item.value);
+                if (!read.ok())
+                {
+                    return read.status();
+                }
+                if (!*read)
+                {
+                    break;
+                }
+            }
+            bytes += item.key.size() + item.value.size();
+            batch.push_back(std::move(item));
+        }
+        if (batch.empty())
+        {
+            exhausted = true;
+            return absl::OkStatus();
+        }
+        stats.keys += batch.size();
+        pending.push_back(pool_.submit([batch = std::move(batch), &compressor, timestamp]() {
+            return encode(batch, **compressor, timestamp);
+        }));
+        return absl::OkStatus();
+    };
+    std::size_t window = 2 * pool_.size();
+    while (status.ok() && !exhausted && pending.size() < window)
+    {
+        status = submit_next();
+    }
+
+    // append the chunks to the datafiles in order, rolling over to a new
+    // datafile where a record would exceed the size threshold
+    std::unique_ptr<DatafileWriter> output;
+    std::vector<hintfile::Entry> output_hints;
+    std::uint64_t output_size = 0;
+    std::vector<fileid_t> outputs;
+
+    // sync, close and seal the current output and write its hint file
+    auto close_output = [&]() {
+        absl::Status status = output->sync();
+        if (status.ok())
+        {
+            status = output->close();
+        }
+        if (status.ok())
+        {
+            status = seal_file(Store::datafile_path(db_path_, output->fileid()));
+        }
+        if (status.ok())
+        {
+            status = hintfile::write(Store::hint_path(db_path_, output->fileid()), output_hints);
+        }
+        stats.bytes += output_size;
+        output.reset();
+        output_hints.clear();
+        output_size = 0;
+        return status;
+    };
+    auto open_output = [&]() {
+        // the file ids of a store start at 1
+        fileid_t fileid = static_cast<fileid_t>(outputs.size() + 1);
+        outputs.push_back(fileid);
+        absl::StatusOr<std::unique_ptr<DatafileWriter>> opened =
+            DatafileWriter::open(Store::datafile_path(db_path_, fileid), fileid, SyncPolicy::kNone);
+        if (!opened.ok())
+        {
+            return opened.status();
+        }
+        output = std::move(*opened);
+        output_size = output->size();
+        return absl::OkStatus();
+    };
+    auto write_bytes = [&](std::string_view bytes) {
+        if (bytes.empty())
+        {
+            return absl::OkStatus();
+        }
+        absl::StatusOr<std::uint64_t> offset = output->append(bytes);
+        if (!offset.ok())
+        {
+            return offset.status();
+        }
+        output_size += bytes.size();
+        return absl::OkStatus();
+    };
+
+    while (status.ok() && !pending.empty())
+    {
+        absl::StatusOr<Chunk> chunk = pending.front().get();
+        pending.pop_front();
+        if (!exhausted)
+        {
+            status = submit_next();
+        }
+        if (status.ok() && !chunk.ok())
+        {
+            status = chunk.status();
+        }
+        if (!status.ok())
+        {
+            break;
+        }
+
+        // the bytes of the chunk from written on are not written yet
+        std::string_view bytes = chunk->bytes;
+        std::uint64_t written = 0;
+        for (hintfile::Entry &hint : chunk->hints)
+        {
+            std::uint64_t size = record::encoded_size(hint.key.size(), hint.vsz);
+            std::uint64_t offset = output_size + (hint.vpos - written);
+            if (output == nullptr || (offset > FILE_HEADER_SIZE && offset + size > options_.max_file_size))
+            {
+                if (output != nullptr)
+                {
+                    status = write_bytes(bytes.substr(written, hint.vpos - written));
+                    if (status.ok())
+                    {
+                        status = close_output();
+                    }
+                }
+                if (status.ok())
+                {
+                    status = open_output();
+                }
+                if (!status.ok())
+                {
+                    break;
+                }
+                written = hint.vpos;
+                offset = output_size;
+            }
+            hint.vpos = offset;
+            output_hints.push_back(std::move(hint));
+        }
+        if (status.ok())
+        {
+            status = write_bytes(bytes.substr(written));
+        }
+    }
+    if (status.ok() && output != nullptr)
+    {
+        status = close_output();
+    }
+    output.reset();
+
+    // the encoding tasks still running use the compressor
+    for (std::future<absl::StatusOr<Chunk>> &task : pending)
+    {
+        task.wait();
+    }
+    remove_runs();
+
+    if (!status.ok())
+    {
+        std::error_code ec;
+        for (fileid_t fileid : outputs)
+        {
+            fs::remove(Store::datafile_path(db_path_, fileid), ec);
+            fs::remove(Store::hint_path(db_path_, fileid), ec);
+        }
+        return status;
+    }
+
+    stats.datafiles = outputs.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace store
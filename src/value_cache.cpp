@@ -0,0 +1,162 @@
+/**
+ * @file value_cache.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "value_cache.hpp"
+
+#include "absl/hash/hash.h"
+#include <bit>
+
+namespace store
+{
+
+const std::size_t ValueCache::DEFAULT_SHARDS = 16;
+const std::size_t ValueCache::ENTRY_OVERHEAD = sizeof(Slot) + 2 * sizeof(Key);
+
+void ValueCache::Shard::release(std::size_t slot)
+{
+    Slot &released = slots[slot];
+    index.erase(released.key);
+    charge -= released.value.size() + ENTRY_OVERHEAD;
+    released.value = std::string();
+    released.used = false;
+    free_slots.push_back(slot);
+}
+
+void ValueCache::Shard::evict_to_fit()
+{
+    while (charge > capacity)
+    {
+        hand = hand + 1 < slots.size() ? hand + 1 : 0;
+        Slot &slot = slots[hand];
+        if (!slot.used)
+        {
+            continue;
+        }
+        if (slot.referenced)
+        {
+            slot.referenced = false; // second chance
+            continue;
+        }
+        release(hand);
+        evictions++;
+    }
+}
+
+ValueCache::ValueCache(std::size_t capacity, std::size_t n_shards)
+{
+    std::size_t count = std::bit_ceil(n_shards > 0 ? n_shards : 1);
+    shards_ = std::make_unique<Shard[]>(count);
+    mask_ = count - 1;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        shards_[i].capacity = capacity / count;
+    }
+}
+
+ValueCache::Shard &ValueCache::shard(const Key &key) const
+{
+    // pick the shard with the high bits, the table uses the low ones
+    return shards_[(absl::Hash<Key>{}(key) >> 48) & mask_];
+}
+
+std::optional<std::string> ValueCache::get(const keydir::Entry &entry) const
+{
+    Key key(entry.fileid, entry.vpos);
+    Shard &s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it == s.index.end())
+    {
+        s.misses++;
+        return std::nullopt;
+    }
+
+    Slot &slot = s.slots[it->second];
+    slot.referenced = true;
+    s.hits++;
+    return slot.value;
+}
+
+void ValueCache::insert(const keydir::Entry &entry, std::string_view value)
+{
+    Key key(entry.fileid, entry.vpos);
+    Shard &s = shard(key);
+    std::size_t charge = value.size() + ENTRY_OVERHEAD;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (charge > s.capacity || s.index.contains(key))
+    {
+        return;
+    }
+
+    std::size_t slot;
+    if (s.free_slots.empty())
+    {
+        slot = s.slots.size();
+        s.slots.emplace_back();
+    }
+    else
+    {
+        slot = s.free_slots.back();
+        s.free_slots.pop_back();
+    }
+    s.slots[slot] = Slot{.key = key, .value = std::string(value), .referenced = false, .used = true};
+    s.index[key] = slot;
+    s.charge += charge;
+    s.inserts++;
+
+    s.evict_to_fit();
+}
+
+void ValueCache::erase(const keydir::Entry &entry)
+{
+    Key key(entry.fileid, entry.vpos);
+    Shard &s = shard(key);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it != s.index.end())
+    {
+        s.release(it->second);
+    }
+}
+
+void ValueCache::erase_file(fileid_t fileid)
+{
+    for (std::size_t i = 0; i <= mask_; i++)
+    {
+        Shard &s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        for (std::size_t slot = 0; slot < s.slots.size(); slot++)
+        {
+            if (s.slots[slot].used && s.slots[slot].key.first == fileid)
+            {
+                s.release(slot);
+            }
+        }
+    }
+}
+
+ValueCache::Stats ValueCache::stats() const
+{
+    Stats stats;
+    for (std::size_t i = 0; i <= mask_; i++)
+    {
+        Shard &s = shards_[i];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        stats.hits += s.hits;
+        stats.misses += s.misses;
+        stats.inserts += s.inserts;
+        stats.evictions += s.evictions;
+        stats.entries += s.index.size();
+        stats.bytes += s.charge;
+        stats.capacity += s.capacity;
+    }
+
+    return stats;
+}
+
+} // namespace store
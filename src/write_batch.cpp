@@ -0,0 +1,36 @@
+/**
+ * @file write_batch.cpp
+ * @author Lucas
+ * @brief
+ * @version 0.1
+ * @date 2026-10-17
+ */
+
+#include "write_batch.hpp"
+
+namespace store
+{
+
+WriteBatch::WriteBatch() : byte_size_(0)
+{
+}
+
+void WriteBatch::put(std::string key, std::string value)
+{
+    byte_size_ += key.size() + value.size();
+    ops_.push_back({.key = std::move(key), .value = std::move(value), .tombstone = false});
+}
+
+void WriteBatch::del(std::string key)
+{
+    byte_size_ += key.size();
+    ops_.push_back({.key = std::move(key), .value = std::string(), .tombstone = true});
+}
+
+void WriteBatch::clear()
+{
+    ops_.clear();
+    byte_size_ = 0;
+}
+
+} // namespace store
@@ -0,0 +1,145 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bulk_reader.hpp"
+#include "record.hpp"
+#include "store.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_bulk_reader_";
+
+struct Parsed
+{
+    std::string key;
+    std::string value;
+    bool tombstone;
+
+    bool operator==(const Parsed &other) const = default;
+};
+
+// every record of the input, or the error that stopped the reader
+static absl::StatusOr<std::vector<Parsed>> read_all(const std::string &input, store::BulkFormat format,
+                                                    std::size_t buffer_size)
+{
+    std::istringstream stream(input);
+    store::BulkReader reader(stream, format, buffer_size);
+    std::vector<Parsed> records;
+    store::BulkRecord record;
+    absl::Status status;
+    while ((status = reader.next(record)).ok())
+    {
+        records.push_back({std::string(record.key), std::string(record.value), record.tombstone});
+    }
+    if (status.code() != absl::StatusCode::kOutOfRange)
+    {
+        return status;
+    }
+    return records;
+}
+
+static std::string binary_record(std::string_view key, std::string_view value)
+{
+    std::string bytes(8, '\0');
+    record::store_le32(bytes.data(), static_cast<std::uint32_t>(key.size()));
+    record::store_le32(bytes.data() + 4, static_cast<std::uint32_t>(value.size()));
+    return bytes + std::string(key) + std::string(value);
+}
+
+TEST(BulkReader, Formats)
+{
+    // a tiny buffer refills and grows it in the middle of the records
+    for (std::size_t buffer_size : {std::size_t(4), store::BulkReader::DEFAULT_BUFFER_SIZE})
+    {
+        auto commands = read_all("# comment\nset a hello world\r\n\n  \nS b  x\nDEL a\nd b", store::BulkFormat::kCommands,
+                                 buffer_size);
+        ASSERT_TRUE(commands.ok()) << commands.status();
+        EXPECT_EQ(*commands, (std::vector<Parsed>{
+                                 {"a", "hello world", false}, {"b", "x", false}, {"a", "", true}, {"b", "", true}}));
+
+        auto tsv = read_all("k1\tv 1\nk\\t2\tline\\nbreak\\\\\nk3\t\n", store::BulkFormat::kTsv, buffer_size);
+        ASSERT_TRUE(tsv.ok()) << tsv.status();
+        EXPECT_EQ(*tsv, (std::vector<Parsed>{
+                            {"k1", "v 1", false}, {"k\t2", "line\nbreak\\", false}, {"k3", "", false}}));
+
+        std::string large(10000, 'v');
+        auto binary = read_all(binary_record("a", std::string("\n\0\t", 3)) + binary_record("b", large),
+                               store::BulkFormat::kBinary, buffer_size);
+        ASSERT_TRUE(binary.ok()) << binary.status();
+        EXPECT_EQ(*binary, (std::vector<Parsed>{{"a", std::string("\n\0\t", 3), false}, {"b", large, false}}));
+    }
+
+    EXPECT_EQ(store::parse_bulk_format("tsv").value(), store::BulkFormat::kTsv);
+    EXPECT_FALSE(store::parse_bulk_format("csv").ok());
+}
+
+TEST(BulkReader, Malformed)
+{
+    auto status_of = [](const std::string &input, store::BulkFormat format) {
+        return read_all(input, format, 4).status();
+    };
+
+    absl::Status status = status_of("a\tb\nno tab\n", store::BulkFormat::kTsv);
+    EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+    EXPECT_EQ(status.message(), "Line 2: Missing tab");
+    EXPECT_EQ(status_of("a\tb\\x\n", store::BulkFormat::kTsv).message(), "Line 1: Invalid escape");
+    EXPECT_EQ(status_of("a\tb\\", store::BulkFormat::kTsv).message(), "Line 1: Invalid escape");
+
+    EXPECT_EQ(status_of("get a\n", store::BulkFormat::kCommands).message(), "Line 1: Unsupported command: get");
+    EXPECT_EQ(status_of("set a\n", store::BulkFormat::kCommands).message(), "Line 1: Missing value");
+    EXPECT_EQ(status_of("del a b\n", store::BulkFormat::kCommands).message(), "Line 1: Unexpected value");
+    EXPECT_EQ(status_of("set\n", store::BulkFormat::kCommands).message(), "Line 1: Missing key");
+
+    std::string record = binary_record("key", "value");
+    EXPECT_EQ(status_of(record + record.substr(0, 5), store::BulkFormat::kBinary).message(),
+              "Offset 16: Truncated record");
+    EXPECT_EQ(status_of(record + record.substr(0, 12), store::BulkFormat::kBinary).message(),
+              "Offset 16: Truncated record");
+    std::string oversized(8, '\0');
+    record::store_le32(oversized.data(), 70000);
+    EXPECT_EQ(status_of(oversized, store::BulkFormat::kBinary).message(), "Offset 0: Key too large");
+}
+
+TEST(BulkReader, Load)
+{
+    const std::string path = base_path + "load";
+    fs::remove_all(path);
+    fs::create_directories(path);
+    store::Store store(path);
+    ASSERT_TRUE(store.load_keydir().ok());
+
+    // (1) 1000 sets and 100 deletes, committed in batches of about 1 KiB
+    std::string input;
+    for (int i = 0; i < 1000; i++)
+    {
+        input += "set key" + std::to_string(i) + " value " + std::to_string(i) + "\n";
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        input += "del key" + std::to_string(i) + "\n";
+    }
+    std::istringstream stream(input);
+    store::BulkReader reader(stream, store::BulkFormat::kCommands, 64);
+    absl::StatusOr<store::BulkStats> stats = store::bulk_load(store, reader, 1024);
+    ASSERT_TRUE(stats.ok()) << stats.status();
+    EXPECT_EQ(stats->records, 1100);
+    EXPECT_EQ(stats->bytes, input.size());
+    EXPECT_GT(stats->batches, 10);
+    EXPECT_LT(stats->batches, 1100);
+    EXPECT_EQ(store.kd_size(), 900);
+    EXPECT_EQ(store.get("key999").value(), "value 999");
+    EXPECT_FALSE(store.get("key0").ok());
+
+    // (2) the batches before a malformed record are kept, the rest is not
+    std::istringstream broken("set a 1\nset b 2\noops\nset c 3\n");
+    store::BulkReader broken_reader(broken, store::BulkFormat::kCommands);
+    stats = store::bulk_load(store, broken_reader, 1);
+    EXPECT_EQ(stats.status().code(), absl::StatusCode::kInvalidArgument);
+    EXPECT_EQ(store.get("b").value(), "2");
+    EXPECT_FALSE(store.get("c").ok());
+
+    fs::remove_all(path);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "compression.hpp"
+
+
+static std::string repetitive(int i)
+{
+    std::string value;
+    for (int j = 0; j < 20; j++)
+    {
+        value += "{\"user\": " + std::to_string(i) + ", \"event\": \"click\", \"page\": \"/home\"}";
+    }
+    return value;
+}
+
+TEST(Compressor, RoundTrip)
+{
+    for (store::Compression codec : {store::Compression::kNone, store::Compression::kLz4, store::Compression::kZstd})
+    {
+        absl::StatusOr<std::unique_ptr<store::Compressor>> compressor = store::Compressor::create(codec);
+        if (!store::Compressor::is_available(codec))
+        {
+            EXPECT_EQ(compressor.status().code(), absl::StatusCode::kFailedPrecondition);
+            continue;
+        }
+        ASSERT_TRUE(compressor.ok()) << compressor.status();
+
+        std::string value = repetitive(1);
+        std::string compressed;
+        store::Compression used = (*compressor)->compress(value, compressed);
+        EXPECT_EQ(used, codec);
+        if (used == store::Compression::kNone)
+        {
+            continue;
+        }
+        EXPECT_LT(compressed.size(), value.size());
+
+        std::string decompressed;
+        ASSERT_TRUE((*compressor)->decompress(used, compressed, decompressed).ok());
+        EXPECT_EQ(decompressed, value);
+
+        // values that don't shrink are left to be stored as they are
+        EXPECT_EQ((*compressor)->compress("x", compressed), store::Compression::kNone);
+
+        // any codec is decompressed, whatever the codec of the compressor
+        absl::StatusOr<std::unique_ptr<store::Compressor>> none =
+            store::Compressor::create(store::Compression::kNone);
+        ASSERT_TRUE(none.ok());
+        (*compressor)->compress(value, compressed);
+        decompressed.clear();
+        ASSERT_TRUE((*none)->decompress(used, compressed, decompressed).ok());
+        EXPECT_EQ(decompressed, value);
+
+        // a malformed value is reported
+        compressed.resize(compressed.size() / 2);
+        EXPECT_EQ((*compressor)->decompress(used, compressed, decompressed).code(), absl::StatusCode::kDataLoss);
+    }
+}
+
+TEST(Compressor, Dictionary)
+{
+    if (!store::Compressor::is_available(store::Compression::kZstd))
+    {
+        EXPECT_EQ(store::Compressor::train_dictionary({"a", "b"}, 1024).status().code(),
+                  absl::StatusCode::kFailedPrecondition);
+        GTEST_SKIP() << "Zstd not available";
+    }
+
+    std::vector<std::string> samples;
+    for (int i = 0; i < 500; i++)
+    {
+        samples.push_back(repetitive(i).substr(0, 60 + i % 40));
+    }
+    absl::StatusOr<std::string> dictionary = store::Compressor::train_dictionary(samples, 4096);
+    ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+
+    absl::StatusOr<std::unique_ptr<store::Compressor>> plain = store::Compressor::create(store::Compression::kZstd);
+    absl::StatusOr<std::unique_ptr<store::Compressor>> with_dictionary =
+        store::Compressor::create(store::Compression::kZstd, 0, *dictionary);
+    ASSERT_TRUE(plain.ok());
+    ASSERT_TRUE(with_dictionary.ok()) << with_dictionary.status();
+
+    // small values only shrink well with the dictionary
+    std::string value = repetitive(1000).substr(0, 80);
+    std::string compressed;
+    std::string plain_compressed;
+    ASSERT_EQ((*with_dictionary)->compress(value, compressed), store::Compression::kZstd);
+    if ((*plain)->compress(value, plain_compressed) == store::Compression::kZstd)
+    {
+        EXPECT_LT(compressed.size(), plain_compressed.size());
+    }
+
+    std::string decompressed;
+    ASSERT_TRUE((*with_dictionary)->decompress(store::Compression::kZstd, compressed, decompressed).ok());
+    EXPECT_EQ(decompressed, value);
+
+    // the value can't be read without its dictionary
+    EXPECT_EQ((*plain)->decompress(store::Compression::kZstd, compressed, decompressed).code(),
+              absl::StatusCode::kFailedPrecondition);
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "crc32c.hpp"
+
+
+TEST(Crc32c, KnownValues)
+{
+    // test vectors of RFC 3720, B.4
+    EXPECT_EQ(crc32c::value(std::string(32, '\x00')), 0x8A9136AA);
+    EXPECT_EQ(crc32c::value(std::string(32, '\xFF')), 0x62A8AB43);
+    EXPECT_EQ(crc32c::value("123456789"), 0xE3069283);
+    EXPECT_EQ(crc32c::value(""), 0);
+
+    std::string ascending;
+    for (int i = 0; i < 32; i++)
+    {
+        ascending.push_back(static_cast<char>(i));
+    }
+    EXPECT_EQ(crc32c::value(ascending), 0x46DD794E);
+}
+
+TEST(Crc32c, Extend)
+{
+    std::string data = "hello world, this is a longer string to cross a few words";
+    for (std::size_t split = 0; split <= data.size(); split++)
+    {
+        std::uint32_t crc = crc32c::extend(0, data.data(), split);
+        EXPECT_EQ(crc32c::extend(crc, data.data() + split, data.size() - split), crc32c::value(data));
+    }
+}
+
+TEST(Crc32c, PortableMatchesAccelerated)
+{
+    std::string data;
+    for (int i = 0; i < 1000; i++)
+    {
+        data.push_back(static_cast<char>(i * 31 + 7));
+    }
+
+    // every length and alignment, to go through the unaligned head and tail
+    for (std::size_t start = 0; start < 16; start++)
+    {
+        for (std::size_t n = 0; start + n <= 64; n++)
+        {
+            EXPECT_EQ(crc32c::extend_portable(0, data.data() + start, n), crc32c::extend(0, data.data() + start, n));
+        }
+    }
+    EXPECT_EQ(crc32c::extend_portable(0, data.data(), data.size()), crc32c::value(data));
+}
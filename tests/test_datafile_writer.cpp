@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <set>
+#include <thread>
+#include "datafile_writer.hpp"
+#include "file_util.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_datafile_writer_";
+
+class DatafileWriter : public ::testing::Test {
+protected:
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel
+        path_ = base_path + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
+    }
+};
+
+
+static std::string read_file(const fs::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+
+// content of a datafile after its file header
+static std::string read_records(const fs::path &path)
+{
+    std::string content = read_file(path);
+    EXPECT_TRUE(store::check_file_header(content, store::DATAFILE_MAGIC, path.string()).ok());
+    return content.substr(std::min(content.size(), store::FILE_HEADER_SIZE));
+}
+
+
+TEST_F(DatafileWriter, Append)
+{
+    fs::path path = fs::path(path_) / "datafile1";
+    auto writer = store::DatafileWriter::open(path, 1, store::SyncPolicy::kPerBatch);
+    ASSERT_TRUE(writer.ok());
+
+    std::uint64_t callback_offset = 0;
+    absl::StatusOr<std::uint64_t> offset = (*writer)->append("hello");
+    ASSERT_TRUE(offset.ok());
+    EXPECT_EQ(*offset, store::FILE_HEADER_SIZE);
+
+    offset = (*writer)->append("world", [&](std::uint64_t record_offset) { callback_offset = record_offset; });
+    ASSERT_TRUE(offset.ok());
+    EXPECT_EQ(*offset, store::FILE_HEADER_SIZE + 5);
+    EXPECT_EQ(callback_offset, store::FILE_HEADER_SIZE + 5);
+    EXPECT_EQ((*writer)->size(), store::FILE_HEADER_SIZE + 10);
+
+    // the records are visible to readers without closing the file
+    EXPECT_EQ(read_records(path), "helloworld");
+
+    ASSERT_TRUE((*writer)->close().ok());
+    EXPECT_FALSE((*writer)->append("!").ok());
+}
+
+
+TEST_F(DatafileWriter, AppendConcurrent)
+{
+    fs::path path = fs::path(path_) / "datafile1";
+    auto writer = store::DatafileWriter::open(path, 1, store::SyncPolicy::kPerBatch);
+    ASSERT_TRUE(writer.ok());
+
+    // 8 threads append 100 records of 8 bytes each, the records are written
+    // whole and each of them gets its own offset
+    const int n_threads = 8;
+    const int n_records = 100;
+    std::vector<std::vector<std::uint64_t>> offsets(n_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            std::string record = "thread-" + std::to_string(t);
+            for (int i = 0; i < n_records; i++)
+            {
+                absl::StatusOr<std::uint64_t> offset = (*writer)->append(record);
+                ASSERT_TRUE(offset.ok());
+                offsets[t].push_back(*offset);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ((*writer)->size(), store::FILE_HEADER_SIZE + n_threads * n_records * 8);
+    std::string content = read_file(path);
+    std::set<std::uint64_t> seen;
+    for (int t = 0; t < n_threads; t++)
+    {
+        for (std::uint64_t offset : offsets[t])
+        {
+            EXPECT_EQ(content.substr(offset, 8), "thread-" + std::to_string(t));
+            EXPECT_TRUE(seen.insert(offset).second);
+        }
+    }
+}
+
+
+TEST_F(DatafileWriter, Reopen)
+{
+    fs::path path = fs::path(path_) / "datafile1";
+    {
+        auto writer = store::DatafileWriter::open(path, 1, store::SyncPolicy::kInterval, std::chrono::milliseconds(1));
+        ASSERT_TRUE(writer.ok());
+        ASSERT_TRUE((*writer)->append("abc").ok());
+    }
+
+    // appends resume at the end of the existing file, the header is not
+    // written again
+    auto writer = store::DatafileWriter::open(path, 1);
+    ASSERT_TRUE(writer.ok());
+    EXPECT_EQ((*writer)->size(), store::FILE_HEADER_SIZE + 3);
+    absl::StatusOr<std::uint64_t> offset = (*writer)->append("def");
+    ASSERT_TRUE(offset.ok());
+    EXPECT_EQ(*offset, store::FILE_HEADER_SIZE + 3);
+    EXPECT_EQ(read_records(path), "abcdef");
+}
+
+
+TEST_F(DatafileWriter, AppendStream)
+{
+    fs::path path = fs::path(path_) / "datafile1";
+    auto writer = store::DatafileWriter::open(path, 1, store::SyncPolicy::kPerBatch);
+    ASSERT_TRUE(writer.ok());
+    ASSERT_TRUE((*writer)->append("head").ok());
+
+    // the pieces are written back to back, then the start is overwritten
+    std::vector<std::string> pieces = {"xxxx", "-abc", "-defg"};
+    std::size_t next_piece = 0;
+    store::DatafileWriter::PieceSource next = [&]() -> absl::StatusOr<std::string_view> {
+        return next_piece < pieces.size() ? std::string_view(pieces[next_piece++]) : std::string_view();
+    };
+    store::DatafileWriter::HeadCallback head = []() { return std::string_view("1234"); };
+    std::uint64_t callback_offset = 0;
+    absl::StatusOr<std::uint64_t> offset = (*writer)->append_stream(
+        13, next, head, [&](std::uint64_t record_offset) { callback_offset = record_offset; });
+    ASSERT_TRUE(offset.ok());
+    EXPECT_EQ(*offset, store::FILE_HEADER_SIZE + 4);
+    EXPECT_EQ(callback_offset, store::FILE_HEADER_SIZE + 4);
+    EXPECT_EQ(read_records(path), "head1234-abc-defg");
+
+    // pieces not adding up to the size, or a failing source, append nothing
+    next_piece = 0;
+    EXPECT_EQ((*writer)->append_stream(12, next, head).status().code(), absl::StatusCode::kInvalidArgument);
+    next_piece = 0;
+    EXPECT_EQ((*writer)->append_stream(14, next, head).status().code(), absl::StatusCode::kInvalidArgument);
+    store::DatafileWriter::PieceSource failing = [&]() -> absl::StatusOr<std::string_view> {
+        return absl::UnavailableError("source failed");
+    };
+    EXPECT_EQ((*writer)->append_stream(4, failing, head).status().code(), absl::StatusCode::kUnavailable);
+    EXPECT_EQ((*writer)->size(), store::FILE_HEADER_SIZE + 17);
+    EXPECT_EQ(read_records(path), "head1234-abc-defg");
+
+    offset = (*writer)->append("tail");
+    ASSERT_TRUE(offset.ok());
+    EXPECT_EQ(*offset, store::FILE_HEADER_SIZE + 17);
+    EXPECT_EQ(read_records(path), "head1234-abc-defgtail");
+}
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "executor.hpp"
+
+
+static store::Task<int> square(int x)
+{
+    co_return x * x;
+}
+
+static store::Task<int> sum_of_squares(int n)
+{
+    int sum = 0;
+    for (int i = 1; i <= n; i++)
+    {
+        sum += co_await square(i);
+    }
+    co_return sum;
+}
+
+// completes the operation from another thread, like the I/O engine
+static store::Task<std::string> echo(store::Executor &executor, std::string message)
+{
+    co_return co_await store::CallbackAwaiter<std::string>(executor, [&message](std::function<void(std::string)> done) {
+        std::thread([done, message]() { done(message); }).detach();
+    });
+}
+
+
+TEST(Executor, Run)
+{
+    store::Executor executor;
+    EXPECT_EQ(executor.run(sum_of_squares(10)), 385);
+    EXPECT_EQ(executor.run(echo(executor, "hello")), "hello");
+    EXPECT_EQ(executor.spawned(), 0);
+}
+
+TEST(Executor, ResumesOnDrivingThread)
+{
+    store::Executor executor;
+    std::thread::id driver = std::this_thread::get_id();
+    std::atomic<int> on_driver = 0;
+    auto worker = [&]() -> store::Task<void> {
+        for (int i = 0; i < 10; i++)
+        {
+            std::string echoed = co_await echo(executor, std::to_string(i));
+            EXPECT_EQ(echoed, std::to_string(i));
+            on_driver += std::this_thread::get_id() == driver;
+        }
+    };
+    executor.run(worker());
+    EXPECT_EQ(on_driver, 10);
+}
+
+TEST(Executor, SpawnAndPoll)
+{
+    // the wakeup callback stands for an event loop notification
+    std::atomic<int> wakeups = 0;
+    store::Executor executor([&wakeups]() { wakeups++; });
+    std::vector<std::string> results(20);
+    for (int i = 0; i < 20; i++)
+    {
+        executor.spawn([](store::Executor &executor, std::string &result, int i) -> store::Task<void> {
+            result = co_await echo(executor, "task" + std::to_string(i));
+        }(executor, results[i], i));
+    }
+    EXPECT_EQ(executor.spawned(), 20);
+    EXPECT_GE(wakeups, 1);
+
+    while (executor.spawned() > 0)
+    {
+        executor.poll();
+    }
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_EQ(results[i], "task" + std::to_string(i));
+    }
+    EXPECT_EQ(executor.poll(), 0);
+}
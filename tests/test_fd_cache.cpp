@@ -0,0 +1,107 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "fd_cache.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_fd_cache_";
+
+class FdCache : public ::testing::Test {
+protected:
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel
+        path_ = base_path + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
+    }
+};
+
+
+static fs::path write_file(const std::string &dir, store::fileid_t fileid, const std::string &content)
+{
+    fs::path path = fs::path(dir) / ("datafile" + std::to_string(fileid));
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    return path;
+}
+
+
+TEST_F(FdCache, Pread)
+{
+    fs::path path = write_file(path_, 1, "0123456789");
+    store::FdCache cache(4);
+
+    auto file = cache.get(1, path);
+    ASSERT_TRUE(file.ok());
+
+    char buf[4];
+    ASSERT_TRUE((*file)->pread(buf, 4, 3).ok());
+    EXPECT_EQ(std::string(buf, 4), "3456");
+
+    // reading past the end of the file
+    EXPECT_EQ((*file)->pread(buf, 4, 8).code(), absl::StatusCode::kOutOfRange);
+
+    // missing file
+    EXPECT_EQ(cache.get(2, fs::path(path_) / "datafile2").status().code(),
+              absl::StatusCode::kNotFound);
+}
+
+
+TEST_F(FdCache, Eviction)
+{
+    store::FdCache cache(2);
+    fs::path path1 = write_file(path_, 1, "a");
+    fs::path path2 = write_file(path_, 2, "b");
+    fs::path path3 = write_file(path_, 3, "c");
+
+    auto file1 = cache.get(1, path1);
+    ASSERT_TRUE(file1.ok());
+    ASSERT_TRUE(cache.get(2, path2).ok());
+    EXPECT_EQ(cache.size(), 2);
+
+    // the same descriptor is returned on a hit
+    EXPECT_EQ(cache.get(1, path1)->get(), file1->get());
+
+    // file 2 is the least recently used one
+    ASSERT_TRUE(cache.get(3, path3).ok());
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_NE(cache.get(1, path1)->get(), nullptr);
+
+    // an evicted descriptor stays usable by its holders
+    cache.evict(1);
+    EXPECT_EQ(cache.size(), 1);
+    char c;
+    ASSERT_TRUE((*file1)->pread(&c, 1, 0).ok());
+    EXPECT_EQ(c, 'a');
+}
+
+
+TEST_F(FdCache, Preadv)
+{
+    fs::path path = write_file(path_, 1, "0123456789");
+    auto file = store::ReadableFile::open(path, 1);
+    ASSERT_TRUE(file.ok());
+
+    // buffers are filled in order, empty ones are skipped
+    char a[2];
+    char b[3];
+    std::vector<iovec> iov = {{.iov_base = a, .iov_len = 2}, {.iov_base = nullptr, .iov_len = 0},
+                              {.iov_base = b, .iov_len = 3}};
+    ASSERT_TRUE((*file)->preadv(iov, 4).ok());
+    EXPECT_EQ(std::string(a, 2), "45");
+    EXPECT_EQ(std::string(b, 3), "678");
+
+    // reading past the end of the file
+    iov = {{.iov_base = a, .iov_len = 2}, {.iov_base = b, .iov_len = 3}};
+    EXPECT_EQ((*file)->preadv(iov, 7).code(), absl::StatusCode::kOutOfRange);
+}
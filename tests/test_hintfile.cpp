@@ -0,0 +1,72 @@
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include "hintfile.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_hintfile_";
+
+class HintFile : public ::testing::Test {
+protected:
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel
+        path_ = base_path + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
+    }
+};
+
+
+static std::vector<hintfile::Entry> read_all(const fs::path &path, absl::Status &status)
+{
+    std::vector<hintfile::Entry> entries;
+    status = hintfile::read(path, [&](const hintfile::Entry &entry) {
+        entries.push_back(entry);
+        return absl::OkStatus();
+    });
+    return entries;
+}
+
+
+TEST_F(HintFile, WriteAndRead)
+{
+    fs::path path = fs::path(path_) / "datafile1.hint";
+    std::vector<hintfile::Entry> expected = {
+        {.key = "a", .vsz = 1, .vpos = 0, .tombstone = false},
+        {.key = "bb", .vsz = 3, .vpos = 10, .tombstone = false, .flags = 0x08},
+        {.key = "a", .vsz = 20, .vpos = 5000000000, .tombstone = true},
+    };
+    ASSERT_TRUE(hintfile::write(path, expected).ok());
+
+    absl::Status status;
+    std::vector<hintfile::Entry> actual = read_all(path, status);
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(actual, expected);
+
+    EXPECT_EQ(hintfile::read(fs::path(path_) / "missing.hint",
+                             [](const hintfile::Entry &) { return absl::OkStatus(); })
+                  .code(),
+              absl::StatusCode::kNotFound);
+}
+
+
+TEST_F(HintFile, Truncated)
+{
+    fs::path path = fs::path(path_) / "datafile1.hint";
+    ASSERT_TRUE(hintfile::write(path, {{.key = "key", .vsz = 1, .vpos = 0, .tombstone = false}}).ok());
+    fs::resize_file(path, fs::file_size(path) - 1);
+
+    absl::Status status;
+    read_all(path, status);
+    EXPECT_EQ(status.code(), absl::StatusCode::kDataLoss);
+}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+#include <vector>
+#include "io_engine.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_io_engine_";
+
+class IoEngine : public ::testing::TestWithParam<store::IoBackend> {
+protected:
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel. The name of a parameterized test ends with /<index>.
+        std::string name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        std::replace(name.begin(), name.end(), '/', '_');
+        path_ = base_path + name;
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+    }
+
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
+    }
+};
+
+
+TEST_P(IoEngine, Read)
+{
+    fs::path path = fs::path(path_) / "datafile1";
+    std::string content;
+    for (int i = 0; i < 10000; i++)
+    {
+        content += static_cast<char>('a' + i % 26);
+    }
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << content;
+    }
+    auto file = store::ReadableFile::open(path, 1);
+    ASSERT_TRUE(file.ok());
+
+    // a queue shallower than the number of reads, the rest waits in the
+    // backlog
+    absl::StatusOr<std::unique_ptr<store::IoEngine>> engine = store::IoEngine::create(GetParam(), 8, 2);
+    if (engine.status().code() == absl::StatusCode::kUnavailable)
+    {
+        GTEST_SKIP() << engine.status().message();
+    }
+    ASSERT_TRUE(engine.ok());
+    EXPECT_EQ((*engine)->backend(), GetParam());
+
+    // an engine without reads in flight stops right away
+    ASSERT_TRUE(store::IoEngine::create(GetParam(), 1, 1).ok());
+
+    const int n_reads = 500;
+    std::vector<std::string> buffers(n_reads, std::string(7, '\0'));
+    std::vector<std::promise<absl::Status>> done(n_reads);
+    for (int i = 0; i < n_reads; i++)
+    {
+        (*engine)->read(*file, buffers[i].data(), 7, i * 13,
+                        [&done, i](absl::Status status) { done[i].set_value(status); });
+    }
+    for (int i = 0; i < n_reads; i++)
+    {
+        ASSERT_TRUE(done[i].get_future().get().ok());
+        EXPECT_EQ(buffers[i], content.substr(i * 13, 7));
+    }
+
+    // reading past the end of the file
+    std::promise<absl::Status> past_end;
+    char buf[8];
+    (*engine)->read(*file, buf, 8, content.size() - 4, [&past_end](absl::Status status) { past_end.set_value(status); });
+    EXPECT_EQ(past_end.get_future().get().code(), absl::StatusCode::kOutOfRange);
+
+    // the destructor waits for the reads and the tasks
+    std::atomic<int> completed = 0;
+    for (int i = 0; i < 50; i++)
+    {
+        (*engine)->read(*file, buffers[i].data(), 7, 0, [&completed](absl::Status) { completed++; });
+        (*engine)->run([&completed]() { completed++; });
+    }
+    engine->reset();
+    EXPECT_EQ(completed, 100);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoEngine,
+                         ::testing::Values(store::IoBackend::kIoUring, store::IoBackend::kThreadPool));
@@ -1,5 +1,7 @@
 #include <filesystem>
 #include <gtest/gtest.h>
+#include <thread>
+#include "file_util.hpp"
 #include "store.hpp"
 
 
@@ -15,36 +17,29 @@ store::Store::kd_get, store::Store::kd_size, etc.)
 namespace fs = std::filesystem;
 
 static const std::string base_path = "./tests/test_keydir_";
-static const std::string paths[] = {
-    "simple_entry",
-    "set_different_value_size",
-    "set_and_get_multiple",
-    "update",
-    "delete",
-    "delete_unexisting",
-};
 
 class KeyDir : public ::testing::Test {
 protected:
-    static void SetUpTestCase() {
-        // Create directories
-        for (const std::string &path : paths) {
-            fs::create_directories(base_path + path);
-        }
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel
+        path_ = base_path + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(path_);
+        fs::create_directories(path_);
     }
 
-    static void TearDownTestCase() {
-        // Remove directories
-        for (const std::string &path : paths) {
-            fs::remove_all(base_path + path);
-        }
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
     }
 };
 
 TEST_F(KeyDir, SimpleEntry)
 {
-    store::Store store(base_path + paths[0]);
-    keydir::Entry expected_entry = {.fileid = 1, .vsz = 1, .vpos = 0};
+    store::Store store(path_);
+    keydir::Entry expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE};
 
     absl::Status status = store.set("a", "1");
     ASSERT_TRUE(status.ok());
@@ -71,12 +66,12 @@ TEST_F(KeyDir, GetNonExistentKey)
 
 TEST_F(KeyDir, SetDifferentValueSize)
 {
-    store::Store store(base_path + paths[1]);
+    store::Store store(path_);
     keydir::Entry actual_entry, expected_entry;
     absl::Status status;
 
     // Set a key with a size of 2
-    expected_entry = {.fileid = 1, .vsz = 2, .vpos = 0};
+    expected_entry = {.fileid = 1, .vsz = 2, .vpos = store::FILE_HEADER_SIZE};
     status = store.set("a", "11");
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store.kd_size(), 1);
@@ -90,7 +85,7 @@ TEST_F(KeyDir, SetDifferentValueSize)
 
 TEST_F(KeyDir, SetAndGetMultiple)
 {
-    store::Store store(base_path + paths[2]);
+    store::Store store(path_);
     keydir::Entry expected_entry;
     absl::Status status;
 
@@ -104,7 +99,7 @@ TEST_F(KeyDir, SetAndGetMultiple)
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store.kd_size(), 2);
 
-    expected_entry = {.fileid = 1, .vsz = 1, .vpos = 0};
+    expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE};
     keydir::Entry actual_entry = store.kd_get("a").value();
     EXPECT_EQ(typeid(actual_entry), typeid(keydir::Entry));
 
@@ -112,7 +107,7 @@ TEST_F(KeyDir, SetAndGetMultiple)
     EXPECT_EQ(actual_entry.vsz, expected_entry.vsz);
     EXPECT_EQ(actual_entry.vpos, expected_entry.vpos);
 
-    expected_entry = {.fileid = 1, .vsz = 1, .vpos = 10};
+    expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE + 17};
     actual_entry = store.kd_get("b").value();
     EXPECT_EQ(actual_entry.fileid, expected_entry.fileid);
     EXPECT_EQ(actual_entry.vsz, expected_entry.vsz);
@@ -122,7 +117,7 @@ TEST_F(KeyDir, SetAndGetMultiple)
 
 TEST_F(KeyDir, Update)
 {
-    store::Store store(base_path + paths[3]);
+    store::Store store(path_);
     absl::Status status;
     keydir::Entry actual_entry, expected_entry;
 
@@ -131,7 +126,7 @@ TEST_F(KeyDir, Update)
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store.kd_size(), 1);
 
-    expected_entry = {.fileid = 1, .vsz = 1, .vpos = 0};
+    expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE};
     actual_entry = store.kd_get("a").value();
     EXPECT_EQ(typeid(actual_entry), typeid(keydir::Entry));
     EXPECT_EQ(actual_entry, expected_entry);
@@ -141,7 +136,7 @@ TEST_F(KeyDir, Update)
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store.kd_size(), 1);
 
-    expected_entry = {.fileid = 1, .vsz = 3, .vpos = 10};
+    expected_entry = {.fileid = 1, .vsz = 3, .vpos = store::FILE_HEADER_SIZE + 17};
     actual_entry = store.kd_get("a").value();
     EXPECT_EQ(typeid(actual_entry), typeid(keydir::Entry));
     EXPECT_EQ(actual_entry, expected_entry);
@@ -150,19 +145,19 @@ TEST_F(KeyDir, Update)
 
 TEST_F(KeyDir, Delete)
 {
-    store::Store store(base_path + paths[4]);
+    store::Store store(path_);
     absl::Status status;
     keydir::Entry actual_entry, expected_entry;
 
     status = store.set("a", "1");
     ASSERT_TRUE(status.ok());
-    expected_entry = {.fileid = 1, .vsz = 1, .vpos = 0};
+    expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE};
     actual_entry = store.kd_get("a").value();
     EXPECT_EQ(actual_entry, expected_entry);
 
     status = store.set("b", "2");
     ASSERT_TRUE(status.ok());
-    expected_entry = {.fileid = 1, .vsz = 1, .vpos = 10};
+    expected_entry = {.fileid = 1, .vsz = 1, .vpos = store::FILE_HEADER_SIZE + 17};
     actual_entry = store.kd_get("b").value();
     EXPECT_EQ(actual_entry, expected_entry);
 
@@ -180,9 +175,197 @@ TEST_F(KeyDir, Delete)
 
 TEST_F(KeyDir, DeleteUnexisting)
 {
-    store::Store store(base_path + paths[5]);
+    store::Store store(path_);
     absl::Status status;
 
     status = store.del("b");
     EXPECT_EQ(status.code(), absl::StatusCode::kNotFound);
 }
+
+
+TEST_F(KeyDir, Shards)
+{
+    EXPECT_EQ(keydir::KeyDir().shard_count(), keydir::KeyDir::DEFAULT_SHARDS);
+    EXPECT_EQ(keydir::KeyDir(1).shard_count(), 1);
+    EXPECT_EQ(keydir::KeyDir(5).shard_count(), 8);
+
+    keydir::KeyDir kd(4);
+    for (std::uint64_t i = 0; i < 100; i++)
+    {
+        ASSERT_TRUE(kd.set("key" + std::to_string(i), {.fileid = 1, .vsz = 1, .vpos = i}).ok());
+    }
+    EXPECT_EQ(kd.size(), 100);
+    EXPECT_EQ(kd.keys().size(), 100);
+    EXPECT_EQ(kd.get("key42").value().vpos, 42);
+}
+
+
+TEST_F(KeyDir, Apply)
+{
+    keydir::KeyDir kd(4);
+    ASSERT_TRUE(kd.set("a", {.fileid = 1, .vsz = 1, .vpos = 0}).ok());
+    ASSERT_TRUE(kd.set("b", {.fileid = 1, .vsz = 1, .vpos = 11}).ok());
+
+    // updates spanning several shards, applied in order
+    std::vector<keydir::KeyDir::Update> updates = {
+        {.key = "a", .entry = {.fileid = 2, .vsz = 1, .vpos = 0}, .remove = false},
+        {.key = "b", .entry = {}, .remove = true},
+        {.key = "c", .entry = {.fileid = 2, .vsz = 1, .vpos = 11}, .remove = false},
+        {.key = "c", .entry = {.fileid = 2, .vsz = 2, .vpos = 22}, .remove = false},
+        {.key = "unexisting", .entry = {}, .remove = true},
+    };
+    kd.apply(updates);
+    EXPECT_EQ(kd.size(), 2);
+    EXPECT_EQ(kd.get("a").value().fileid, 2);
+    EXPECT_FALSE(kd.contains("b"));
+    EXPECT_EQ(kd.get("c").value().vpos, 22);
+}
+
+
+TEST_F(KeyDir, ConcurrentAccess)
+{
+    keydir::KeyDir kd;
+    const int n_threads = 4;
+    const std::uint64_t n_keys = 1000;
+
+    // each writer owns a range of keys, readers check that an entry is
+    // never seen half updated
+    std::vector<std::thread> threads;
+    for (int t = 0; t < n_threads; t++)
+    {
+        threads.emplace_back([&kd, t]() {
+            for (std::uint64_t i = 0; i < n_keys; i++)
+            {
+                std::string key = std::to_string(t) + "-" + std::to_string(i);
+                ASSERT_TRUE(kd.set(key, {.fileid = static_cast<fileid_t>(t), .vsz = 1, .vpos = i}).ok());
+                if (i % 2 == 0)
+                {
+                    ASSERT_TRUE(kd.del(key).ok());
+                }
+            }
+        });
+        threads.emplace_back([&kd, t]() {
+            for (std::uint64_t i = 0; i < n_keys; i++)
+            {
+                absl::StatusOr<keydir::Entry> entry = kd.get(std::to_string(t) + "-" + std::to_string(i));
+                if (entry.ok())
+                {
+                    EXPECT_EQ(entry->vpos, i);
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(kd.size(), n_threads * n_keys / 2);
+    EXPECT_FALSE(kd.contains("0-0"));
+    EXPECT_EQ(kd.get("3-999").value(), (keydir::Entry{.fileid = 3, .vsz = 1, .vpos = 999}));
+}
+
+
+TEST_F(KeyDir, Memory)
+{
+    keydir::KeyDir kd(1);
+    const std::uint64_t n_keys = 20000;
+    for (std::uint64_t i = 0; i < n_keys; i++)
+    {
+        ASSERT_TRUE(kd.set("key" + std::to_string(i), {.fileid = 1, .vsz = 1, .vpos = i}).ok());
+    }
+
+    // keys of a few bytes cost the table slot and the key bytes, far less
+    // than a heap allocated node per key
+    keydir::Stats stats = kd.stats();
+    EXPECT_EQ(stats.keys, n_keys);
+    EXPECT_GT(stats.arena_bytes, 0);
+    EXPECT_LT(stats.bytes_per_key(), 96);
+
+    // lookups take views, the arena keeps the keys alive
+    std::string key = "key42";
+    EXPECT_EQ(kd.get(std::string_view(key)).value().vpos, 42);
+
+    // deleting most keys compacts the arena
+    std::size_t arena_bytes = stats.arena_bytes;
+    for (std::uint64_t i = 0; i < n_keys; i++)
+    {
+        if (i % 10 != 0)
+        {
+            ASSERT_TRUE(kd.del("key" + std::to_string(i)).ok());
+        }
+    }
+    stats = kd.stats();
+    EXPECT_EQ(stats.keys, n_keys / 10);
+    EXPECT_LT(stats.arena_bytes + stats.dead_bytes, arena_bytes);
+    for (std::uint64_t i = 0; i < n_keys; i += 10)
+    {
+        EXPECT_EQ(kd.get("key" + std::to_string(i)).value().vpos, i);
+    }
+
+    // keys larger than an arena block
+    std::string large(100000, 'k');
+    ASSERT_TRUE(kd.set(large, {.fileid = 2, .vsz = 1, .vpos = 0}).ok());
+    ASSERT_TRUE(kd.set("small", {.fileid = 2, .vsz = 1, .vpos = 1}).ok());
+    EXPECT_EQ(kd.get(large).value().fileid, 2);
+    EXPECT_EQ(kd.get("small").value().vpos, 1);
+}
+
+
+TEST_F(KeyDir, Expiry)
+{
+    keydir::KeyDir kd(4);
+    for (std::uint32_t i = 0; i < 100; i++)
+    {
+        // keys without an expiry never expire
+        keydir::Entry entry{.fileid = 1, .vsz = 1, .vpos = i, .expiry = i % 2 == 0 ? 0 : i};
+        ASSERT_TRUE(kd.set("key" + std::to_string(i), entry).ok());
+    }
+
+    EXPECT_EQ(kd.erase_expired(50), 25);
+    EXPECT_EQ(kd.size(), 75);
+    EXPECT_FALSE(kd.contains("key49"));
+    EXPECT_TRUE(kd.contains("key51"));
+    EXPECT_TRUE(kd.contains("key98"));
+    EXPECT_EQ(kd.erase_expired(50), 0);
+
+    // only deleted if the entry is still the expected one
+    keydir::Entry entry = kd.get("key51").value();
+    EXPECT_FALSE(kd.erase_if("key51", {.fileid = 2, .vsz = 1, .vpos = 51, .expiry = 51}));
+    EXPECT_FALSE(kd.erase_if("key49", entry));
+    EXPECT_TRUE(kd.erase_if("key51", entry));
+    EXPECT_FALSE(kd.contains("key51"));
+    EXPECT_EQ(kd.size(), 74);
+}
+
+
+TEST_F(KeyDir, Range)
+{
+    keydir::KeyDir unordered;
+    EXPECT_EQ(unordered.range("", "", 0, 0).status().code(), absl::StatusCode::kFailedPrecondition);
+
+    keydir::KeyDir kd(4, true);
+    ASSERT_TRUE(kd.ordered());
+    for (std::uint64_t i = 0; i < 20; i++)
+    {
+        std::string key = (i < 10 ? "key0" : "key") + std::to_string(i);
+        ASSERT_TRUE(kd.set(key, {.fileid = 1, .vsz = 1, .vpos = i}).ok());
+    }
+    ASSERT_TRUE(kd.del("key05").ok());
+    EXPECT_TRUE(kd.erase_if("key06", kd.get("key06").value()));
+    kd.apply({{.key = "key07", .entry = {}, .remove = true},
+              {.key = "a", .entry = {.fileid = 1, .vsz = 1, .vpos = 0}, .remove = false}});
+    ASSERT_TRUE(kd.set("key08", {.fileid = 1, .vsz = 1, .vpos = 8, .expiry = 10}).ok());
+
+    EXPECT_EQ(kd.range("key03", "key10", 0, 5).value(),
+              (std::vector<std::string>{"key03", "key04", "key08", "key09"}));
+    EXPECT_EQ(kd.range("key03", "key10", 0, 10).value(), (std::vector<std::string>{"key03", "key04", "key09"}));
+    EXPECT_EQ(kd.range("", "", 2, 0).value(), (std::vector<std::string>{"a", "key00"}));
+    EXPECT_EQ(kd.range("key19", "", 0, 0).value(), (std::vector<std::string>{"key19"}));
+    EXPECT_EQ(kd.range("z", "", 0, 0).value(), std::vector<std::string>());
+
+    // the expired keys leave the index with the keydir
+    EXPECT_EQ(kd.erase_expired(10), 1);
+    EXPECT_EQ(kd.range("key08", "key09", 0, 0).value(), std::vector<std::string>());
+    EXPECT_EQ(kd.range("", "", 0, 0).value().size(), kd.size());
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "crc32c.hpp"
+#include "record.hpp"
+
+
+TEST(Record, Layout)
+{
+    std::string buffer;
+    record::append(buffer, "ab", "xyz", 0x03);
+
+    // little-endian timestamp and sizes, then the flags, the key and the value
+    ASSERT_EQ(buffer.size(), record::HEADER_SIZE + 5);
+    EXPECT_EQ(buffer.substr(4), std::string("\x00\x00\x00\x00\x02\x00\x03\x00\x00\x00\x03" "abxyz", 16));
+
+    buffer.clear();
+    record::append(buffer, "ab", "xyz", 0, 0x01020304);
+    EXPECT_EQ(buffer.substr(4, 4), "\x04\x03\x02\x01");
+    std::uint32_t crc = crc32c::value(std::string_view(buffer).substr(4));
+    EXPECT_EQ(buffer.substr(0, 4), std::string({static_cast<char>(crc), static_cast<char>(crc >> 8),
+                                                static_cast<char>(crc >> 16), static_cast<char>(crc >> 24)}));
+}
+
+TEST(Record, Parse)
+{
+    std::string buffer;
+    record::append(buffer, "key1", "value1");
+    record::append(buffer, "k2", "", 0x01);
+
+    record::View view;
+    ASSERT_EQ(record::parse(buffer, view), record::ParseResult::kOk);
+    EXPECT_EQ(view.key, "key1");
+    EXPECT_EQ(view.value, "value1");
+    EXPECT_EQ(view.header.flags, 0);
+    EXPECT_EQ(view.key.data(), buffer.data() + record::HEADER_SIZE); // parsed in place
+
+    std::string_view rest = std::string_view(buffer).substr(view.size());
+    ASSERT_EQ(record::parse(rest, view), record::ParseResult::kOk);
+    EXPECT_EQ(view.key, "k2");
+    EXPECT_EQ(view.value, "");
+    EXPECT_EQ(view.header.flags, 0x01);
+    EXPECT_EQ(view.header.timestamp, 0);
+
+    // the header is available as soon as it is complete
+    EXPECT_EQ(record::parse(std::string_view(buffer).substr(0, 3), view), record::ParseResult::kTruncated);
+    EXPECT_EQ(record::parse(std::string_view(buffer).substr(0, 18), view), record::ParseResult::kTruncated);
+    EXPECT_EQ(view.header.ksz, 4);
+    EXPECT_EQ(view.header.vsz, 6);
+
+    buffer[record::HEADER_SIZE] ^= 1;
+    EXPECT_EQ(record::parse(buffer, view), record::ParseResult::kCorrupted);
+}
+
+TEST(Record, ReusedBufferDoesNotGrow)
+{
+    std::string buffer;
+    record::append(buffer, std::string(100, 'k'), std::string(1000, 'v'));
+    std::size_t capacity = buffer.capacity();
+    const char *data = buffer.data();
+
+    for (int i = 0; i < 10; i++)
+    {
+        buffer.clear();
+        record::append(buffer, "key" + std::to_string(i), "value");
+        EXPECT_EQ(buffer.capacity(), capacity);
+        EXPECT_EQ(buffer.data(), data);
+    }
+}
+
+TEST(Record, LittleEndianHelpers)
+{
+    char bytes[8];
+    record::store_le64(bytes, 0x0102030405060708ULL);
+    EXPECT_EQ(std::string(bytes, 8), "\x08\x07\x06\x05\x04\x03\x02\x01");
+    EXPECT_EQ(record::load_le64(bytes), 0x0102030405060708ULL);
+    EXPECT_EQ(record::load_le32(bytes), 0x05060708U);
+    EXPECT_EQ(record::load_le16(bytes), 0x0708);
+
+    record::store_le16(bytes, 0xFFFE);
+    EXPECT_EQ(record::load_le16(bytes), 0xFFFE);
+}
@@ -0,0 +1,238 @@
+#include <arpa/inet.h>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "resp.hpp"
+#include "server.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_resp_";
+
+TEST(Resp, Parse)
+{
+    std::vector<std::string_view> args;
+    std::size_t consumed = 0;
+    std::string error;
+
+    // two pipelined commands, one of them with a binary value
+    std::string bytes = std::string("*3\r\n$3\r\nSET\r\n$1\r\na\r\n$4\r\n\r\n\0x\r\n", 30) +
+                        "*2\r\n$3\r\nGET\r\n$1\r\na\r\n";
+    ASSERT_EQ(resp::parse(bytes, args, consumed, error), resp::ParseResult::kOk);
+    EXPECT_EQ(args, (std::vector<std::string_view>{"SET", "a", std::string_view("\r\n\0x", 4)}));
+    EXPECT_EQ(consumed, 30);
+    ASSERT_EQ(resp::parse(std::string_view(bytes).substr(consumed), args, consumed, error), resp::ParseResult::kOk);
+    EXPECT_EQ(args, (std::vector<std::string_view>{"GET", "a"}));
+
+    // any prefix of a command is incomplete
+    for (std::size_t size = 0; size < 30; size++)
+    {
+        EXPECT_EQ(resp::parse(std::string_view(bytes).substr(0, size), args, consumed, error),
+                  resp::ParseResult::kIncomplete)
+            << size;
+    }
+
+    // inline commands
+    ASSERT_EQ(resp::parse("  PING  hello\r\nGET", args, consumed, error), resp::ParseResult::kOk);
+    EXPECT_EQ(args, (std::vector<std::string_view>{"PING", "hello"}));
+    EXPECT_EQ(consumed, 15);
+    ASSERT_EQ(resp::parse("\n", args, consumed, error), resp::ParseResult::kOk);
+    EXPECT_TRUE(args.empty());
+
+    // malformed commands
+    EXPECT_EQ(resp::parse("*1\r\n+OK\r\n", args, consumed, error), resp::ParseResult::kError);
+    EXPECT_EQ(resp::parse("*x\r\n", args, consumed, error), resp::ParseResult::kError);
+    EXPECT_EQ(resp::parse("*1\r\n$-2\r\n", args, consumed, error), resp::ParseResult::kError);
+    EXPECT_EQ(resp::parse("*1\r\n$1\r\nab\r\n", args, consumed, error), resp::ParseResult::kError);
+    EXPECT_EQ(resp::parse(std::string(resp::MAX_INLINE_SIZE + 1, 'a'), args, consumed, error),
+              resp::ParseResult::kError);
+}
+
+TEST(Resp, Replies)
+{
+    std::string out;
+    resp::append_simple(out, "OK");
+    resp::append_error(out, "ERR no");
+    resp::append_integer(out, -3);
+    resp::append_bulk(out, "ab");
+    resp::append_null(out);
+    resp::append_array(out, 2);
+    EXPECT_EQ(out, "+OK\r\n-ERR no\r\n:-3\r\n$2\r\nab\r\n$-1\r\n*2\r\n");
+}
+
+TEST(Resp, GlobMatch)
+{
+    EXPECT_TRUE(store::glob_match("*", ""));
+    EXPECT_TRUE(store::glob_match("user:*", "user:42"));
+    EXPECT_TRUE(store::glob_match("user:*:name", "user:4:2:name"));
+    EXPECT_TRUE(store::glob_match("?ey", "key"));
+    EXPECT_TRUE(store::glob_match("a\\*b", "a*b"));
+    EXPECT_FALSE(store::glob_match("a\\*b", "axb"));
+    EXPECT_FALSE(store::glob_match("user:*:name", "user:42"));
+    EXPECT_FALSE(store::glob_match("?", ""));
+}
+
+// the reply is *2, the cursor as a bulk string and an array of bulk strings,
+// read as an array of one bulk string followed by an array
+static void parse_scan_reply(std::string_view output, std::string &cursor, std::vector<std::string> &keys)
+{
+    ASSERT_EQ(output.substr(0, 4), "*2\r\n");
+    std::string bytes = "*1\r\n" + std::string(output.substr(4));
+    std::vector<std::string_view> args;
+    std::size_t consumed = 0;
+    std::string error;
+    ASSERT_EQ(resp::parse(bytes, args, consumed, error), resp::ParseResult::kOk);
+    cursor = std::string(args[0]);
+    ASSERT_EQ(resp::parse(std::string_view(bytes).substr(consumed), args, consumed, error), resp::ParseResult::kOk);
+    keys.insert(keys.end(), args.begin(), args.end());
+}
+
+TEST(Resp, Session)
+{
+    const std::string path = base_path + "session";
+    fs::remove_all(path);
+    fs::create_directories(path);
+    store::Options options;
+    options.ordered_index = true;
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    store::Session session(store);
+
+    // (1) pipelined commands, fed in pieces, are replied to in order
+    std::string commands = "*3\r\n$3\r\nSET\r\n$1\r\na\r\n$1\r\n1\r\n"
+                           "*3\r\n$3\r\nset\r\n$1\r\nb\r\n$1\r\n2\r\n"
+                           "*2\r\n$3\r\nGET\r\n$1\r\na\r\n"
+                           "*3\r\n$4\r\nMGET\r\n$1\r\nb\r\n$1\r\nc\r\n"
+                           "*3\r\n$3\r\nDEL\r\n$1\r\na\r\n$1\r\nc\r\n"
+                           "GET a\r\n";
+    for (std::size_t i = 0; i < commands.size(); i += 7)
+    {
+        session.feed(std::string_view(commands).substr(i, 7));
+    }
+    EXPECT_EQ(session.output(), "+OK\r\n+OK\r\n$1\r\n1\r\n*2\r\n$1\r\n2\r\n$-1\r\n:1\r\n$-1\r\n");
+    session.consume_output(session.output().size());
+
+    // (2) expiring keys and errors
+    session.feed("SET t v EX 100\r\nSET t v EX 0\r\nSET t v NX\r\nGET\r\nNOPE\r\nPING\r\n");
+    EXPECT_EQ(session.output(), "+OK\r\n-ERR invalid expire time in 'set' command\r\n-ERR syntax error\r\n"
+                                "-ERR wrong number of arguments for 'get' command\r\n"
+                                "-ERR unknown command 'NOPE'\r\n+PONG\r\n");
+    EXPECT_NE(store.kd_get("t").value().expiry, 0);
+    session.consume_output(session.output().size());
+
+    // (3) SCAN pages through the keys in order, MATCH filters them
+    for (int i = 0; i < 25; i++)
+    {
+        ASSERT_TRUE(store.set("user:" + std::to_string(100 + i), "x").ok());
+    }
+    std::vector<std::string> keys;
+    std::string cursor = "0";
+    int pages = 0;
+    do
+    {
+        session.feed("SCAN " + cursor + " MATCH user:1?? COUNT 10\r\n");
+        parse_scan_reply(session.output(), cursor, keys);
+        session.consume_output(session.output().size());
+        pages++;
+    } while (cursor != "0");
+    EXPECT_EQ(pages, 3);
+    ASSERT_EQ(keys.size(), 25);
+    EXPECT_EQ(keys.front(), "user:100");
+    EXPECT_EQ(keys.back(), "user:124");
+
+    session.feed("SCAN 12345\r\n");
+    EXPECT_EQ(session.output(), "-ERR invalid cursor\r\n");
+    session.consume_output(session.output().size());
+
+    // (4) QUIT and protocol errors end the session
+    session.feed("QUIT\r\nPING\r\n");
+    EXPECT_EQ(session.output(), "+OK\r\n");
+    EXPECT_TRUE(session.closing());
+    store::Session broken(store);
+    broken.feed("*1\r\n:1\r\nPING\r\n");
+    EXPECT_TRUE(broken.closing());
+    EXPECT_EQ(broken.output().substr(0, 4), "-ERR");
+
+    fs::remove_all(path);
+}
+
+TEST(Resp, Server)
+{
+    const std::string path = base_path + "server";
+    fs::remove_all(path);
+    fs::create_directories(path);
+    store::Store store(path);
+    ASSERT_TRUE(store.load_keydir().ok());
+
+    store::ServerOptions options;
+    options.port = 0;
+    options.threads = 2;
+    absl::StatusOr<std::unique_ptr<store::Server>> server = store::Server::start(store, options);
+    ASSERT_TRUE(server.ok()) << server.status();
+    ASSERT_NE((*server)->port(), 0);
+
+    auto connect_client = [&]() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((*server)->port());
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        EXPECT_EQ(::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)), 0);
+        return fd;
+    };
+    auto read_reply = [](int fd, std::size_t size) {
+        std::string reply;
+        char buffer[4096];
+        while (reply.size() < size)
+        {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n <= 0)
+            {
+                break;
+            }
+            reply.append(buffer, static_cast<std::size_t>(n));
+        }
+        return reply;
+    };
+
+    // a pipeline of 1000 SETs and a GET from each of two clients
+    std::vector<int> clients = {connect_client(), connect_client()};
+    for (std::size_t c = 0; c < clients.size(); c++)
+    {
+        std::string pipeline;
+        for (int i = 0; i < 1000; i++)
+        {
+            pipeline += "SET key" + std::to_string(c) + "-" + std::to_string(i) + " " + std::to_string(i) + "\r\n";
+        }
+        pipeline += "GET key" + std::to_string(c) + "-999\r\n";
+        ASSERT_EQ(::write(clients[c], pipeline.data(), pipeline.size()), static_cast<ssize_t>(pipeline.size()));
+    }
+    std::string expected;
+    for (int i = 0; i < 1000; i++)
+    {
+        expected += "+OK\r\n";
+    }
+    expected += "$3\r\n999\r\n";
+    for (int fd : clients)
+    {
+        EXPECT_EQ(read_reply(fd, expected.size()), expected);
+    }
+    EXPECT_EQ(store.kd_size(), 2000);
+
+    // QUIT closes the connection once replied to
+    ASSERT_EQ(::write(clients[0], "QUIT\r\n", 6), 6);
+    EXPECT_EQ(read_reply(clients[0], 100), "+OK\r\n");
+    for (int fd : clients)
+    {
+        ::close(fd);
+    }
+    EXPECT_GE((*server)->stats().commands.load(), 2003);
+    (*server)->stop();
+
+    fs::remove_all(path);
+}
@@ -1,34 +1,35 @@
+#include <chrono>
+#include <ctime>
 #include <filesystem>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <thread>
+#include <tuple>
+#include "file_util.hpp"
 #include "store.hpp"
 
 
 namespace fs = std::filesystem;
 
 static const std::string base_path = "./tests/test_store_";
-static const std::string paths[] = {
-    "set",
-    "set_multiple",
-    "get",
-    "load_keydir",
-    "del",
-    "load_keydir_with_tombstone",
-};
 
 class Store : public ::testing::Test {
 protected:
-    static void SetUpTestCase() {
-        // Create directories
-        for (const std::string &path : paths) {
-            fs::create_directories(base_path + path);
-        }
+    std::string path_;
+
+    void SetUp() override {
+        // Each test gets its own directory, so that the tests can run in
+        // parallel
+        path_ = base_path + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(path_);
+        fs::create_directories(path_);
     }
 
-    static void TearDownTestCase() {
-        // Remove directories
-        for (const std::string &path : paths) {
-            fs::remove_all(base_path + path);
-        }
+    void TearDown() override {
+        // Remove the directory
+        fs::remove_all(path_);
     }
 };
 
@@ -57,7 +58,7 @@ TEST(StoreConstructor, Default)
 
 TEST_F(Store, Set)
 {
-    store::Store store(base_path + paths[0]);
+    store::Store store(path_);
     absl::Status status;
 
     status = store.set("a", "1");
@@ -65,13 +66,13 @@ TEST_F(Store, Set)
 
     EXPECT_EQ(store.kd_size(), 1);
     EXPECT_EQ(store.active_fileid(), 1);
-    EXPECT_EQ(store.active_file_offset(), 10); // 10 = size of 0000-01-01-a-1
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 17); // 17 = size of 0000-0000-01-0001-00-a-1
 }
 
 
 TEST_F(Store, SetMultiple)
 {
-    store::Store store(base_path + paths[1]);
+    store::Store store(path_);
     absl::Status status;
 
     status = store.set("a", "1");
@@ -81,13 +82,13 @@ TEST_F(Store, SetMultiple)
 
     EXPECT_EQ(store.kd_size(), 2);
     EXPECT_EQ(store.active_fileid(), 1);
-    EXPECT_EQ(store.active_file_offset(), 20); // 20 = size of 0000-01-01-a-1-0000-01-01-b-2
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 34); // 34 = size of 0000-0000-01-0001-00-a-1-0000-0000-01-0001-00-b-2
 }
 
 
 TEST_F(Store, Get)
 {
-    store::Store store(base_path + paths[2]);
+    store::Store store(path_);
     absl::Status status;
 
     status = store.set("a", "1");
@@ -101,7 +102,7 @@ TEST_F(Store, Get)
 
 TEST_F(Store, LoadKeydir)
 {
-    store::Store store(base_path + paths[3]);
+    store::Store store(path_);
     absl::Status status;
 
     // (1) Populate the keydir and datafile
@@ -109,22 +110,22 @@ TEST_F(Store, LoadKeydir)
     ASSERT_TRUE(status.ok());
     status = store.set("b", "test");
     ASSERT_TRUE(status.ok());
-    EXPECT_EQ(store.active_file_offset(), 23); // 23 = size of 0000-01-01-a-1-0000-01-01-b-test
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 37); // 37 = size of 0000-0000-01-0001-00-a-1-0000-0000-01-0004-00-b-test
 
     // (2) Creating a new store and load the keydir as an existing datafile
     //     is present in the directory
-    store::Store store2(base_path + "load_keydir");
+    store::Store store2(path_);
     status = store2.load_keydir();
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store2.kd_size(), 2);
     EXPECT_EQ(store2.active_fileid(), 1);
-    EXPECT_EQ(store2.active_file_offset(), 23); // 23 = size of 0000-01-01-a-1-0000-01-01-b-test
+    EXPECT_EQ(store2.active_file_offset(), store::FILE_HEADER_SIZE + 37); // 37 = size of 0000-0000-01-0001-00-a-1-0000-0000-01-0004-00-b-test
 }
 
 
 TEST_F(Store, Del)
 {
-    store::Store store(base_path + paths[4]);
+    store::Store store(path_);
     absl::Status status;
 
     status = store.set("a", "1");
@@ -139,36 +140,51 @@ TEST_F(Store, Del)
 
     EXPECT_EQ(store.kd_size(), 1);
 
-    // Check the datafile content
+    // Check the datafile content: the records are timestamped, and the
+    // tombstone is a flagged record without a value
     std::ifstream file;
     file.open(store.active_datafile_path(), std::ios::in);
 
-    auto TOMBSTONE = 0xDEADDEADDEADDEAD;
-
     // get file content in one string
     std::string content((std::istreambuf_iterator<char>(file)),
                         std::istreambuf_iterator<char>());
     file.close();
-    EXPECT_EQ(binaryToHexString(content.c_str(), content.size()),
-              "30303030010001006131303030300100010062323030303001001400613136303435373235383835373337353930343435");
+    ASSERT_EQ(content.size(), store::FILE_HEADER_SIZE + 17 + 17 + 16);
+    ASSERT_TRUE(store::check_file_header(content, store::DATAFILE_MAGIC, "datafile").ok());
+
+    // the clock of the store: std::time() may lag it by a tick
+    std::uint32_t now = static_cast<std::uint32_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    std::string_view rest = std::string_view(content).substr(store::FILE_HEADER_SIZE);
+    record::View view;
+    for (auto [key, value, flags] : {std::tuple("a", "1", 0), std::tuple("b", "2", 0), std::tuple("a", "", 0x10)})
+    {
+        ASSERT_EQ(record::parse(rest, view), record::ParseResult::kOk);
+        EXPECT_EQ(view.key, key);
+        EXPECT_EQ(view.value, value);
+        EXPECT_EQ(view.header.flags, flags);
+        EXPECT_LE(view.header.timestamp, now);
+        EXPECT_GE(view.header.timestamp, now - 60);
+        rest.remove_prefix(view.size());
+    }
 }
 
 
 TEST_F(Store, LoadKeydirWithTombstone)
 {
-    store::Store store(base_path + "load_keydir_with_tombstone");
+    store::Store store(path_);
     absl::Status status;
 
     // (1) Populate the keydir and datafile
-    status = store.set("a", "1"); // size = 10
+    status = store.set("a", "1"); // size = 17
     ASSERT_TRUE(status.ok());
     std::cout << store.active_file_offset() << std::endl;
 
-    status = store.set("b", "2"); // size = 10
+    status = store.set("b", "2"); // size = 17
     ASSERT_TRUE(status.ok());
     std::cout << store.active_file_offset() << std::endl;
 
-    status = store.del("a"); // size = 29 = size of 0000-01-20-a-16045725885737590445
+    status = store.del("a"); // size = 16 = size of 0000-0000-01-0000-10-a
     ASSERT_TRUE(status.ok());
     std::cout << store.active_file_offset() << std::endl;
 
@@ -178,14 +194,1484 @@ TEST_F(Store, LoadKeydirWithTombstone)
     //                     std::istreambuf_iterator<char>());
     // file.close();
     // std::cout << content << std::endl;
-    EXPECT_EQ(store.active_file_offset(), 49); // 49 = 10 + 10 + 29
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 50); // 50 = 17 + 17 + 16
 
     // (2) Creating a new store and load the keydir as an existing datafile
     //     is present in the directory
-    store::Store store2(base_path + "load_keydir_with_tombstone");
+    store::Store store2(path_);
     status = store2.load_keydir();
     ASSERT_TRUE(status.ok());
     EXPECT_EQ(store2.kd_size(), 1);
     EXPECT_EQ(store2.active_fileid(), 1);
-    EXPECT_EQ(store.active_file_offset(), 49); // 49 = 10 + 10 + 29
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 50); // 50 = 17 + 17 + 16
+}
+
+
+TEST_F(Store, Rotate)
+{
+    store::Options options;
+    options.max_file_size = store::FILE_HEADER_SIZE + 37;
+    store::Store store(path_, options);
+    absl::Status status;
+
+    // (1) Two records of size 17 fit in the first datafile, the third one
+    //     rolls over to a new datafile
+    status = store.set("a", "1");
+    ASSERT_TRUE(status.ok());
+    status = store.set("b", "2");
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(store.active_fileid(), 1);
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 34);
+
+    status = store.set("c", "3");
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(store.active_fileid(), 2);
+    EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 17);
+    EXPECT_EQ(store.kd_get("c").value(), (keydir::Entry{.fileid = 2, .vsz = 1, .vpos = store::FILE_HEADER_SIZE}));
+
+    // the first datafile is sealed
+    fs::perms perms = fs::status(store.datafile_path(1)).permissions();
+    EXPECT_EQ(perms & fs::perms::owner_write, fs::perms::none);
+
+    // (2) Values are read from the datafile holding them
+    EXPECT_EQ(store.get("a").value(), "1");
+    EXPECT_EQ(store.get("c").value(), "3");
+
+    // (3) Overwrite a key of the sealed datafile and reload the store
+    status = store.set("a", "4");
+    ASSERT_TRUE(status.ok());
+
+    store::Store store2(path_, options);
+    status = store2.load_keydir();
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(store2.kd_size(), 3);
+    EXPECT_EQ(store2.active_fileid(), 2);
+    EXPECT_EQ(store2.active_file_offset(), store::FILE_HEADER_SIZE + 34);
+    EXPECT_EQ(store2.get("a").value(), "4");
+    EXPECT_EQ(store2.get("b").value(), "2");
+}
+
+
+TEST_F(Store, LargeOffsets)
+{
+    store::Store store(path_);
+    absl::Status status;
+
+    // Write enough data to go past the 64 KiB mark in a single datafile
+    std::string big_value(60000, 'x');
+    status = store.set("a", big_value);
+    ASSERT_TRUE(status.ok());
+    status = store.set("b", big_value);
+    ASSERT_TRUE(status.ok());
+    status = store.set("c", "after");
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(store.active_fileid(), 1);
+    EXPECT_EQ(store.kd_get("c").value().vpos, store::FILE_HEADER_SIZE + 2 * (15 + 1 + 60000));
+
+    EXPECT_EQ(store.get("b").value(), big_value);
+    EXPECT_EQ(store.get("c").value(), "after");
+
+    store::Store store2(path_);
+    status = store2.load_keydir();
+    ASSERT_TRUE(status.ok());
+    EXPECT_EQ(store2.get("c").value(), "after");
+}
+
+
+TEST_F(Store, SyncPolicy)
+{
+    for (store::SyncPolicy policy : {store::SyncPolicy::kPerBatch, store::SyncPolicy::kInterval})
+    {
+        fs::remove_all(path_);
+        fs::create_directories(path_);
+
+        store::Options options;
+        options.sync_policy = policy;
+        options.sync_interval = std::chrono::milliseconds(1);
+        {
+            store::Store store(path_, options);
+            ASSERT_TRUE(store.set("a", "1").ok());
+            ASSERT_TRUE(store.set("b", "2").ok());
+            ASSERT_TRUE(store.del("a").ok());
+            ASSERT_TRUE(store.sync().ok());
+            EXPECT_EQ(store.get("b").value(), "2");
+        }
+
+        store::Store store2(path_, options);
+        ASSERT_TRUE(store2.load_keydir().ok());
+        EXPECT_EQ(store2.kd_size(), 1);
+        EXPECT_EQ(store2.active_file_offset(), store::FILE_HEADER_SIZE + 50);
+        EXPECT_EQ(store2.get("b").value(), "2");
+    }
+}
+
+
+TEST_F(Store, GetFewOpenFiles)
+{
+    // One record per datafile and a single cached descriptor
+    store::Options options;
+    options.max_file_size = 1;
+    options.max_open_files = 1;
+    store::Store store(path_, options);
+
+    for (int i = 0; i < 5; i++)
+    {
+        ASSERT_TRUE(store.set("key" + std::to_string(i), "value" + std::to_string(i)).ok());
+    }
+    EXPECT_EQ(store.active_fileid(), 5);
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            absl::StatusOr<std::string> value = store.get("key" + std::to_string(i));
+            ASSERT_TRUE(value.ok());
+            EXPECT_EQ(*value, "value" + std::to_string(i));
+        }
+    }
+}
+
+
+TEST_F(Store, GetMmap)
+{
+    store::Options options;
+    options.max_file_size = 37;
+    options.read_mode = store::ReadMode::kMmap;
+    options.madvise_policy = store::MadvisePolicy::kSequential;
+    store::Store store(path_, options);
+
+    ASSERT_TRUE(store.set("a", "1").ok());
+    ASSERT_TRUE(store.set("b", "2").ok());
+    ASSERT_TRUE(store.set("c", "3").ok()); // rolls over, datafile1 is sealed
+
+    // values of the sealed datafile come from the mapping
+    absl::StatusOr<store::ValueView> view = store.get_view("b");
+    ASSERT_TRUE(view.ok());
+    EXPECT_TRUE(view->is_mapped());
+    EXPECT_EQ(view->view(), "2");
+    EXPECT_EQ(store.get("a").value(), "1");
+
+    // values of the active datafile are read and owned by the view
+    view = store.get_view("c");
+    ASSERT_TRUE(view.ok());
+    EXPECT_FALSE(view->is_mapped());
+    EXPECT_EQ(view->view(), "3");
+
+    EXPECT_EQ(store.get_view("d").status().code(), absl::StatusCode::kNotFound);
+}
+
+
+static std::uintmax_t datafiles_size(const store::Store &store)
+{
+    std::uintmax_t size = 0;
+    for (store::fileid_t fileid : store.datafile_ids())
+    {
+        size += fs::file_size(store.datafile_path(fileid));
+    }
+    return size;
+}
+
+
+TEST_F(Store, Merge)
+{
+    store::Options options;
+    options.max_file_size = 100;
+    store::Store store(path_, options);
+
+    // overwrite 10 keys 10 times and delete half of them
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            ASSERT_TRUE(store.set("key" + std::to_string(i), "value" + std::to_string(round)).ok());
+        }
+    }
+    for (int i = 0; i < 10; i += 2)
+    {
+        ASSERT_TRUE(store.del("key" + std::to_string(i)).ok());
+    }
+    std::uintmax_t size_before = datafiles_size(store);
+    std::size_t files_before = store.datafile_ids().size();
+
+    ASSERT_TRUE(store.merge().ok());
+
+    // only the 5 live records are left, in sealed datafiles
+    EXPECT_LT(datafiles_size(store), size_before / 10);
+    EXPECT_LT(store.datafile_ids().size(), files_before);
+    EXPECT_EQ(store.kd_size(), 5);
+    for (int i = 0; i < 10; i++)
+    {
+        absl::StatusOr<std::string> value = store.get("key" + std::to_string(i));
+        if (i % 2 == 0)
+        {
+            EXPECT_EQ(value.status().code(), absl::StatusCode::kNotFound);
+        }
+        else
+        {
+            EXPECT_EQ(value.value(), "value9");
+        }
+    }
+
+    // writes after the merge win over the merged records on reload
+    ASSERT_TRUE(store.set("key1", "new").ok());
+    ASSERT_TRUE(store.del("key3").ok());
+
+    store::Store store2(path_, options);
+    ASSERT_TRUE(store2.load_keydir().ok());
+    EXPECT_EQ(store2.kd_size(), 4);
+    EXPECT_EQ(store2.get("key1").value(), "new");
+    EXPECT_EQ(store2.get("key3").status().code(), absl::StatusCode::kNotFound);
+    EXPECT_EQ(store2.get("key5").value(), "value9");
+    EXPECT_EQ(store2.get("key0").status().code(), absl::StatusCode::kNotFound);
+
+    // merging again merges the outputs of the previous merge
+    ASSERT_TRUE(store2.merge().ok());
+    EXPECT_EQ(store2.get("key1").value(), "new");
+    store::Store store3(path_, options);
+    ASSERT_TRUE(store3.load_keydir().ok());
+    EXPECT_EQ(store3.kd_size(), 4);
+    EXPECT_EQ(store3.get("key1").value(), "new");
+}
+
+
+TEST_F(Store, MergeBackground)
+{
+    store::Options options;
+    options.max_file_size = 200;
+    store::Store store(path_, options);
+
+    for (int i = 0; i < 200; i++)
+    {
+        ASSERT_TRUE(store.set("key" + std::to_string(i % 20), std::to_string(i)).ok());
+    }
+
+    // keep writing and reading while the merge runs
+    ASSERT_TRUE(store.start_merge().ok());
+    for (int i = 200; i < 400; i++)
+    {
+        ASSERT_TRUE(store.set("key" + std::to_string(i % 20), std::to_string(i)).ok());
+        absl::StatusOr<std::string> value = store.get("key" + std::to_string(i % 20));
+        ASSERT_TRUE(value.ok());
+        EXPECT_EQ(*value, std::to_string(i));
+    }
+    ASSERT_TRUE(store.wait_for_merge().ok());
+
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_EQ(store.get("key" + std::to_string(i)).value(), std::to_string(380 + i));
+    }
+
+    store::Store store2(path_, options);
+    ASSERT_TRUE(store2.load_keydir().ok());
+    EXPECT_EQ(store2.kd_size(), 20);
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_EQ(store2.get("key" + std::to_string(i)).value(), std::to_string(380 + i));
+    }
+}
+
+
+TEST_F(Store, MergeRecovery)
+{
+    std::string path = path_;
+    store::Options options;
+    options.max_file_size = 37;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.set("a", "1").ok());
+        ASSERT_TRUE(store.set("b", "2").ok());
+        ASSERT_TRUE(store.set("a", "3").ok());
+    }
+
+    // (1) the outputs of a merge interrupted before its commit are removed
+    {
+        std::ofstream leftover(fs::path(path) / "datafile9.merge");
+        leftover << "garbage";
+    }
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_FALSE(fs::exists(fs::path(path) / "datafile9.merge"));
+        EXPECT_EQ(store.get("a").value(), "3");
+    }
+
+    // (2) a merge interrupted after its commit is finished: simulate it by
+    //     restoring a merged datafile and listing it again as an input of the
+    //     last merge, whose manifest no longer lists its removed inputs
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_TRUE(store.merge().ok());
+    }
+    {
+        std::ifstream manifest(fs::path(path) / "MERGE");
+        std::string content((std::istreambuf_iterator<char>(manifest)), std::istreambuf_iterator<char>());
+        EXPECT_EQ(content.find("input"), std::string::npos) << content;
+        EXPECT_NE(content.find("last"), std::string::npos) << content;
+    }
+    {
+        std::ofstream stale(fs::path(path) / "datafile1", std::ios::binary);
+        stale << std::string("0000\x00\x00\x00\x00\x01\x00\x01\x00\x00\x00\x00" "a" "1", 17);
+        std::ofstream manifest(fs::path(path) / "MERGE", std::ios::app);
+        manifest << "input 1\n";
+    }
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_FALSE(fs::exists(fs::path(path) / "datafile1"));
+    EXPECT_EQ(store.kd_size(), 2);
+    EXPECT_EQ(store.get("a").value(), "3");
+    EXPECT_EQ(store.get("b").value(), "2");
+}
+
+
+TEST_F(Store, MergeRemovingEveryDatafile)
+{
+    std::string path = path_;
+
+    // a merge of deleted keys only leaves its manifest in the directory
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.set("a", "1").ok());
+        ASSERT_TRUE(store.set("b", "2").ok());
+        ASSERT_TRUE(store.del("a").ok());
+        ASSERT_TRUE(store.del("b").ok());
+        ASSERT_TRUE(store.merge().ok());
+    }
+    {
+        store::Store store(path);
+        EXPECT_TRUE(store.datafile_ids().empty());
+    }
+
+    // the next write gets a file id the merge did not use, so that it
+    // survives the reopens
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_GT(store.active_fileid(), 1);
+        ASSERT_TRUE(store.set("new", "3").ok());
+    }
+    for (int reopen = 0; reopen < 2; reopen++)
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.get("new").value(), "3");
+        EXPECT_FALSE(store.get("a").ok());
+    }
+}
+
+
+TEST_F(Store, MergeRestart)
+{
+    std::string path = path_;
+    store::Options options;
+    options.max_file_size = 100;
+    auto is_sealed = [](const fs::path &file) {
+        return (fs::status(file).permissions() & fs::perms::owner_write) == fs::perms::none;
+    };
+
+    // the merge outputs get file ids above the active datafile, which is
+    // sealed when the merge commits so that writes go after the outputs
+    {
+        store::Store store(path, options);
+        for (int i = 0; i < 50; i++)
+        {
+            ASSERT_TRUE(store.set("key" + std::to_string(i % 10), std::to_string(i)).ok());
+        }
+        ASSERT_TRUE(store.merge().ok());
+        ASSERT_TRUE(store.set("key0", "after").ok());
+        std::vector<store::fileid_t> fileids = store.datafile_ids();
+        EXPECT_EQ(store.active_fileid(), fileids.back());
+    }
+
+    // (1) on restart, the last datafile is the active one and all the others
+    //     are sealed and hinted
+    store::fileid_t active = 0;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        std::vector<store::fileid_t> fileids = store.datafile_ids();
+        active = fileids.back();
+        EXPECT_EQ(store.active_fileid(), active);
+        EXPECT_GT(store.active_file_offset(), 0);
+        for (store::fileid_t fileid : fileids)
+        {
+            EXPECT_EQ(is_sealed(store.datafile_path(fileid)), fileid != active) << fileid;
+            EXPECT_EQ(fs::exists(store.datafile_path(fileid).string() + ".hint"), fileid != active) << fileid;
+        }
+        EXPECT_EQ(store.get("key0").value(), "after");
+        EXPECT_EQ(store.get("key9").value(), "49");
+    }
+
+    // (2) an older datafile left unsealed (a crash right after a merge
+    //     commit) is sealed and hinted on load
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_TRUE(store.merge().ok());
+        ASSERT_TRUE(store.set("key1", "late").ok());
+        active = store.active_fileid();
+    }
+    std::vector<store::fileid_t> fileids;
+    {
+        store::Store store(path, options);
+        fileids = store.datafile_ids();
+    }
+    fs::path stale = fs::path(path) / ("datafile" + std::to_string(fileids.front()));
+    fs::permissions(stale, fs::perms::owner_write, fs::perm_options::add);
+    fs::remove(stale.string() + ".hint");
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.active_fileid(), active);
+    EXPECT_TRUE(is_sealed(stale));
+    EXPECT_TRUE(fs::exists(stale.string() + ".hint"));
+    EXPECT_EQ(store.get("key1").value(), "late");
+    EXPECT_EQ(store.get("key0").value(), "after");
+}
+
+
+TEST_F(Store, HintFiles)
+{
+    std::string path = path_;
+    store::Options options;
+    options.max_file_size = store::FILE_HEADER_SIZE + 37;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.set("a", "1").ok());
+        ASSERT_TRUE(store.set("b", "2").ok());
+        ASSERT_TRUE(store.set("c", "3").ok()); // seals datafile1
+        ASSERT_TRUE(store.del("a").ok());
+        ASSERT_TRUE(store.set("d", "4").ok()); // seals datafile2
+
+        EXPECT_TRUE(fs::exists(fs::path(path) / "datafile1.hint"));
+        EXPECT_TRUE(fs::exists(fs::path(path) / "datafile2.hint"));
+        EXPECT_FALSE(fs::exists(fs::path(path) / "datafile3.hint"));
+    }
+
+    // (1) the keydir is rebuilt from the hint files of the sealed datafiles.
+    //     Break the sealed datafiles to make sure they are not read.
+    std::string datafile1 = (fs::path(path) / "datafile1").string();
+    std::string datafile2 = (fs::path(path) / "datafile2").string();
+    fs::rename(datafile1, datafile1 + ".bak");
+    fs::rename(datafile2, datafile2 + ".bak");
+    {
+        std::ofstream(datafile1) << "broken";
+        std::ofstream(datafile2) << "broken";
+        fs::permissions(datafile1, fs::perms::owner_read);
+        fs::permissions(datafile2, fs::perms::owner_read);
+    }
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.kd_size(), 3);
+        EXPECT_EQ(store.kd_get("a").status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.kd_get("c").value(), (keydir::Entry{.fileid = 2, .vsz = 1, .vpos = store::FILE_HEADER_SIZE}));
+        EXPECT_EQ(store.get("d").value(), "4");
+    }
+    fs::remove(datafile1);
+    fs::remove(datafile2);
+    fs::rename(datafile1 + ".bak", datafile1);
+    fs::rename(datafile2 + ".bak", datafile2);
+
+    // (2) a hint file failing its checksum falls back to the datafile and is
+    //     written again, as is a missing one
+    const fs::path hint1 = fs::path(path) / "datafile1.hint";
+    std::uint64_t hint1_size = fs::file_size(hint1);
+    {
+        std::fstream file(hint1, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(hint1_size - 1)); // key of the last entry
+        file.put('x');
+    }
+    fs::remove(fs::path(path) / "datafile2.hint");
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_FALSE(store.load_stats().files[0].from_hint);
+    EXPECT_EQ(store.kd_size(), 3);
+    EXPECT_EQ(store.get("b").value(), "2");
+    EXPECT_EQ(store.get("c").value(), "3");
+    EXPECT_EQ(fs::file_size(hint1), hint1_size);
+    EXPECT_TRUE(fs::exists(fs::path(path) / "datafile2.hint"));
+    {
+        store::Store reloaded(path, options);
+        ASSERT_TRUE(reloaded.load_keydir().ok());
+        EXPECT_TRUE(reloaded.load_stats().files[0].from_hint);
+    }
+
+    // (3) the merged datafiles get hint files, the merged ones lose theirs
+    ASSERT_TRUE(store.merge().ok());
+    EXPECT_FALSE(fs::exists(fs::path(path) / "datafile1.hint"));
+    for (store::fileid_t fileid : store.datafile_ids())
+    {
+        EXPECT_TRUE(fs::exists(fs::path(store.datafile_path(fileid).string() + ".hint")));
+    }
+    store::Store store2(path, options);
+    ASSERT_TRUE(store2.load_keydir().ok());
+    EXPECT_EQ(store2.kd_size(), 3);
+    EXPECT_EQ(store2.get("d").value(), "4");
+}
+
+TEST_F(Store, LoadKeydirParallel)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.max_file_size = 64;
+    options.load_threads = 4;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+
+        // overwrite and delete keys across many small datafiles so that the
+        // order the partial keydirs are applied in matters
+        for (int round = 0; round < 10; round++)
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                ASSERT_TRUE(store.set("key" + std::to_string(i), std::to_string(round)).ok());
+            }
+            ASSERT_TRUE(store.del("key" + std::to_string(round)).ok());
+        }
+    }
+
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 9);
+    EXPECT_EQ(store.get("key9").status().code(), absl::StatusCode::kNotFound);
+    for (int i = 0; i < 9; i++)
+    {
+        EXPECT_EQ(store.get("key" + std::to_string(i)).value(), "9");
+    }
+
+    const store::LoadStats &stats = store.load_stats();
+    EXPECT_EQ(stats.threads, 4);
+    EXPECT_GT(stats.files.size(), 10);
+    EXPECT_EQ(stats.files.size(), store.datafile_ids().size());
+    for (std::size_t i = 1; i < stats.files.size(); i++)
+    {
+        EXPECT_LT(stats.files[i - 1].fileid, stats.files[i].fileid);
+        EXPECT_TRUE(stats.files[i - 1].from_hint);
+    }
+}
+
+TEST_F(Store, Checksums)
+{
+    const std::string path = path_;
+    const fs::path datafile = fs::path(path) / "datafile1";
+    store::Options verify_options;
+    verify_options.verify_checksums = true;
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_TRUE(store.set("a", "1").ok());
+        ASSERT_TRUE(store.set("b", "2").ok());
+        ASSERT_TRUE(store.set("c", "3").ok());
+        store::Store verifying(path, verify_options);
+        ASSERT_TRUE(verifying.load_keydir().ok());
+
+        // (1) get only checks the records when asked to
+        {
+            std::fstream file(datafile, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(store::FILE_HEADER_SIZE + 17 + 16); // value of b
+            file.put('x');
+        }
+        EXPECT_EQ(store.get("b").value(), "x");
+        EXPECT_EQ(verifying.get("b").status().code(), absl::StatusCode::kDataLoss);
+        EXPECT_EQ(verifying.get("a").value(), "1");
+    }
+
+    // (2) load_keydir fails on the corrupted record by default, or drops it
+    //     and the rest of the active datafile when asked to
+    store::Options truncate_options;
+    truncate_options.corruption_policy = store::CorruptionPolicy::kTruncate;
+    {
+        store::Store store(path);
+        EXPECT_EQ(store.load_keydir().code(), absl::StatusCode::kDataLoss);
+    }
+    {
+        store::Store store(path, truncate_options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.kd_size(), 1);
+        EXPECT_EQ(store.load_stats().files[0].discarded_bytes, 34);
+        EXPECT_EQ(fs::file_size(datafile), store::FILE_HEADER_SIZE + 17);
+    }
+
+    // (3) a torn write at the end of the active datafile is dropped and
+    //     appends resume after the last valid record
+    {
+        std::ofstream file(datafile, std::ios::app | std::ios::binary);
+        file << std::string("\x00\x00\x00\x00\x01\x00", 6);
+    }
+    {
+        store::Store store(path, truncate_options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.load_stats().files[0].discarded_bytes, 6);
+        EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 17);
+        ASSERT_TRUE(store.set("d", "4").ok());
+    }
+    store::Store store(path, verify_options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 2);
+    EXPECT_EQ(store.get("a").value(), "1");
+    EXPECT_EQ(store.get("d").value(), "4");
+}
+
+TEST_F(Store, ConcurrentAccess)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.max_file_size = 1024; // rotate while writing
+    const int n_writers = 4;
+    const int n_keys = 500;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+
+        // writers append their own keys while readers look them up, a value
+        // is either not written yet or complete
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_writers; t++)
+        {
+            threads.emplace_back([&store, t]() {
+                for (int i = 0; i < n_keys; i++)
+                {
+                    std::string key = std::to_string(t) + "-" + std::to_string(i);
+                    ASSERT_TRUE(store.set(key, "value-" + key).ok());
+                }
+            });
+            threads.emplace_back([&store, t]() {
+                for (int i = 0; i < n_keys; i++)
+                {
+                    std::string key = std::to_string(t) + "-" + std::to_string(i);
+                    absl::StatusOr<std::string> value = store.get(key);
+                    if (value.ok())
+                    {
+                        EXPECT_EQ(*value, "value-" + key);
+                    }
+                    else
+                    {
+                        EXPECT_EQ(value.status().code(), absl::StatusCode::kNotFound);
+                    }
+                }
+            });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        EXPECT_EQ(store.kd_size(), n_writers * n_keys);
+    }
+
+    // every datafile respects the size threshold and the keydir is the same
+    // once reloaded
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), n_writers * n_keys);
+    for (store::fileid_t fileid : store.datafile_ids())
+    {
+        EXPECT_LE(fs::file_size(store.datafile_path(fileid)), options.max_file_size);
+    }
+    for (int t = 0; t < n_writers; t++)
+    {
+        for (int i = 0; i < n_keys; i++)
+        {
+            std::string key = std::to_string(t) + "-" + std::to_string(i);
+            EXPECT_EQ(store.get(key).value(), "value-" + key);
+        }
+    }
+}
+
+TEST_F(Store, WriteBatch)
+{
+    const std::string path = path_;
+    const fs::path datafile = fs::path(path) / "datafile1";
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_TRUE(store.set("c", "3").ok());
+
+        // (1) the whole batch is visible once write returns
+        store::WriteBatch batch;
+        batch.put("a", "1");
+        batch.put("b", "22");
+        batch.del("c");
+        EXPECT_EQ(batch.size(), 3);
+        ASSERT_TRUE(store.write(batch).ok());
+        EXPECT_EQ(store.kd_size(), 2);
+        EXPECT_EQ(store.get("a").value(), "1");
+        EXPECT_EQ(store.get("b").value(), "22");
+        EXPECT_EQ(store.get("c").status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 68); // 68 = 17 + 17 + 18 + 16
+
+        // (2) an empty batch writes nothing
+        ASSERT_TRUE(store.write(store::WriteBatch()).ok());
+        EXPECT_EQ(store.active_file_offset(), store::FILE_HEADER_SIZE + 68);
+    }
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.kd_size(), 2);
+        EXPECT_EQ(store.get("b").value(), "22");
+    }
+
+    // (3) a batch cut short by a crash is dropped as a whole
+    fs::resize_file(datafile, store::FILE_HEADER_SIZE + 17 + 17 + 5);
+    {
+        store::Store store(path);
+        EXPECT_EQ(store.load_keydir().code(), absl::StatusCode::kDataLoss);
+    }
+    store::Options options;
+    options.corruption_policy = store::CorruptionPolicy::kTruncate;
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 1);
+    EXPECT_EQ(store.get("c").value(), "3");
+    EXPECT_EQ(store.get("a").status().code(), absl::StatusCode::kNotFound);
+    EXPECT_EQ(store.load_stats().files[0].discarded_bytes, 22);
+    EXPECT_EQ(fs::file_size(datafile), store::FILE_HEADER_SIZE + 17);
+}
+
+TEST_F(Store, MultiGet)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.max_file_size = 256;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        for (int i = 0; i < 50; i++)
+        {
+            ASSERT_TRUE(store.set("key" + std::to_string(i), "value" + std::to_string(i)).ok());
+        }
+        ASSERT_TRUE(store.del("key7").ok());
+        ASSERT_TRUE(store.set("key3", "updated").ok());
+        // a large value between two records of a datafile is skipped over
+        ASSERT_TRUE(store.set("key5", std::string(5000, 'x')).ok());
+        ASSERT_GT(store.datafile_ids().size(), 2);
+    }
+
+    // the same keys, in an order unrelated to the datafiles, with a missing,
+    // a deleted and a duplicated key
+    std::vector<std::string> owned = {"key42", "key3", "missing", "key0", "key7", "key5", "key42", "key49", ""};
+    for (int i = 10; i < 30; i++)
+    {
+        owned.push_back("key" + std::to_string(i));
+    }
+    std::vector<std::string_view> keys(owned.begin(), owned.end());
+
+    store::Options verify_options = options;
+    verify_options.verify_checksums = true;
+    store::Options mmap_options = options;
+    mmap_options.read_mode = store::ReadMode::kMmap;
+    for (const store::Options &read_options : {options, verify_options, mmap_options})
+    {
+        store::Store store(path, read_options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        std::vector<absl::StatusOr<std::string>> values = store.multi_get(keys);
+        ASSERT_EQ(values.size(), keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            absl::StatusOr<std::string> expected = store.get(owned[i]);
+            ASSERT_EQ(values[i].status().code(), expected.status().code()) << owned[i];
+            if (expected.ok())
+            {
+                EXPECT_EQ(*values[i], *expected) << owned[i];
+            }
+        }
+        EXPECT_EQ(values[1].value(), "updated");
+        EXPECT_EQ(values[2].status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(values[4].status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(values[5].value(), std::string(5000, 'x'));
+        EXPECT_EQ(values[6].value(), "value42");
+        EXPECT_TRUE(store.multi_get({}).empty());
+    }
+}
+
+TEST_F(Store, AsyncAccess)
+{
+    const std::string path = path_;
+    for (store::IoBackend backend : {store::IoBackend::kAuto, store::IoBackend::kThreadPool})
+    {
+        fs::remove_all(path);
+        fs::create_directories(path);
+        store::Options options;
+        options.io_backend = backend;
+        options.io_queue_depth = 16;
+        auto store = std::make_unique<store::Store>(path, options);
+        ASSERT_TRUE(store->load_keydir().ok());
+
+        // (1) concurrent sets
+        const int n_keys = 300;
+        std::vector<std::future<absl::Status>> sets;
+        for (int i = 0; i < n_keys; i++)
+        {
+            sets.push_back(store->async_set("key" + std::to_string(i), "value" + std::to_string(i)));
+        }
+        for (std::future<absl::Status> &set : sets)
+        {
+            ASSERT_TRUE(set.get().ok());
+        }
+        EXPECT_EQ(store->kd_size(), n_keys);
+
+        // (2) many reads in flight from the calling thread
+        std::vector<std::future<absl::StatusOr<std::string>>> gets;
+        for (int i = 0; i < n_keys; i++)
+        {
+            gets.push_back(store->async_get("key" + std::to_string(i)));
+        }
+        for (int i = 0; i < n_keys; i++)
+        {
+            EXPECT_EQ(gets[i].get().value(), "value" + std::to_string(i));
+        }
+        EXPECT_EQ(store->async_get("missing").get().status().code(), absl::StatusCode::kNotFound);
+
+        // (3) callbacks left in flight complete before the store is destroyed
+        std::atomic<int> completed = 0;
+        for (int i = 0; i < n_keys; i++)
+        {
+            store->async_get("key" + std::to_string(i), [&completed](absl::StatusOr<std::string> value) {
+                if (value.ok())
+                {
+                    completed++;
+                }
+            });
+        }
+        store->async_set("last", "1", [&completed](absl::Status status) {
+            if (status.ok())
+            {
+                completed++;
+            }
+        });
+        store.reset();
+        EXPECT_EQ(completed, n_keys + 1);
+    }
+}
+
+TEST_F(Store, Coroutines)
+{
+    const std::string path = path_;
+    store::Store store(path);
+    ASSERT_TRUE(store.load_keydir().ok());
+    store::Executor executor;
+
+    // many requests outstanding on a single driving thread
+    const int n_keys = 100;
+    std::vector<absl::Status> statuses(n_keys);
+    for (int i = 0; i < n_keys; i++)
+    {
+        executor.spawn([](store::Store &store, store::Executor &executor, absl::Status &status,
+                          int i) -> store::Task<void> {
+            std::string key = "key" + std::to_string(i);
+            status = co_await store.co_set(executor, key, "value" + std::to_string(i));
+            if (!status.ok())
+            {
+                co_return;
+            }
+            absl::StatusOr<std::string> value = co_await store.co_get(executor, key);
+            status = value.ok() && *value == "value" + std::to_string(i) ? absl::OkStatus() : absl::InternalError(key);
+        }(store, executor, statuses[i], i));
+    }
+    while (executor.spawned() > 0)
+    {
+        executor.run_one();
+    }
+    for (const absl::Status &status : statuses)
+    {
+        EXPECT_TRUE(status.ok()) << status.message();
+    }
+    EXPECT_EQ(store.kd_size(), n_keys);
+
+    EXPECT_TRUE(executor.run(store.co_del(executor, "key0")).ok());
+    EXPECT_EQ(executor.run(store.co_get(executor, "key0")).status().code(), absl::StatusCode::kNotFound);
+    EXPECT_EQ(executor.run(store.co_del(executor, "key0")).code(), absl::StatusCode::kNotFound);
+}
+
+TEST_F(Store, ValueCache)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.value_cache_bytes = 1 << 20;
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    ASSERT_TRUE(store.set("a", "1").ok());
+    ASSERT_TRUE(store.set("b", "2").ok());
+
+    // (1) the first read misses, the next ones are served from memory
+    EXPECT_EQ(store.get("a").value(), "1");
+    EXPECT_EQ(store.get("a").value(), "1");
+    EXPECT_EQ(store.get_view("a")->view(), "1");
+    std::vector<std::string_view> keys = {"a", "b"};
+    std::vector<absl::StatusOr<std::string>> values = store.multi_get(keys);
+    EXPECT_EQ(values[1].value(), "2");
+    EXPECT_EQ(store.async_get("b").get().value(), "2");
+    store::ValueCache::Stats stats = store.value_cache_stats();
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.hits, 4);
+    EXPECT_EQ(stats.entries, 2);
+
+    // (2) writes never serve a stale value
+    ASSERT_TRUE(store.set("a", "updated").ok());
+    EXPECT_EQ(store.get("a").value(), "updated");
+    ASSERT_TRUE(store.del("b").ok());
+    EXPECT_EQ(store.get("b").status().code(), absl::StatusCode::kNotFound);
+    EXPECT_EQ(store.value_cache_stats().entries, 1);
+
+    // (3) a merge drops the values of the datafiles it removes
+    ASSERT_TRUE(store.merge().ok());
+    EXPECT_EQ(store.value_cache_stats().entries, 0);
+    EXPECT_EQ(store.get("a").value(), "updated");
+
+    // disabled by default
+    store::Store uncached(path);
+    ASSERT_TRUE(uncached.load_keydir().ok());
+    EXPECT_EQ(uncached.get("a").value(), "updated");
+    EXPECT_EQ(uncached.value_cache_stats().misses, 0);
+}
+
+TEST_F(Store, ScanBuffer)
+{
+    // records of varying sizes over several scan buffers, some of them in
+    // batches, so that records and batches straddle the buffer refills
+    const std::string path = path_;
+    std::uint64_t file_size;
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        for (int i = 0; i < 3000; i++)
+        {
+            std::string value(static_cast<std::size_t>((i * 7919) % 700), static_cast<char>('a' + i % 26));
+            if (i % 10 == 0)
+            {
+                store::WriteBatch batch;
+                batch.put("key" + std::to_string(i), value);
+                batch.put("batch" + std::to_string(i), value);
+                ASSERT_TRUE(store.write(batch).ok());
+            }
+            else
+            {
+                ASSERT_TRUE(store.set("key" + std::to_string(i), value).ok());
+            }
+        }
+        ASSERT_TRUE(store.del("key1").ok());
+        file_size = store.active_file_offset();
+        ASSERT_GT(file_size, 4 * 256 * 1024);
+    }
+
+    store::Store store(path);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 3000 + 300 - 1);
+    EXPECT_EQ(store.load_stats().files[0].records, 3000 + 300 + 1);
+    EXPECT_EQ(store.active_file_offset(), file_size);
+    EXPECT_EQ(store.get("key1").status().code(), absl::StatusCode::kNotFound);
+    for (int i = 0; i < 3000; i += 7)
+    {
+        std::string value(static_cast<std::size_t>((i * 7919) % 700), static_cast<char>('a' + i % 26));
+        EXPECT_EQ(store.get("key" + std::to_string(i)).value(), value);
+    }
+}
+
+TEST_F(Store, LargeValues)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.verify_checksums = true;
+
+    // a value of 5 MiB, produced and checked chunk by chunk
+    const std::uint64_t size = 5 * 1024 * 1024 + 123;
+    auto byte_at = [](std::uint64_t i) { return static_cast<char>((i * 2654435761ULL) >> 13); };
+    auto check_stream = [&](store::Store &store) {
+        std::uint64_t received = 0;
+        bool matches = true;
+        absl::Status status = store.get_stream("blob", [&](std::string_view chunk) {
+            EXPECT_LT(chunk.size(), size); // never the whole value at once
+            for (char c : chunk)
+            {
+                matches = matches && c == byte_at(received++);
+            }
+            return absl::OkStatus();
+        });
+        EXPECT_TRUE(status.ok()) << status;
+        EXPECT_EQ(received, size);
+        EXPECT_TRUE(matches);
+    };
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+
+        // (1) set and get go past 64 KiB, up to the size of the scan buffer
+        std::string big(300000, 'b');
+        ASSERT_TRUE(store.set("big", big).ok());
+        EXPECT_EQ(store.get("big").value(), big);
+
+        // (2) put_stream and get_stream
+        std::string chunk(100000, '\0');
+        std::uint64_t produced = 0;
+        absl::Status status = store.put_stream("blob", size, [&]() -> absl::StatusOr<std::string_view> {
+            std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(size - produced, chunk.size()));
+            for (std::size_t i = 0; i < n; i++)
+            {
+                chunk[i] = byte_at(produced + i);
+            }
+            produced += n;
+            return std::string_view(chunk.data(), n);
+        });
+        ASSERT_TRUE(status.ok()) << status;
+        EXPECT_EQ(store.kd_get("blob").value().vsz, size);
+        check_stream(store);
+        ASSERT_TRUE(store.set("after", "1").ok());
+
+        // (3) a stream ending early or failing leaves the key, the file and
+        //     the offset the store rotates at as they were
+        std::uint64_t offset = store.active_file_offset();
+        std::istringstream input("short");
+        EXPECT_EQ(store.put_stream("after", input, 10).code(), absl::StatusCode::kInvalidArgument);
+        EXPECT_EQ(store.put_stream("after", 10, []() -> absl::StatusOr<std::string_view> {
+                      return absl::UnavailableError("source failed");
+                  }).code(),
+                  absl::StatusCode::kUnavailable);
+        EXPECT_EQ(store.get("after").value(), "1");
+        EXPECT_EQ(fs::file_size(store.datafile_path(store.active_fileid())), offset);
+        EXPECT_EQ(store.active_file_offset(), offset);
+
+        // (4) the stream overloads, and a sink error stops the read
+        std::istringstream small("streamed value");
+        ASSERT_TRUE(store.put_stream("small", small, 14).ok());
+        std::ostringstream output;
+        ASSERT_TRUE(store.get_stream("small", output).ok());
+        EXPECT_EQ(output.str(), "streamed value");
+        EXPECT_EQ(store.get_stream("blob", [](std::string_view) { return absl::CancelledError(); }).code(),
+                  absl::StatusCode::kCancelled);
+        EXPECT_EQ(store.get_stream("missing", output).code(), absl::StatusCode::kNotFound);
+    }
+
+    // (5) the large records are found again by load_keydir
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 4);
+    EXPECT_EQ(store.get("big").value(), std::string(300000, 'b'));
+    EXPECT_EQ(store.get("after").value(), "1");
+    check_stream(store);
+}
+
+TEST_F(Store, Compression)
+{
+    const std::string path = path_;
+    auto document = [](int i) {
+        std::string value;
+        for (int j = 0; j < 40; j++)
+        {
+            value += "{\"id\": " + std::to_string(i * 100 + j) + ", \"name\": \"item\", \"tags\": [\"a\", \"b\"]}";
+        }
+        return value;
+    };
+    std::mt19937 random(42);
+    std::string noise(500, '\0');
+    for (char &c : noise)
+    {
+        c = static_cast<char>(random());
+    }
+    store::Options options;
+    options.verify_checksums = true;
+    options.max_file_size = 4096;
+
+    // (1) every available codec writes to the same datafiles
+    std::vector<std::string> keys;
+    for (store::Compression codec : {store::Compression::kNone, store::Compression::kLz4, store::Compression::kZstd})
+    {
+        options.compression = codec;
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        if (!store::Compressor::is_available(codec))
+        {
+            EXPECT_EQ(store.set("key", "value").code(), absl::StatusCode::kFailedPrecondition);
+            // streamed values are never compressed
+            std::istringstream input("value");
+            EXPECT_TRUE(store.put_stream("streamed", input, 5).ok());
+            continue;
+        }
+
+        for (int i = 0; i < 10; i++)
+        {
+            std::string key = "doc" + std::to_string(static_cast<int>(codec)) + "_" + std::to_string(i);
+            ASSERT_TRUE(store.set(key, document(i)).ok());
+            keys.push_back(key);
+        }
+        std::string prefix = std::to_string(static_cast<int>(codec));
+        store::WriteBatch batch;
+        batch.put("batch" + prefix, document(99));
+        batch.put("noise" + prefix, noise);
+        batch.del("doc" + prefix + "_0");
+        ASSERT_TRUE(store.write(batch).ok());
+        keys.push_back("batch" + prefix);
+
+        // the keydir has the stored size, values that don't shrink are kept
+        // as they are
+        std::uint32_t vsz = store.kd_get("batch" + prefix).value().vsz;
+        if (codec == store::Compression::kNone)
+        {
+            EXPECT_EQ(vsz, document(99).size());
+        }
+        else
+        {
+            EXPECT_LT(vsz, document(99).size() / 2);
+        }
+        EXPECT_EQ(store.kd_get("noise" + prefix).value().vsz, noise.size());
+        EXPECT_EQ(store.get("batch" + prefix).value(), document(99));
+        EXPECT_EQ(store.get("noise" + prefix).value(), noise);
+        EXPECT_EQ(store.get("doc" + prefix + "_0").status().code(), absl::StatusCode::kNotFound);
+    }
+
+    // (2) the flags of the records survive the hint files, whatever the
+    //     codec of the reading store
+    auto check = [&](store::Store &store) {
+        for (const std::string &key : keys)
+        {
+            if (key.ends_with("_0"))
+            {
+                continue;
+            }
+            std::string expected = key.starts_with("batch") ? document(99) : document(std::stoi(key.substr(5)));
+            EXPECT_EQ(store.get(key).value(), expected) << key;
+            absl::StatusOr<store::ValueView> view = store.get_view(key);
+            ASSERT_TRUE(view.ok()) << view.status();
+            EXPECT_EQ(view->view(), expected);
+            std::ostringstream output;
+            ASSERT_TRUE(store.get_stream(key, output).ok());
+            EXPECT_EQ(output.str(), expected);
+        }
+    };
+    options.compression = store::Compression::kNone;
+    options.read_mode = store::ReadMode::kMmap;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        check(store);
+
+        // (3) merge copies the values as they are stored
+        std::uint32_t vsz = store.kd_get(keys.back()).value().vsz;
+        ASSERT_TRUE(store.merge().ok());
+        EXPECT_EQ(store.kd_get(keys.back()).value().vsz, vsz);
+        check(store);
+    }
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    check(store);
+}
+
+TEST_F(Store, Scan)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.max_file_size = 256;
+    if (store::Compressor::is_available(store::Compression::kLz4))
+    {
+        options.compression = store::Compression::kLz4;
+    }
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+
+    // (1) nothing to visit yet
+    {
+        store::Cursor cursor = store.scan();
+        EXPECT_FALSE(cursor.valid());
+        EXPECT_TRUE(cursor.status().ok());
+    }
+
+    // overwritten, deleted and batched keys spread over several datafiles,
+    // with a few compressed values
+    std::map<std::string, std::string> expected;
+    for (int i = 0; i < 50; i++)
+    {
+        std::string key = "key" + std::to_string(i);
+        std::string value = i % 10 == 0 ? std::string(200, static_cast<char>('a' + i / 10)) : std::to_string(i);
+        ASSERT_TRUE(store.set(key, value).ok());
+        expected[key] = value;
+    }
+    for (int i = 0; i < 50; i += 3)
+    {
+        std::string key = "key" + std::to_string(i);
+        ASSERT_TRUE(store.set(key, "new" + std::to_string(i)).ok());
+        expected[key] = "new" + std::to_string(i);
+    }
+    for (int i = 1; i < 50; i += 7)
+    {
+        ASSERT_TRUE(store.del("key" + std::to_string(i)).ok());
+        expected.erase("key" + std::to_string(i));
+    }
+    store::WriteBatch batch;
+    batch.put("batch", "value");
+    batch.del("key2");
+    ASSERT_TRUE(store.write(batch).ok());
+    expected["batch"] = "value";
+    expected.erase("key2");
+    ASSERT_GT(store.active_fileid(), 3);
+
+    // (2) every live key once, in datafile order, whatever the buffer size
+    auto collect = [&](store::Cursor &cursor) {
+        std::map<std::string, std::string> visited;
+        keydir::Entry previous{};
+        for (; cursor.valid(); cursor.next())
+        {
+            const keydir::Entry &entry = cursor.entry();
+            EXPECT_TRUE(std::tie(previous.fileid, previous.vpos) < std::tie(entry.fileid, entry.vpos));
+            previous = entry;
+            EXPECT_TRUE(visited.emplace(std::string(cursor.key()), std::string(cursor.value())).second);
+        }
+        EXPECT_TRUE(cursor.status().ok()) << cursor.status();
+        return visited;
+    };
+    for (std::size_t buffer_size : {store::Cursor::DEFAULT_BUFFER_SIZE, std::size_t(16)})
+    {
+        store::Cursor cursor = store.scan(buffer_size);
+        EXPECT_EQ(collect(cursor), expected);
+    }
+
+    // (3) a merge started while a cursor is open waits for it
+    {
+        store::Cursor cursor = store.scan();
+        ASSERT_TRUE(store.start_merge().ok());
+        EXPECT_EQ(collect(cursor), expected);
+    }
+    ASSERT_TRUE(store.wait_for_merge().ok());
+    {
+        store::Cursor cursor = store.scan();
+        EXPECT_EQ(collect(cursor), expected);
+    }
+
+    // (4) a corrupted record fails the scan, even at the end of the last
+    //     datafile listed once it is sealed: only the active datafile may end
+    //     with an append in flight
+    const std::string sealed_path = path + "/sealed";
+    fs::create_directories(sealed_path);
+    {
+        store::Options sealed_options;
+        sealed_options.max_file_size = store::FILE_HEADER_SIZE + 17;
+        store::Store sealed(sealed_path, sealed_options);
+        ASSERT_TRUE(sealed.load_keydir().ok());
+        ASSERT_TRUE(sealed.set("a", "1").ok());
+        ASSERT_TRUE(sealed.set("b", "2").ok()); // seals datafile1
+    }
+    fs::remove(fs::path(sealed_path) / "datafile2");
+    const fs::path datafile1 = fs::path(sealed_path) / "datafile1";
+    fs::permissions(datafile1, fs::perms::owner_write, fs::perm_options::add);
+    {
+        std::fstream file(datafile1, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(store::FILE_HEADER_SIZE + 16); // value of a
+        file.put('x');
+    }
+    fs::permissions(datafile1, fs::perms::owner_write, fs::perm_options::remove);
+    {
+        store::Store sealed(sealed_path);
+        ASSERT_TRUE(sealed.load_keydir().ok()); // from the hint file
+        store::Cursor cursor = sealed.scan();
+        EXPECT_FALSE(cursor.valid());
+        EXPECT_EQ(cursor.status().code(), absl::StatusCode::kDataLoss);
+    }
+
+    // (5) in the active datafile, only a record cut off at its end is
+    //     skipped: a checksum mismatch before it fails the scan
+    const std::string active_path = path + "/active";
+    fs::create_directories(active_path);
+    store::Store active(active_path);
+    ASSERT_TRUE(active.load_keydir().ok());
+    ASSERT_TRUE(active.set("a", "1").ok());
+    ASSERT_TRUE(active.set("b", "2").ok());
+    ASSERT_TRUE(active.set("c", "3").ok());
+    const fs::path active_datafile = fs::path(active_path) / "datafile1";
+    {
+        std::ofstream file(active_datafile, std::ios::binary | std::ios::app);
+        file << std::string("\x01\x02\x03\x04\x05", 5); // header of an append in flight
+    }
+    {
+        store::Cursor cursor = active.scan();
+        EXPECT_EQ(collect(cursor), (std::map<std::string, std::string>{{"a", "1"}, {"b", "2"}, {"c", "3"}}));
+    }
+    {
+        std::fstream file(active_datafile, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(store::FILE_HEADER_SIZE + 17 + 16); // value of b
+        file.put('x');
+    }
+    store::Cursor cursor = active.scan();
+    ASSERT_TRUE(cursor.valid());
+    EXPECT_EQ(cursor.key(), "a");
+    cursor.next();
+    EXPECT_FALSE(cursor.valid());
+    EXPECT_EQ(cursor.status().code(), absl::StatusCode::kDataLoss);
+}
+
+TEST_F(Store, Ttl)
+{
+    const std::string path = path_;
+    store::Options options;
+    options.max_file_size = 64;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+
+        // (1) an expired key is not returned, a key with a time to live is
+        //     until it expires
+        ASSERT_TRUE(store.set_with_ttl("gone", "1", std::chrono::seconds(0)).ok());
+        ASSERT_TRUE(store.set_with_ttl("kept", "2", std::chrono::hours(1)).ok());
+        ASSERT_TRUE(store.set("plain", "3").ok());
+        EXPECT_EQ(store.get("gone").status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.get_view("gone").status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.del("gone").code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.get("kept").value(), "2");
+        EXPECT_GT(store.kd_get("kept").value().expiry, static_cast<std::uint32_t>(std::time(nullptr)));
+        EXPECT_EQ(store.kd_get("plain").value().expiry, 0);
+
+        // a plain set clears the expiry
+        ASSERT_TRUE(store.set_with_ttl("renewed", "4", std::chrono::seconds(0)).ok());
+        ASSERT_TRUE(store.set("renewed", "5").ok());
+        EXPECT_EQ(store.get("renewed").value(), "5");
+
+        // (2) cursors skip the expired keys
+        std::map<std::string, std::string> visited;
+        for (store::Cursor cursor = store.scan(); cursor.valid(); cursor.next())
+        {
+            visited.emplace(cursor.key(), cursor.value());
+        }
+        EXPECT_EQ(visited, (std::map<std::string, std::string>{{"kept", "2"}, {"plain", "3"}, {"renewed", "5"}}));
+
+        // (3) a merge drops the expired records
+        EXPECT_EQ(store.kd_size(), 4);
+        ASSERT_TRUE(store.merge().ok());
+        EXPECT_EQ(store.kd_size(), 3);
+
+        // (4) purge_expired frees the expired keys
+        ASSERT_TRUE(store.set_with_ttl("gone", "6", std::chrono::seconds(0)).ok());
+        EXPECT_EQ(store.kd_size(), 4);
+        EXPECT_EQ(store.purge_expired(), 1);
+        EXPECT_EQ(store.kd_size(), 3);
+        EXPECT_EQ(store.purge_expired(), 0);
+
+        ASSERT_TRUE(store.set_with_ttl("gone", "7", std::chrono::seconds(0)).ok());
+        ASSERT_TRUE(store.set_with_ttl("later", "8", std::chrono::hours(1)).ok());
+    }
+
+    // (5) loading drops the expired keys, from the hint files as well as from
+    //     the datafiles, and keeps the expiry of the others
+    for (int i = 0; i < 2; i++)
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        EXPECT_EQ(store.kd_size(), 4);
+        EXPECT_EQ(store.get("gone").status().code(), absl::StatusCode::kNotFound);
+        EXPECT_EQ(store.get("later").value(), "8");
+        EXPECT_NE(store.kd_get("later").value().expiry, 0);
+        EXPECT_NE(store.kd_get("kept").value().expiry, 0);
+        for (store::fileid_t fileid : store.datafile_ids())
+        {
+            fs::remove(store.datafile_path(fileid).string() + ".hint");
+        }
+    }
+
+    // (6) the background sweep purges the keys as they expire
+    options.expiry_sweep_interval = std::chrono::milliseconds(1);
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    ASSERT_TRUE(store.set_with_ttl("gone", "9", std::chrono::seconds(0)).ok());
+    for (int i = 0; i < 1000 && store.kd_size() != 4; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(store.kd_size(), 4);
+    EXPECT_EQ(store.get("kept").value(), "2");
+}
+
+TEST_F(Store, OrderedIndex)
+{
+    const std::string path = path_;
+    {
+        store::Store store(path);
+        EXPECT_EQ(store.range("", "").status().code(), absl::StatusCode::kFailedPrecondition);
+    }
+
+    store::Options options;
+    options.max_file_size = 256;
+    options.ordered_index = true;
+    std::vector<std::string> tenant_b;
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        for (int i = 0; i < 30; i++)
+        {
+            std::string suffix = (i < 10 ? "0" : "") + std::to_string(i);
+            ASSERT_TRUE(store.set("tenant-a/" + suffix, "a").ok());
+            ASSERT_TRUE(store.set("tenant-b/" + suffix, "b").ok());
+            if (i % 4 != 0)
+            {
+                tenant_b.push_back("tenant-b/" + suffix);
+            }
+        }
+        store::WriteBatch batch;
+        for (int i = 0; i < 30; i += 4)
+        {
+            std::string suffix = (i < 10 ? "0" : "") + std::to_string(i);
+            batch.del("tenant-b/" + suffix);
+        }
+        batch.put("tenant-c", "c");
+        ASSERT_TRUE(store.write(batch).ok());
+        ASSERT_TRUE(store.del("tenant-c").ok());
+        ASSERT_TRUE(store.set_with_ttl("tenant-b/expired", "b", std::chrono::seconds(0)).ok());
+        ASSERT_TRUE(store.set("tenant-b\xff", "x").ok());
+
+        // (1) the index follows the sets, the deletes and the batches, and
+        //     skips the expired keys
+        EXPECT_EQ(store.scan_prefix("tenant-b/").value(), tenant_b);
+        EXPECT_EQ(store.scan_prefix("tenant-b").value().size(), tenant_b.size() + 1);
+        EXPECT_EQ(store.scan_prefix("tenant-c").value(), std::vector<std::string>());
+        EXPECT_EQ(store.range("tenant-a/28", "tenant-b/02").value(),
+                  (std::vector<std::string>{"tenant-a/28", "tenant-a/29", "tenant-b/01"}));
+        ASSERT_TRUE(store.merge().ok());
+        EXPECT_EQ(store.scan_prefix("tenant-b/").value(), tenant_b);
+    }
+
+    // (2) rebuilt by load_keydir, and paginated
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    std::vector<std::string> pages;
+    std::string begin = "tenant-b/";
+    for (;;)
+    {
+        absl::StatusOr<std::vector<std::string>> page = store.range(begin, "tenant-b0", 7);
+        ASSERT_TRUE(page.ok());
+        pages.insert(pages.end(), page->begin(), page->end());
+        if (page->size() < 7)
+        {
+            break;
+        }
+        begin = page->back() + '\0';
+    }
+    EXPECT_EQ(pages, tenant_b);
+    EXPECT_EQ(store.scan_prefix("", 3).value(),
+              (std::vector<std::string>{"tenant-a/00", "tenant-a/01", "tenant-a/02"}));
+}
+
+TEST_F(Store, FormatVersion)
+{
+    const std::string path = path_;
+    const fs::path datafile = fs::path(path) / "datafile1";
+    {
+        store::Store store(path);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_TRUE(store.set("a", "1").ok());
+    }
+    std::string content;
+    {
+        std::ifstream file(datafile, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    ASSERT_TRUE(store::check_file_header(content, store::DATAFILE_MAGIC, "datafile1").ok());
+
+    // a datafile of another version, or without a header as written before
+    // the formats were versioned, is rejected even when truncating
+    store::Options options;
+    options.corruption_policy = store::CorruptionPolicy::kTruncate;
+    for (const std::string &stale : {content.substr(0, 4) + std::string("\x02\x00\x00\x00", 4) +
+                                         content.substr(store::FILE_HEADER_SIZE),
+                                     content.substr(store::FILE_HEADER_SIZE)})
+    {
+        std::ofstream(datafile, std::ios::binary | std::ios::trunc) << stale;
+        store::Store store(path, options);
+        EXPECT_EQ(store.load_keydir().code(), absl::StatusCode::kFailedPrecondition);
+        EXPECT_EQ(fs::file_size(datafile), stale.size());
+    }
 }
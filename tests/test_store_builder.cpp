@@ -0,0 +1,177 @@
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "file_util.hpp"
+#include "store_builder.hpp"
+
+
+namespace fs = std::filesystem;
+
+static const std::string base_path = "./tests/test_store_builder_";
+
+TEST(StoreBuilder, Build)
+{
+    const std::string path = base_path + "build";
+    fs::remove_all(path);
+
+    // (1) 2000 keys, each set twice, and every tenth key deleted, in small
+    // datafiles and with more values than fit a single encoding chunk
+    store::Options options;
+    options.max_file_size = 1024 * 1024;
+    store::StoreBuilder builder(path, options, 3);
+    std::string large(3000, 'v');
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 1999; i >= 0; i--)
+        {
+            builder.put("key" + std::to_string(i), std::to_string(round) + large);
+        }
+    }
+    for (int i = 0; i < 2000; i += 10)
+    {
+        builder.del("key" + std::to_string(i));
+    }
+    builder.put("key0", "back");
+    EXPECT_EQ(builder.size(), 4201);
+
+    absl::StatusOr<store::BuildStats> stats = builder.finish();
+    ASSERT_TRUE(stats.ok()) << stats.status();
+    EXPECT_EQ(builder.size(), 0);
+    EXPECT_EQ(stats->records, 4201);
+    EXPECT_EQ(stats->keys, 1801);
+    EXPECT_EQ(stats->threads, 3);
+    EXPECT_GT(stats->datafiles, 5);
+
+    // the datafiles are sealed, under the threshold and hinted
+    std::uint64_t bytes = 0;
+    for (fs::path file : fs::directory_iterator(path))
+    {
+        if (file.extension() == ".hint")
+        {
+            continue;
+        }
+        EXPECT_TRUE(fs::exists(file.string() + ".hint")) << file;
+        EXPECT_LE(fs::file_size(file), options.max_file_size);
+        EXPECT_EQ(fs::status(file).permissions() & fs::perms::owner_write, fs::perms::none);
+        bytes += fs::file_size(file);
+    }
+    EXPECT_EQ(bytes, stats->bytes);
+
+    // (2) the store opens from the hint files and the last writes won
+    {
+        store::Store store(path, options);
+        ASSERT_TRUE(store.load_keydir().ok());
+        ASSERT_EQ(store.load_stats().files.size(), stats->datafiles);
+        for (const store::LoadStats::File &file : store.load_stats().files)
+        {
+            EXPECT_TRUE(file.from_hint);
+        }
+        EXPECT_EQ(store.kd_size(), 1801);
+        EXPECT_EQ(store.get("key0").value(), "back");
+        EXPECT_EQ(store.get("key1999").value(), "1" + large);
+        EXPECT_FALSE(store.get("key10").ok());
+
+        // and takes new writes in a datafile of its own
+        ASSERT_TRUE(store.set("key10", "new").ok());
+    }
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.get("key10").value(), "new");
+    EXPECT_EQ(store.kd_size(), 1802);
+
+    // (3) the directory of a store is not built over
+    store::StoreBuilder again(path);
+    again.put("a", "1");
+    EXPECT_EQ(again.finish().status().code(), absl::StatusCode::kFailedPrecondition);
+
+    fs::remove_all(path);
+}
+
+TEST(StoreBuilder, Spill)
+{
+    const std::string path = base_path + "spill";
+    fs::remove_all(path);
+
+    // (1) a memory limit of a few hundred items spills several runs, the
+    // keys are set, overridden and deleted across the runs
+    store::StoreBuilder builder(path, store::Options(), 2, 64 * 1024);
+    for (int round = 0; round < 3; round++)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            builder.put("key" + std::to_string(i), std::to_string(round) + std::string(50, 'v'));
+        }
+        for (int i = round; i < 1000; i += 7)
+        {
+            builder.del("key" + std::to_string(i));
+        }
+    }
+    builder.put("key0", "back");
+    builder.del("key1");
+    absl::StatusOr<store::BuildStats> stats = builder.finish();
+    ASSERT_TRUE(stats.ok()) << stats.status();
+    EXPECT_GT(stats->runs, 1);
+    EXPECT_EQ(stats->records, 3000 + 3 * 143 + 2);
+
+    // (2) the runs are gone and the latest item of every key won
+    for (fs::path file : fs::directory_iterator(path))
+    {
+        EXPECT_EQ(file.filename().string().rfind("datafile", 0), 0) << file;
+    }
+    store::Store store(path);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.kd_size(), 1000 - 143 - 1);
+    EXPECT_EQ(stats->keys, store.kd_size());
+    EXPECT_EQ(store.get("key0").value(), "back");
+    EXPECT_FALSE(store.get("key1").ok());
+    EXPECT_FALSE(store.get("key2").ok());
+    EXPECT_EQ(store.get("key7").value(), "2" + std::string(50, 'v'));
+    EXPECT_EQ(store.get("key3").value(), "2" + std::string(50, 'v'));
+
+    // (3) a spill fails on a store directory, the records added are refused
+    store::StoreBuilder again(path, store::Options(), 1, 1);
+    again.put("a", "1");
+    again.put("b", "2");
+    EXPECT_EQ(again.finish().status().code(), absl::StatusCode::kFailedPrecondition);
+    EXPECT_EQ(store::Store(path).load_keydir().code(), absl::StatusCode::kOk);
+
+    fs::remove_all(path);
+}
+
+TEST(StoreBuilder, Reader)
+{
+    const std::string path = base_path + "reader";
+    fs::remove_all(path);
+
+    std::istringstream input("set b 2\nset a 1\ndel b\nset c 3\nset a 4\n");
+    store::BulkReader reader(input, store::BulkFormat::kCommands);
+    store::StoreBuilder builder(path);
+    ASSERT_TRUE(builder.add(reader).ok());
+    absl::StatusOr<store::BuildStats> stats = builder.finish();
+    ASSERT_TRUE(stats.ok()) << stats.status();
+    EXPECT_EQ(stats->keys, 2);
+    EXPECT_EQ(stats->datafiles, 1);
+
+    // the records are written in key order
+    store::Options options;
+    options.ordered_index = true;
+    store::Store store(path, options);
+    ASSERT_TRUE(store.load_keydir().ok());
+    EXPECT_EQ(store.get("a").value(), "4");
+    EXPECT_EQ(store.kd_get("a").value().vpos, store::FILE_HEADER_SIZE);
+    EXPECT_GT(store.kd_get("c").value().vpos, store::FILE_HEADER_SIZE);
+    EXPECT_EQ(store.range("", "").value(), (std::vector<std::string>{"a", "c"}));
+
+    // a malformed record stops the reader, oversized keys fail the build
+    std::istringstream broken("set a 1\noops\n");
+    store::BulkReader broken_reader(broken, store::BulkFormat::kCommands);
+    store::StoreBuilder other(base_path + "other");
+    EXPECT_EQ(other.add(broken_reader).code(), absl::StatusCode::kInvalidArgument);
+    other.put(std::string(70000, 'k'), "v");
+    EXPECT_EQ(other.finish().status().code(), absl::StatusCode::kInvalidArgument);
+    EXPECT_TRUE(fs::is_empty(base_path + "other"));
+
+    fs::remove_all(path);
+    fs::remove_all(base_path + "other");
+}
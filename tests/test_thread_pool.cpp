@@ -0,0 +1,40 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <vector>
+#include "thread_pool.hpp"
+
+
+TEST(ThreadPool, Submit)
+{
+    store::ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; i++)
+    {
+        results.push_back(pool.submit([i]() { return i * i; }));
+    }
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+}
+
+TEST(ThreadPool, DefaultSize)
+{
+    store::ThreadPool pool;
+    EXPECT_GE(pool.size(), 1);
+}
+
+TEST(ThreadPool, DrainOnDestruction)
+{
+    std::atomic<int> done = 0;
+    {
+        store::ThreadPool pool(2);
+        for (int i = 0; i < 50; i++)
+        {
+            pool.submit([&done]() { done++; });
+        }
+    }
+    EXPECT_EQ(done, 50);
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "value_cache.hpp"
+
+
+static keydir::Entry entry(fileid_t fileid, std::uint64_t vpos)
+{
+    return {.fileid = fileid, .vsz = 0, .vpos = vpos};
+}
+
+
+TEST(ValueCache, GetAndInsert)
+{
+    store::ValueCache cache(1 << 20);
+    EXPECT_FALSE(cache.get(entry(1, 0)).has_value());
+    cache.insert(entry(1, 0), "value");
+    EXPECT_EQ(cache.get(entry(1, 0)).value(), "value");
+
+    // entries are keyed by record: another record of the key is a miss
+    EXPECT_FALSE(cache.get(entry(1, 20)).has_value());
+    EXPECT_FALSE(cache.get(entry(2, 0)).has_value());
+
+    cache.erase(entry(1, 0));
+    EXPECT_FALSE(cache.get(entry(1, 0)).has_value());
+
+    store::ValueCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 4);
+    EXPECT_EQ(stats.inserts, 1);
+    EXPECT_EQ(stats.entries, 0);
+    EXPECT_EQ(stats.bytes, 0);
+}
+
+TEST(ValueCache, Eviction)
+{
+    // a single shard holding about 10 values of 100 bytes
+    const std::size_t charge = 100 + store::ValueCache::ENTRY_OVERHEAD;
+    store::ValueCache cache(10 * charge, 1);
+    const std::string value(100, 'v');
+    cache.insert(entry(1, 0), value);
+    for (std::uint64_t i = 1; i < 100; i++)
+    {
+        // the first value is hot and keeps getting a second chance
+        EXPECT_TRUE(cache.get(entry(1, 0)).has_value()) << i;
+        cache.insert(entry(1, i * 100), value);
+    }
+
+    store::ValueCache::Stats stats = cache.stats();
+    EXPECT_EQ(stats.entries, 10);
+    EXPECT_LE(stats.bytes, stats.capacity);
+    EXPECT_EQ(stats.evictions, 90);
+    EXPECT_EQ(stats.inserts, 100);
+
+    // values larger than a shard are not cached
+    cache.insert(entry(2, 0), std::string(20 * charge, 'v'));
+    EXPECT_FALSE(cache.get(entry(2, 0)).has_value());
+}
+
+TEST(ValueCache, EraseFile)
+{
+    store::ValueCache cache(1 << 20, 4);
+    for (std::uint64_t i = 0; i < 100; i++)
+    {
+        cache.insert(entry(1 + i % 2, i), "value");
+    }
+    cache.erase_file(1);
+    EXPECT_EQ(cache.stats().entries, 50);
+    EXPECT_FALSE(cache.get(entry(1, 0)).has_value());
+    EXPECT_TRUE(cache.get(entry(2, 1)).has_value());
+}